@@ -5,6 +5,7 @@ void exit(int code);
 int strlen(char *s);
 char *memcpy(char *dst, char *src, int n);
 char *memset(char *dst, int v, int n);
+int memcmp(char *a, char *b, int n);
 
 int vprintf(char *fmt, int *args, int count);
 int printf(char *fmt, int a, int b, int c);
@@ -19,6 +20,28 @@ int strtol(char *s, int *end, int base);
 int write(int fd, char *buf, int len);
 int read(int fd, char *buf, int len);
 
+// Host files (simulator --fs-root). open flags are summed, e.g.
+// O_WRONLY + O_CREAT + O_TRUNC. Errors are returned as -errno.
+// fstat fills st[4] = size, mode, mtime, ino.
+#define O_RDONLY 0
+#define O_WRONLY 1
+#define O_RDWR 2
+#define O_CREAT 64
+#define O_EXCL 128
+#define O_TRUNC 512
+#define O_APPEND 1024
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+int open(char *path, int flags, int mode);
+int close(int fd);
+int lseek(int fd, int offset, int whence);
+int pread(int fd, char *buf, int len, int offset);
+int pwrite(int fd, char *buf, int len, int offset);
+int fstat(int fd, int *st);
+
 char *malloc(int n);
 void free(char *p);
 char *calloc(int n, int size);
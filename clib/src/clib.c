@@ -2,6 +2,7 @@
 
 int __minac_putchar(int c);
 void __minac_exit(int code);
+int __minac_syscall(int n, int a0, int a1, int a2, int a3);
 
 int putchar(int c) {
     return __minac_putchar(c);
@@ -22,6 +23,33 @@ void exit(int code) {
     __minac_exit(code);
 }
 
+// Built with -D CLIB_HOSTMEM, strlen, memcpy, memset and memcmp are the
+// simulator's memory syscalls (12-15): the host does the work over the
+// checked guest ranges and charges cycles for it (mina-sim
+// --memcall-cycles). Otherwise they are the loops below.
+#ifdef CLIB_HOSTMEM
+int strlen(char *s) {
+    if (!s) return 0;
+    return __minac_syscall(15, s);
+}
+
+char *memcpy(char *dst, char *src, int n) {
+    if (n <= 0) return dst;
+    return __minac_syscall(12, dst, src, n);
+}
+
+char *memset(char *dst, int v, int n) {
+    if (n <= 0) return dst;
+    return __minac_syscall(13, dst, v, n);
+}
+
+int memcmp(char *a, char *b, int n) {
+    if (n <= 0) return 0;
+    return __minac_syscall(14, a, b, n);
+}
+#endif
+
+#ifndef CLIB_HOSTMEM
 int strlen(char *s) {
     int n = 0;
     if (!s) return 0;
@@ -31,8 +59,47 @@ int strlen(char *s) {
     return n;
 }
 
+#ifdef CLIB_DMA
+// Built with -D CLIB_DMA, moves of 256 bytes or more go to the
+// simulator's DMA engine (MMIO at 0x10002000): registers SRC, DST, LEN,
+// ROWS, SRC_STRIDE, DST_STRIDE, FILL, CTRL, START, STATUS as consecutive
+// 8-byte words. STATUS reads 1 while busy, 2 when done and 6 when the
+// range was rejected (no bitwise operators in minac, so the values are
+// compared whole). Returns 0 on rejection, so the caller can fall back
+// to the byte loop.
+//
+// The engine takes physical addresses, so the pointers must be
+// identity-mapped (bare mode, or Sv39 pages with va == pa). The transfer
+// runs on a host thread and the poll loop spins until it finishes, so
+// the instruction count depends on host scheduling unless mina-sim runs
+// with --record/--replay.
+int clib_dma(char *dst, char *src, int n, int fill, int ctrl) {
+    int *dma = 268443648;
+    while (dma[9] == 1) {
+    }
+    dma[0] = src;
+    dma[1] = dst;
+    dma[2] = n;
+    dma[3] = 1;
+    dma[4] = 0;
+    dma[5] = 0;
+    dma[6] = fill;
+    dma[7] = ctrl;
+    dma[8] = 1;
+    while (dma[9] < 2) {
+    }
+    int status = dma[9];
+    dma[9] = 6;
+    if (status != 2) return 0;
+    return 1;
+}
+#endif
+
 char *memcpy(char *dst, char *src, int n) {
     int i = 0;
+#ifdef CLIB_DMA
+    if (n >= 256 && clib_dma(dst, src, n, 0, 0)) return dst;
+#endif
     while (i < n) {
         dst[i] = src[i];
         i = i + 1;
@@ -43,6 +110,9 @@ char *memcpy(char *dst, char *src, int n) {
 char *memset(char *dst, int v, int n) {
     char b = v;
     int i = 0;
+#ifdef CLIB_DMA
+    if (n >= 256 && clib_dma(dst, 0, n, v, 2)) return dst;
+#endif
     while (i < n) {
         dst[i] = b;
         i = i + 1;
@@ -50,6 +120,21 @@ char *memset(char *dst, int v, int n) {
     return dst;
 }
 
+// Difference of the first differing bytes, compared unsigned.
+int memcmp(char *a, char *b, int n) {
+    int i = 0;
+    while (i < n) {
+        int x = a[i];
+        int y = b[i];
+        if (x < 0) x = x + 256;
+        if (y < 0) y = y + 256;
+        if (x != y) return x - y;
+        i = i + 1;
+    }
+    return 0;
+}
+#endif
+
 int print_int(int v) {
     char buf[32];
     int n = 0;
@@ -186,24 +271,41 @@ int atoi(char *s) {
 }
 
 int write(int fd, char *buf, int len) {
-    int i = 0;
     if (!buf) return 0;
     if (len <= 0) return 0;
-    if (fd == 1 || fd == 2) {
-        while (i < len) {
-            putchar(buf[i]);
-            i = i + 1;
-        }
-        return len;
-    }
-    return 0;
+    return __minac_syscall(1, fd, buf, len);
 }
 
 int read(int fd, char *buf, int len) {
     if (!buf) return 0;
     if (len <= 0) return 0;
-    if (fd != 0) return 0;
-    return 0;
+    return __minac_syscall(2, fd, buf, len);
+}
+
+int open(char *path, int flags, int mode) {
+    return __minac_syscall(6, path, flags, mode);
+}
+
+int close(int fd) {
+    return __minac_syscall(7, fd);
+}
+
+int lseek(int fd, int offset, int whence) {
+    return __minac_syscall(8, fd, offset, whence);
+}
+
+int pread(int fd, char *buf, int len, int offset) {
+    if (len <= 0) return 0;
+    return __minac_syscall(9, fd, buf, len, offset);
+}
+
+int pwrite(int fd, char *buf, int len, int offset) {
+    if (len <= 0) return 0;
+    return __minac_syscall(10, fd, buf, len, offset);
+}
+
+int fstat(int fd, int *st) {
+    return __minac_syscall(11, fd, st);
 }
 
 int clib_heap[8];
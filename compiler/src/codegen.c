@@ -197,7 +197,7 @@ int codegen_emit_asm(const IRProgram *ir, FILE *out, int emit_start, char **out_
         update_max_temp(current_info, inst->dst);
         update_max_temp(current_info, inst->lhs);
         update_max_temp(current_info, inst->rhs);
-        if (inst->op == IR_CALL && inst->args) {
+        if ((inst->op == IR_CALL || inst->op == IR_SYSCALL) && inst->args) {
             for (int a = 0; a < inst->argc; a++) update_max_temp(current_info, inst->args[a]);
         }
     }
@@ -517,6 +517,51 @@ int codegen_emit_asm(const IRProgram *ir, FILE *out, int emit_start, char **out_
                 }
                 break;
             }
+            case IR_SYSCALL: {
+                // Stage through a0..a4 first: the syscall registers r10-r13
+                // alias t6-t9 and r17 aliases a1. Temporaries held in t6-t8
+                // are parked in a5-a7 across the ecall.
+                if (inst->argc < 1 || inst->argc > 5) {
+                    if (out_error && !*out_error) *out_error = dup_error("error: bad syscall argument count");
+                    return 0;
+                }
+                for (int a = 0; a < inst->argc; a++) {
+                    const char *rs = NULL;
+                    if (inst->args[a] >= reg_count) {
+                        int off = spill_offset(inst->args[a], cur_ra_size, reg_count);
+                        rs = scratch_regs[0];
+                        fprintf(out, "  ld %s, %d, sp\n", rs, off);
+                    } else {
+                        rs = temp_reg_name(inst->args[a], out_error);
+                        if (!rs) return 0;
+                    }
+                    fprintf(out, "  mov %s, %s\n", arg_regs[a], rs);
+                }
+                int parked = current ? current->max_temp - 5 : 0;
+                if (parked > 3) parked = 3;
+                for (int p = 0; p < parked; p++) fprintf(out, "  mov %s, %s\n", arg_regs[5 + p], temp_regs[6 + p]);
+                for (int a = 1; a < inst->argc; a++) fprintf(out, "  mov r%d, %s\n", 9 + a, arg_regs[a]);
+                fprintf(out, "  mov r17, a0\n");
+                fprintf(out, "  ecall\n");
+                const char *result = "r10";
+                if (parked > 0) {
+                    fprintf(out, "  mov a0, r10\n");
+                    for (int p = 0; p < parked; p++) fprintf(out, "  mov %s, %s\n", temp_regs[6 + p], arg_regs[5 + p]);
+                    result = "a0";
+                }
+                if (inst->dst >= 0) {
+                    if (inst->dst >= reg_count) {
+                        int off = spill_offset(inst->dst, cur_ra_size, reg_count);
+                        fprintf(out, "  mov %s, %s\n", scratch_regs[0], result);
+                        fprintf(out, "  st %s, %d, sp\n", scratch_regs[0], off);
+                    } else {
+                        const char *rd = temp_reg_name(inst->dst, out_error);
+                        if (!rd) return 0;
+                        fprintf(out, "  mov %s, %s\n", rd, result);
+                    }
+                }
+                break;
+            }
             case IR_WRITE: {
                 const char *addr = NULL;
                 if (inst->lhs >= reg_count) {
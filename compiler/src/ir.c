@@ -25,7 +25,7 @@ void ir_init(IRProgram *ir) {
 void ir_free(IRProgram *ir) {
     if (ir->insts) {
         for (size_t i = 0; i < ir->count; i++) {
-            if (ir->insts[i].op == IR_CALL) free(ir->insts[i].args);
+            if (ir->insts[i].op == IR_CALL || ir->insts[i].op == IR_SYSCALL) free(ir->insts[i].args);
             if (ir->insts[i].op == IR_GLOBAL_STR || ir->insts[i].op == IR_GLOBAL_BYTES) free(ir->insts[i].data);
             if (ir->insts[i].op == IR_GLOBAL_INT_ARR) free(ir->insts[i].values);
         }
@@ -238,6 +238,22 @@ int ir_emit_call(IRProgram *ir, const char *name, const int *args, int argc) {
     return temp;
 }
 
+// args[0] is the syscall number (a7), args[1..] go to a0.. in order.
+int ir_emit_syscall(IRProgram *ir, const int *args, int argc) {
+    int temp = ir_new_temp(ir);
+    IRInst inst = {0};
+    inst.op = IR_SYSCALL;
+    inst.argc = argc;
+    if (argc > 0) {
+        inst.args = (int *)malloc((size_t)argc * sizeof(int));
+        if (!inst.args) return -1;
+        for (int i = 0; i < argc; i++) inst.args[i] = args[i];
+    }
+    inst.dst = temp;
+    if (!ir_push(ir, inst)) { free(inst.args); return -1; }
+    return temp;
+}
+
 int ir_new_label(IRProgram *ir) {
     return ir->label_count++;
 }
@@ -346,6 +362,15 @@ void ir_print(const IRProgram *ir, FILE *out) {
                 fprintf(out, ")\n");
                 break;
             }
+            case IR_SYSCALL: {
+                fprintf(out, "t%d = syscall(", inst->dst);
+                for (int i = 0; i < inst->argc; i++) {
+                    if (i) fprintf(out, ", ");
+                    fprintf(out, "t%d", inst->args[i]);
+                }
+                fprintf(out, ")\n");
+                break;
+            }
             case IR_RET:
                 fprintf(out, "return t%d\n", inst->lhs);
                 break;
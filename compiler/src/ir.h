@@ -24,6 +24,7 @@ typedef enum {
     IR_FUNC,
     IR_PARAM,
     IR_CALL,
+    IR_SYSCALL,
     IR_RET,
     IR_EXIT,
     IR_LABEL,
@@ -79,6 +80,7 @@ void ir_emit_exit(IRProgram *ir, int value_temp);
 void ir_emit_func(IRProgram *ir, const char *name);
 void ir_emit_param(IRProgram *ir, int index, int dst);
 int ir_emit_call(IRProgram *ir, const char *name, const int *args, int argc);
+int ir_emit_syscall(IRProgram *ir, const int *args, int argc);
 int ir_new_label(IRProgram *ir);
 void ir_emit_label(IRProgram *ir, int label);
 void ir_emit_jmp(IRProgram *ir, int label);
@@ -577,6 +577,24 @@ static int lower_expr(const Expr *expr, IRProgram *ir, LocalMap *locals, GlobalM
                 ir_emit_exit(ir, code_temp);
                 return ir_emit_const(ir, 0);
             }
+            if (strcmp(fname, "__minac_syscall") == 0) {
+                if (expr->as.call.arg_count < 1 || expr->as.call.arg_count > 5) {
+                    if (out_error && !*out_error) *out_error = dup_error_at(expr, "__minac_syscall expects 1 to 5 arguments");
+                    return -1;
+                }
+                int sargs[5];
+                for (size_t i = 0; i < expr->as.call.arg_count; i++) {
+                    int t = lower_expr(expr->as.call.args[i], ir, locals, globals, out_error);
+                    if (t < 0) return -1;
+                    sargs[i] = t;
+                }
+                int temp = ir_emit_syscall(ir, sargs, (int)expr->as.call.arg_count);
+                if (temp < 0) {
+                    if (out_error && !*out_error) *out_error = dup_error_at(expr, "out of memory");
+                    return -1;
+                }
+                return temp;
+            }
             if (expr->as.call.arg_count > 8) {
                 if (out_error && !*out_error) *out_error = dup_error_at(expr, "too many call arguments");
                 return -1;
@@ -11,8 +11,10 @@
 #include "codegen.h"
 #include "opt.h"
 
+#define MAX_DEFINES 32
+
 static void print_usage(const char *prog) {
-    fprintf(stderr, "usage: %s [--emit-ir] [--emit-asm] [--bin] [--prefer-libc] [-O] [--max-errors N] [-o out.elf] <file.c>\n", prog);
+    fprintf(stderr, "usage: %s [--emit-ir] [--emit-asm] [--bin] [--prefer-libc] [-D NAME[=VALUE]] [-O] [--max-errors N] [-o out.elf] <file.c>\n", prog);
 }
 
 static char *dup_string(const char *s) {
@@ -83,6 +85,8 @@ int main(int argc, char **argv) {
     int prefer_libc = 0;
     const char *output_path = NULL;
     const char *path = NULL;
+    const char *defines[MAX_DEFINES];
+    size_t define_count = 0;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--emit-ir") == 0) {
@@ -98,6 +102,17 @@ int main(int argc, char **argv) {
         } else if (strcmp(argv[i], "--max-errors") == 0) {
             if (i + 1 >= argc) { print_usage(argv[0]); return 1; }
             max_errors = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-D", 2) == 0) {
+            const char *def = argv[i] + 2;
+            if (*def == '\0') {
+                if (i + 1 >= argc) { print_usage(argv[0]); return 1; }
+                def = argv[++i];
+            }
+            if (*def == '\0' || *def == '=' || define_count == MAX_DEFINES) {
+                fprintf(stderr, "error: invalid -D %s\n", def);
+                return 1;
+            }
+            defines[define_count++] = def;
         } else if (strcmp(argv[i], "-O") == 0) {
             optimize = 1;
         } else if (strcmp(argv[i], "-o") == 0) {
@@ -126,7 +141,7 @@ int main(int argc, char **argv) {
 
     char *err = NULL;
     char *source = NULL;
-    if (!preprocess_source(path, &source, &err)) {
+    if (!preprocess_source(path, defines, define_count, &source, &err)) {
         fprintf(stderr, "%s\n", err ? err : "error: preprocessor failed");
         free(err);
         return 1;
@@ -26,7 +26,7 @@ static int max_temp_in_range(const IRInst *insts, size_t start, size_t end) {
         if (inst->dst > max) max = inst->dst;
         if (inst->lhs > max) max = inst->lhs;
         if (inst->rhs > max) max = inst->rhs;
-        if (inst->op == IR_CALL && inst->args) {
+        if ((inst->op == IR_CALL || inst->op == IR_SYSCALL) && inst->args) {
             for (int a = 0; a < inst->argc; a++) if (inst->args[a] > max) max = inst->args[a];
         }
     }
@@ -167,6 +167,7 @@ static void const_fold_range(IRInst *insts, size_t start, size_t end) {
             case IR_LOAD8:
             case IR_PARAM:
             case IR_CALL:
+            case IR_SYSCALL:
             case IR_WRITE:
                 if (inst->dst >= 0 && inst->dst <= max) vals[inst->dst].known = 0;
                 break;
@@ -188,6 +189,7 @@ static int inst_has_dst(const IRInst *inst) {
         case IR_LOAD8:
         case IR_PARAM:
         case IR_CALL:
+        case IR_SYSCALL:
         case IR_WRITE:
             return 1;
         default:
@@ -200,6 +202,7 @@ static int inst_has_side_effect(const IRInst *inst) {
         case IR_STORE:
         case IR_STORE8:
         case IR_CALL:
+        case IR_SYSCALL:
         case IR_WRITE:
         case IR_RET:
         case IR_EXIT:
@@ -242,6 +245,7 @@ static void collect_uses(const IRInst *inst, int *used, int max) {
             mark_used(used, max, inst->rhs);
             break;
         case IR_CALL:
+        case IR_SYSCALL:
             if (inst->args) {
                 for (int a = 0; a < inst->argc; a++) mark_used(used, max, inst->args[a]);
             }
@@ -298,6 +302,7 @@ static void cse_range(IRInst *insts, size_t start, size_t end) {
             case IR_STORE:
             case IR_STORE8:
             case IR_CALL:
+            case IR_SYSCALL:
             case IR_WRITE:
                 clear_exprs(entries, &entry_count);
                 break;
@@ -437,7 +442,7 @@ static size_t dce_range(IRInst *insts, size_t start, size_t end, IRInst *out, si
         if (keep[i]) {
             if (out_count < out_cap) out[out_count++] = *inst;
         } else {
-            if (inst->op == IR_CALL) free(inst->args);
+            if (inst->op == IR_CALL || inst->op == IR_SYSCALL) free(inst->args);
             if (inst->op == IR_GLOBAL_STR) free(inst->data);
             if (inst->op == IR_GLOBAL_INT_ARR) free(inst->values);
         }
@@ -438,11 +438,21 @@ next_line:
     return 1;
 }
 
-int preprocess_source(const char *path, char **out_source, char **out_error) {
+int preprocess_source(const char *path, const char *const *defines, size_t define_count,
+                      char **out_source, char **out_error) {
     if (out_error) *out_error = NULL;
     if (!out_source || !path) return 0;
     *out_source = NULL;
     MacroTable macros = {0};
+    for (size_t i = 0; i < define_count; i++) {
+        const char *eq = strchr(defines[i], '=');
+        size_t name_len = eq ? (size_t)(eq - defines[i]) : strlen(defines[i]);
+        if (!macro_set(&macros, defines[i], name_len, eq ? eq + 1 : "")) {
+            if (out_error) *out_error = dup_error("error: out of memory");
+            macros_free(&macros);
+            return 0;
+        }
+    }
     Buffer out;
     buf_init(&out);
     if (!preprocess_file(path, &macros, &out, out_error, 0)) {
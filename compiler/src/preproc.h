@@ -1,6 +1,11 @@
 #ifndef MINAC_PREPROC_H
 #define MINAC_PREPROC_H
 
-int preprocess_source(const char *path, char **out_source, char **out_error);
+#include <stddef.h>
+
+// `defines` holds define_count command-line macros as "NAME" or
+// "NAME=VALUE" (NAME alone defines it as empty).
+int preprocess_source(const char *path, const char *const *defines, size_t define_count,
+                      char **out_source, char **out_error);
 
 #endif
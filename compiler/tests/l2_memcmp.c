@@ -0,0 +1,20 @@
+#include "clib.h"
+
+int main(){
+  char a[4];
+  char b[4];
+  a[0] = 79;
+  a[1] = 75;
+  a[2] = 200;
+  a[3] = 0;
+  memcpy(b, a, 4);
+  if (memcmp(a, b, 4) != 0) exit(1);
+  b[2] = 10;
+  if (memcmp(a, b, 4) <= 0) exit(1);
+  if (memcmp(b, a, 4) >= 0) exit(1);
+  if (memcmp(a, b, 2) != 0) exit(1);
+  putchar(79);
+  putchar(75);
+  putchar(10);
+  return 0;
+}
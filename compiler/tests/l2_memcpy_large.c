@@ -0,0 +1,27 @@
+#include "clib.h"
+
+int main(){
+  char src[512];
+  char dst[512];
+  int i = 0;
+  memset(src, 90, 512);
+  while (i < 512) {
+    if (src[i] != 90) exit(1);
+    i = i + 1;
+  }
+  i = 0;
+  while (i < 512) {
+    src[i] = i - ((i / 100) * 100);
+    i = i + 1;
+  }
+  memcpy(dst, src, 512);
+  i = 0;
+  while (i < 512) {
+    if (dst[i] != src[i]) exit(2);
+    i = i + 1;
+  }
+  putchar(79);
+  putchar(75);
+  putchar(10);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include "clib.h"
+
+// Eight values are live across the pread syscall and the arguments come
+// from temporaries in r10-r12, which the syscall registers overwrite.
+int pread_staged(int fd, char *buf) {
+  int len = 3;
+  int off = 2;
+  int k = 4;
+  int one = 1;
+  int two = 2;
+  int nine = 9;
+  int n = __minac_syscall(nine, fd, buf, len + two, off);
+  if (fd + len + off + k + one + two + nine != fd + 21) return -1;
+  return n;
+}
+
+int main(){
+  char buf[8];
+  int st[4];
+  // Temporaries do not survive calls, so the descriptor lives in memory.
+  int fd[1];
+  int r = open("files.txt", O_RDWR + O_CREAT + O_TRUNC, 420);
+  fd[0] = r;
+  if (fd[0] < 0) exit(1);
+  if (open("files.txt", O_WRONLY + O_CREAT + O_EXCL, 420) >= 0) exit(2);
+  if (pwrite(fd[0], "hello, files", 12, 0) != 12) exit(3);
+  if (fstat(fd[0], st) != 0) exit(4);
+  if (st[0] != 12) exit(5);
+  if (lseek(fd[0], 0, SEEK_END) != 12) exit(6);
+  if (lseek(fd[0], 7 - 12, SEEK_CUR) != 7) exit(7);
+  if (read(fd[0], buf, 5) != 5) exit(8);
+  if (memcmp(buf, "files", 5) != 0) exit(9);
+
+  if (pread_staged(fd[0], buf) != 5) exit(10);
+  if (memcmp(buf, "llo, ", 5) != 0) exit(11);
+
+  if (pwrite(fd[0], "H", 1, 0) != 1) exit(12);
+  if (pread(fd[0], buf, 2, 0) != 2) exit(13);
+  if (memcmp(buf, "He", 2) != 0) exit(14);
+  if (close(fd[0]) != 0) exit(15);
+  if (close(fd[0]) >= 0) exit(16);
+  putchar(79);
+  putchar(75);
+  putchar(10);
+  return 0;
+}
@@ -11,6 +11,20 @@ OUT="$OUT_ELF"
 CLIB_SRC="$ROOT_DIR/../clib/src/clib.c"
 
 mkdir -p "$OUT_ELF" "$OUT_TMP"
+# COVERAGE_DIR=dir: also write --coverage data for every simulator run
+# into dir, named after the image.
+COVERAGE_DIR=${COVERAGE_DIR:-}
+if [ -n "$COVERAGE_DIR" ]; then mkdir -p "$COVERAGE_DIR"; fi
+
+sim() {
+  if [ -z "$COVERAGE_DIR" ]; then
+    "$SIM" "$@"
+    return
+  fi
+  for image; do :; done
+  image=$(basename "$image")
+  "$SIM" --coverage "$COVERAGE_DIR/${image%.*}.cov" "$@"
+}
 
 if [ ! -x "$BIN" ]; then
   echo "minac binary not found. Run 'make' in compiler/." >&2
@@ -67,55 +81,55 @@ echo "PASS n1_err_recovery"
 
 # n2_const_init.c: constant expressions in initializers
 "$BIN" -o "$OUT_ELF/n2_const_init.elf" "$ROOT_DIR/tests/n2_const_init.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/n2_const_init.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/n2_const_init.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL n2_const_init_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL n2_const_init_sim" >&2; exit 1; }
 echo "PASS n2_const_init_sim"
 
 # n3_enum.c: enum declarations and usage
 "$BIN" -o "$OUT_ELF/n3_enum.elf" "$ROOT_DIR/tests/n3_enum.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/n3_enum.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/n3_enum.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL n3_enum_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL n3_enum_sim" >&2; exit 1; }
 echo "PASS n3_enum_sim"
 
 # n4_init_struct.c: aggregate initializers
 "$BIN" -o "$OUT_ELF/n4_init_struct.elf" "$ROOT_DIR/tests/n4_init_struct.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/n4_init_struct.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/n4_init_struct.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL n4_init_struct_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL n4_init_struct_sim" >&2; exit 1; }
 echo "PASS n4_init_struct_sim"
 
 # n9_ifdef.c: preprocessor ifdef/ifndef/undef
 "$BIN" -o "$OUT_ELF/n9_ifdef.elf" "$ROOT_DIR/tests/n9_ifdef.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/n9_ifdef.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/n9_ifdef.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL n9_ifdef_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL n9_ifdef_sim" >&2; exit 1; }
 echo "PASS n9_ifdef_sim"
 
 # l0_putchar.c: builtin putchar
 "$BIN" -o "$OUT_ELF/l0_putchar.elf" "$ROOT_DIR/tests/l0_putchar.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/l0_putchar.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l0_putchar.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l0_putchar_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l0_putchar_sim" >&2; exit 1; }
 echo "PASS l0_putchar_sim"
 
 # l0_puts.c: builtin puts
 "$BIN" -o "$OUT_ELF/l0_puts.elf" "$ROOT_DIR/tests/l0_puts.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/l0_puts.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l0_puts.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l0_puts_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l0_puts_sim" >&2; exit 1; }
 echo "PASS l0_puts_sim"
 
 # l0_exit.c: builtin exit
 "$BIN" -o "$OUT_ELF/l0_exit.elf" "$ROOT_DIR/tests/l0_exit.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/l0_exit.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l0_exit.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l0_exit_sim" >&2; exit 1; }
 echo "PASS l0_exit_sim"
 
 # l1_header.c: clib.h include
 "$BIN" -o "$OUT_ELF/l1_header.elf" "$ROOT_DIR/tests/l1_header.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/l1_header.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l1_header.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l1_header_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l1_header_sim" >&2; exit 1; }
 echo "PASS l1_header_sim"
@@ -128,7 +142,7 @@ sed 's/\.L/\.Lclib/g' "$OUT_TMP/clib.s" > "$OUT_TMP/clib.lib.s"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l2_strlen.c" > "$OUT_TMP/l2_strlen.s"
 cat "$OUT_TMP/l2_strlen.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l2_strlen_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l2_strlen_full.s" -o "$OUT_ELF/l2_strlen.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l2_strlen.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l2_strlen.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l2_strlen_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l2_strlen_sim" >&2; exit 1; }
 echo "PASS l2_strlen_sim"
@@ -137,7 +151,7 @@ echo "PASS l2_strlen_sim"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l2_memcpy.c" > "$OUT_TMP/l2_memcpy.s"
 cat "$OUT_TMP/l2_memcpy.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l2_memcpy_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l2_memcpy_full.s" -o "$OUT_ELF/l2_memcpy.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l2_memcpy.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l2_memcpy.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l2_memcpy_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l2_memcpy_sim" >&2; exit 1; }
 echo "PASS l2_memcpy_sim"
@@ -146,16 +160,67 @@ echo "PASS l2_memcpy_sim"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l2_memset.c" > "$OUT_TMP/l2_memset.s"
 cat "$OUT_TMP/l2_memset.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l2_memset_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l2_memset_full.s" -o "$OUT_ELF/l2_memset.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l2_memset.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l2_memset.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l2_memset_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l2_memset_sim" >&2; exit 1; }
 echo "PASS l2_memset_sim"
 
+# l2_memcmp.c: clib memcmp
+"$BIN" --emit-asm "$ROOT_DIR/tests/l2_memcmp.c" > "$OUT_TMP/l2_memcmp.s"
+cat "$OUT_TMP/l2_memcmp.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l2_memcmp_full.s"
+"$AS" --data-base 0x4000 "$OUT_TMP/l2_memcmp_full.s" -o "$OUT_ELF/l2_memcmp.elf"
+OUT_LOG=$(sim "$OUT_ELF/l2_memcmp.elf" 2>&1 || true)
+echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l2_memcmp_sim" >&2; exit 1; }
+echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l2_memcmp_sim" >&2; exit 1; }
+echo "PASS l2_memcmp_sim"
+
+# L2 again with clib built -D CLIB_HOSTMEM (simulator memory syscalls)
+"$BIN" -D CLIB_HOSTMEM --emit-asm --no-start "$CLIB_SRC" > "$OUT_TMP/clib_hostmem.s"
+sed 's/\.L/\.Lclib/g' "$OUT_TMP/clib_hostmem.s" > "$OUT_TMP/clib_hostmem.lib.s"
+for t in l2_strlen l2_memcpy l2_memset l2_memcmp; do
+  cat "$OUT_TMP/$t.s" "$OUT_TMP/clib_hostmem.lib.s" > "$OUT_TMP/${t}_hostmem.s"
+  "$AS" --data-base 0x4000 "$OUT_TMP/${t}_hostmem.s" -o "$OUT_ELF/${t}_hostmem.elf"
+  OUT_LOG=$(sim --stats "$OUT_ELF/${t}_hostmem.elf" 2>&1 || true)
+  echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL ${t}_hostmem_sim" >&2; exit 1; }
+  echo "$OUT_LOG" | grep -q "host ${t#l2_} " || { echo "FAIL ${t}_hostmem_sim" >&2; exit 1; }
+  echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL ${t}_hostmem_sim" >&2; exit 1; }
+  echo "PASS ${t}_hostmem_sim"
+done
+
+# l2_memcpy_large.c: memset/memcpy of 512 bytes, with the default clib and
+# with clib built -D CLIB_DMA. Under --record the DMA engine completes
+# synchronously, so the DMA build must halt after the same number of
+# steps every run, and in fewer steps than the byte loops.
+"$BIN" --emit-asm "$ROOT_DIR/tests/l2_memcpy_large.c" > "$OUT_TMP/l2_memcpy_large.s"
+cat "$OUT_TMP/l2_memcpy_large.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l2_memcpy_large_full.s"
+"$AS" --data-base 0x4000 "$OUT_TMP/l2_memcpy_large_full.s" -o "$OUT_ELF/l2_memcpy_large.elf"
+OUT_LOG=$(sim "$OUT_ELF/l2_memcpy_large.elf" 2>&1 < /dev/null || true)
+echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l2_memcpy_large_sim" >&2; exit 1; }
+echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l2_memcpy_large_sim" >&2; exit 1; }
+LOOP_STEPS=$(echo "$OUT_LOG" | sed -n 's/.*halted on ebreak after \([0-9]*\) steps.*/\1/p')
+echo "PASS l2_memcpy_large_sim"
+
+"$BIN" -D CLIB_DMA --emit-asm --no-start "$CLIB_SRC" > "$OUT_TMP/clib_dma.s"
+sed 's/\.L/\.Lclib/g' "$OUT_TMP/clib_dma.s" > "$OUT_TMP/clib_dma.lib.s"
+cat "$OUT_TMP/l2_memcpy_large.s" "$OUT_TMP/clib_dma.lib.s" > "$OUT_TMP/l2_memcpy_large_dma.s"
+"$AS" --data-base 0x4000 "$OUT_TMP/l2_memcpy_large_dma.s" -o "$OUT_ELF/l2_memcpy_large_dma.elf"
+DMA_STEPS=""
+for run in 1 2; do
+  OUT_LOG=$(sim --record "$OUT_TMP/l2_memcpy_large_dma.rec" "$OUT_ELF/l2_memcpy_large_dma.elf" 2>&1 < /dev/null || true)
+  echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l2_memcpy_large_dma_sim" >&2; exit 1; }
+  STEPS=$(echo "$OUT_LOG" | sed -n 's/.*halted on ebreak after \([0-9]*\) steps.*/\1/p')
+  [ -n "$STEPS" ] || { echo "FAIL l2_memcpy_large_dma_sim" >&2; exit 1; }
+  [ -z "$DMA_STEPS" ] || [ "$STEPS" = "$DMA_STEPS" ] || { echo "FAIL l2_memcpy_large_dma_sim (steps $DMA_STEPS vs $STEPS)" >&2; exit 1; }
+  DMA_STEPS=$STEPS
+done
+[ "$DMA_STEPS" -lt "$LOOP_STEPS" ] || { echo "FAIL l2_memcpy_large_dma_sim (DMA not used)" >&2; exit 1; }
+echo "PASS l2_memcpy_large_dma_sim"
+
 # l3_printf.c: clib printf (%s/%c/%d)
 "$BIN" --emit-asm "$ROOT_DIR/tests/l3_printf.c" > "$OUT_TMP/l3_printf.s"
 cat "$OUT_TMP/l3_printf.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l3_printf_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l3_printf_full.s" -o "$OUT_ELF/l3_printf.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l3_printf.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l3_printf.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "S=OK C=O D=123" || { echo "FAIL l3_printf_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l3_printf_sim" >&2; exit 1; }
 echo "PASS l3_printf_sim"
@@ -164,7 +229,7 @@ echo "PASS l3_printf_sim"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l4_ctype.c" > "$OUT_TMP/l4_ctype.s"
 cat "$OUT_TMP/l4_ctype.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l4_ctype_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l4_ctype_full.s" -o "$OUT_ELF/l4_ctype.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l4_ctype.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l4_ctype.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l4_ctype_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l4_ctype_sim" >&2; exit 1; }
 echo "PASS l4_ctype_sim"
@@ -173,7 +238,7 @@ echo "PASS l4_ctype_sim"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l5_atoi.c" > "$OUT_TMP/l5_atoi.s"
 cat "$OUT_TMP/l5_atoi.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l5_atoi_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l5_atoi_full.s" -o "$OUT_ELF/l5_atoi.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l5_atoi.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l5_atoi.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l5_atoi_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l5_atoi_sim" >&2; exit 1; }
 echo "PASS l5_atoi_sim"
@@ -182,16 +247,31 @@ echo "PASS l5_atoi_sim"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l5_strtol.c" > "$OUT_TMP/l5_strtol.s"
 cat "$OUT_TMP/l5_strtol.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l5_strtol_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l5_strtol_full.s" -o "$OUT_ELF/l5_strtol.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l5_strtol.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l5_strtol.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l5_strtol_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l5_strtol_sim" >&2; exit 1; }
 echo "PASS l5_strtol_sim"
 
+# l5_files.c: clib host files under --fs-root, with and without -O
+for opt in "" -O; do
+  name=l5_files${opt:+_opt}
+  "$BIN" $opt --emit-asm "$ROOT_DIR/tests/l5_files.c" > "$OUT_TMP/$name.s"
+  cat "$OUT_TMP/$name.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/${name}_full.s"
+  "$AS" --data-base 0x4000 "$OUT_TMP/${name}_full.s" -o "$OUT_ELF/$name.elf"
+  rm -rf "$OUT_TMP/$name.fs"
+  mkdir -p "$OUT_TMP/$name.fs"
+  OUT_LOG=$(sim --fs-root "$OUT_TMP/$name.fs" "$OUT_ELF/$name.elf" 2>&1 || true)
+  echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL ${name}_sim" >&2; exit 1; }
+  echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL ${name}_sim" >&2; exit 1; }
+  [ "$(cat "$OUT_TMP/$name.fs/files.txt")" = "Hello, files" ] || { echo "FAIL ${name}_sim" >&2; exit 1; }
+  echo "PASS ${name}_sim"
+done
+
 # l6_write.c: clib write
 "$BIN" --emit-asm "$ROOT_DIR/tests/l6_write.c" > "$OUT_TMP/l6_write.s"
 cat "$OUT_TMP/l6_write.s" "$OUT_TMP/clib.lib.s" > "$OUT_TMP/l6_write_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l6_write_full.s" -o "$OUT_ELF/l6_write.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l6_write.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l6_write.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l6_write_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l6_write_sim" >&2; exit 1; }
 echo "PASS l6_write_sim"
@@ -200,7 +280,7 @@ echo "PASS l6_write_sim"
 "$BIN" --emit-asm "$ROOT_DIR/tests/l7_malloc.c" > "$OUT_TMP/l7_malloc.s"
 cat "$OUT_TMP/clib.lib.s" "$OUT_TMP/l7_malloc.s" > "$OUT_TMP/l7_malloc_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l7_malloc_full.s" -o "$OUT_ELF/l7_malloc.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l7_malloc.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l7_malloc.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l7_malloc_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l7_malloc_sim" >&2; exit 1; }
 echo "PASS l7_malloc_sim"
@@ -209,7 +289,7 @@ echo "PASS l7_malloc_sim"
 "$BIN" --emit-asm --prefer-libc "$ROOT_DIR/tests/l8_libc_calls.c" > "$OUT_TMP/l8_libc_calls.s"
 cat "$OUT_TMP/clib.lib.s" "$OUT_TMP/l8_libc_calls.s" > "$OUT_TMP/l8_libc_calls_full.s"
 "$AS" --data-base 0x4000 "$OUT_TMP/l8_libc_calls_full.s" -o "$OUT_ELF/l8_libc_calls.elf"
-OUT_LOG=$("$SIM" "$OUT_ELF/l8_libc_calls.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/l8_libc_calls.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL l8_libc_calls_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL l8_libc_calls_sim" >&2; exit 1; }
 echo "PASS l8_libc_calls_sim"
@@ -265,17 +345,17 @@ echo "PASS c3_mul_asm"
 
 # c3 simulator smoke checks (halts on exit)
 "$BIN" -o "$OUT_ELF/c3_return.elf" "$ROOT_DIR/tests/c3_return.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c3_return.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c3_return.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c3_return_sim" >&2; exit 1; }
 echo "PASS c3_return_sim"
 
 "$BIN" -o "$OUT_ELF/c3_add.elf" "$ROOT_DIR/tests/c3_add.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c3_add.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c3_add.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c3_add_sim" >&2; exit 1; }
 echo "PASS c3_add_sim"
 
 "$BIN" -o "$OUT_ELF/c3_mul.elf" "$ROOT_DIR/tests/c3_mul.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c3_mul.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c3_mul.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c3_mul_sim" >&2; exit 1; }
 echo "PASS c3_mul_sim"
 
@@ -296,12 +376,12 @@ echo "PASS c4_reassign_asm"
 
 # c4 simulator smoke checks
 "$BIN" -o "$OUT_ELF/c4_vars.elf" "$ROOT_DIR/tests/c4_vars.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c4_vars.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c4_vars.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c4_vars_sim" >&2; exit 1; }
 echo "PASS c4_vars_sim"
 
 "$BIN" -o "$OUT_ELF/c4_reassign.elf" "$ROOT_DIR/tests/c4_reassign.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c4_reassign.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c4_reassign.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c4_reassign_sim" >&2; exit 1; }
 echo "PASS c4_reassign_sim"
 
@@ -322,12 +402,12 @@ echo "PASS c5_while_asm"
 
 # c5 simulator smoke checks
 "$BIN" -o "$OUT_ELF/c5_if.elf" "$ROOT_DIR/tests/c5_if.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c5_if.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c5_if.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c5_if_sim" >&2; exit 1; }
 echo "PASS c5_if_sim"
 
 "$BIN" -o "$OUT_ELF/c5_while.elf" "$ROOT_DIR/tests/c5_while.c"
-OUT_LOG=$("$SIM" "$OUT_ELF/c5_while.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT_ELF/c5_while.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c5_while_sim" >&2; exit 1; }
 echo "PASS c5_while_sim"
 
@@ -358,189 +438,189 @@ echo "PASS c_label_unique_labels"
 
 # c6 simulator smoke checks
 "$BIN" -o "$OUT/c6_call.elf" "$ROOT_DIR/tests/c6_call.c"
-OUT_LOG=$("$SIM" "$OUT/c6_call.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c6_call.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c6_call_sim" >&2; exit 1; }
 echo "PASS c6_call_sim"
 
 "$BIN" -o "$OUT/c6_nested.elf" "$ROOT_DIR/tests/c6_nested.c"
-OUT_LOG=$("$SIM" "$OUT/c6_nested.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c6_nested.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c6_nested_sim" >&2; exit 1; }
 echo "PASS c6_nested_sim"
 
 # C program smoke tests (compile + run)
 "$BIN" -o "$OUT/c_prog_fib.elf" "$ROOT_DIR/tests/c_prog_fib.c"
-OUT_LOG=$("$SIM" "$OUT/c_prog_fib.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_prog_fib.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_prog_fib_sim" >&2; exit 1; }
 echo "PASS c_prog_fib_sim"
 
 "$BIN" -o "$OUT/c_prog_prime.elf" "$ROOT_DIR/tests/c_prog_prime.c"
-OUT_LOG=$("$SIM" "$OUT/c_prog_prime.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_prog_prime.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_prog_prime_sim" >&2; exit 1; }
 echo "PASS c_prog_prime_sim"
 
 # Complex C program tests
 "$BIN" -o "$OUT/c_prog_structsum.elf" "$ROOT_DIR/tests/c_prog_structsum.c"
-OUT_LOG=$("$SIM" "$OUT/c_prog_structsum.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_prog_structsum.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_prog_structsum_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_prog_structsum_sim" >&2; exit 1; }
 echo "PASS c_prog_structsum_sim"
 
 "$BIN" -o "$OUT/c_prog_unioncalc.elf" "$ROOT_DIR/tests/c_prog_unioncalc.c"
-OUT_LOG=$("$SIM" "$OUT/c_prog_unioncalc.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_prog_unioncalc.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_prog_unioncalc_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_prog_unioncalc_sim" >&2; exit 1; }
 echo "PASS c_prog_unioncalc_sim"
 
 # Stress tests
 "$BIN" -o "$OUT/c_stress_control.elf" "$ROOT_DIR/tests/c_stress_control.c"
-OUT_LOG=$("$SIM" "$OUT/c_stress_control.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_stress_control.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_stress_control_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_stress_control_sim" >&2; exit 1; }
 echo "PASS c_stress_control_sim"
 
 "$BIN" -o "$OUT/c_stress_spill.elf" "$ROOT_DIR/tests/c_stress_spill.c"
-OUT_LOG=$("$SIM" "$OUT/c_stress_spill.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_stress_spill.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_stress_spill_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_stress_spill_sim" >&2; exit 1; }
 echo "PASS c_stress_spill_sim"
 
 "$BIN" -o "$OUT/c_stress_ptrstruct.elf" "$ROOT_DIR/tests/c_stress_ptrstruct.c"
-OUT_LOG=$("$SIM" "$OUT/c_stress_ptrstruct.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_stress_ptrstruct.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_stress_ptrstruct_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_stress_ptrstruct_sim" >&2; exit 1; }
 echo "PASS c_stress_ptrstruct_sim"
 
 "$BIN" -o "$OUT/c_stress_byteword.elf" "$ROOT_DIR/tests/c_stress_byteword.c"
-OUT_LOG=$("$SIM" "$OUT/c_stress_byteword.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_stress_byteword.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_stress_byteword_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_stress_byteword_sim" >&2; exit 1; }
 echo "PASS c_stress_byteword_sim"
 
 "$BIN" -o "$OUT/c_stress_stack.elf" "$ROOT_DIR/tests/c_stress_stack.c"
-OUT_LOG=$("$SIM" "$OUT/c_stress_stack.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c_stress_stack.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c_stress_stack_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c_stress_stack_sim" >&2; exit 1; }
 echo "PASS c_stress_stack_sim"
 
 # C7 globals and strings
 "$BIN" -o "$OUT/c7_global.elf" "$ROOT_DIR/tests/c7_global.c"
-OUT_LOG=$("$SIM" "$OUT/c7_global.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c7_global.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c7_global_sim" >&2; exit 1; }
 echo "PASS c7_global_sim"
 
 "$BIN" -o "$OUT/c7_string.elf" "$ROOT_DIR/tests/c7_string.c"
-OUT_LOG=$("$SIM" "$OUT/c7_string.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c7_string.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c7_string_sim" >&2; exit 1; }
 echo "PASS c7_string_sim"
 
 # C8 bin output check
 "$BIN" --bin -o "$OUT/c8_return.bin" "$ROOT_DIR/tests/c3_return.c"
-OUT_LOG=$("$SIM" "$OUT/c8_return.bin" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c8_return.bin" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c8_bin_sim" >&2; exit 1; }
 echo "PASS c8_bin_sim"
 
 # C9 optimizations
 "$BIN" -O -o "$OUT/c9_fold.elf" "$ROOT_DIR/tests/c9_fold.c"
-OUT_LOG=$("$SIM" "$OUT/c9_fold.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c9_fold.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c9_fold_sim" >&2; exit 1; }
 echo "PASS c9_fold_sim"
 
 "$BIN" -O -o "$OUT/c9_dead.elf" "$ROOT_DIR/tests/c9_dead.c"
-OUT_LOG=$("$SIM" "$OUT/c9_dead.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c9_dead.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c9_dead_sim" >&2; exit 1; }
 echo "PASS c9_dead_sim"
 
 # C10 tests
 "$BIN" -o "$OUT/c10_for_arr.elf" "$ROOT_DIR/tests/c10_for_arr.c"
-OUT_LOG=$("$SIM" "$OUT/c10_for_arr.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_for_arr.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_for_arr_sim" >&2; exit 1; }
 echo "PASS c10_for_arr_sim"
 
 "$BIN" -o "$OUT/c10_switch.elf" "$ROOT_DIR/tests/c10_switch.c"
-OUT_LOG=$("$SIM" "$OUT/c10_switch.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_switch.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_switch_sim" >&2; exit 1; }
 echo "PASS c10_switch_sim"
 
 "$BIN" -o "$OUT/c10_logic.elf" "$ROOT_DIR/tests/c10_logic.c"
-OUT_LOG=$("$SIM" "$OUT/c10_logic.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_logic.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_logic_sim" >&2; exit 1; }
 echo "PASS c10_logic_sim"
 
 "$BIN" -o "$OUT/c10_ptr.elf" "$ROOT_DIR/tests/c10_ptr.c"
-OUT_LOG=$("$SIM" "$OUT/c10_ptr.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_ptr.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_ptr_sim" >&2; exit 1; }
 echo "PASS c10_ptr_sim"
 
 "$BIN" -o "$OUT/c10_addr.elf" "$ROOT_DIR/tests/c10_addr.c"
-OUT_LOG=$("$SIM" "$OUT/c10_addr.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_addr.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_addr_sim" >&2; exit 1; }
 echo "PASS c10_addr_sim"
 
 "$BIN" -o "$OUT/c10_nested.elf" "$ROOT_DIR/tests/c10_nested.c"
-OUT_LOG=$("$SIM" "$OUT/c10_nested.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_nested.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_nested_sim" >&2; exit 1; }
 echo "PASS c10_nested_sim"
 
 "$BIN" -o "$OUT/c10_void.elf" "$ROOT_DIR/tests/c10_void.c"
-OUT_LOG=$("$SIM" "$OUT/c10_void.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_void.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_void_sim" >&2; exit 1; }
 echo "PASS c10_void_sim"
 
 "$BIN" -o "$OUT/c10_putchar.elf" "$ROOT_DIR/tests/c10_putchar.c"
-OUT_LOG=$("$SIM" "$OUT/c10_putchar.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_putchar.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_putchar_sim" >&2; exit 1; }
 echo "PASS c10_putchar_sim"
 
 "$BIN" -o "$OUT/c10_char.elf" "$ROOT_DIR/tests/c10_char.c"
-OUT_LOG=$("$SIM" "$OUT/c10_char.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_char.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_char_sim" >&2; exit 1; }
 echo "PASS c10_char_sim"
 
 "$BIN" -o "$OUT/c10_exit.elf" "$ROOT_DIR/tests/c10_exit.c"
-OUT_LOG=$("$SIM" "$OUT/c10_exit.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_exit.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_exit_sim" >&2; exit 1; }
 echo "PASS c10_exit_sim"
 
 "$BIN" -o "$OUT/c10_spill.elf" "$ROOT_DIR/tests/c10_spill.c"
-OUT_LOG=$("$SIM" "$OUT/c10_spill.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c10_spill.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c10_spill_sim" >&2; exit 1; }
 echo "PASS c10_spill_sim"
 
 # C11 tests
 "$BIN" -o "$OUT/c11_ptrarith.elf" "$ROOT_DIR/tests/c11_ptrarith.c"
-OUT_LOG=$("$SIM" "$OUT/c11_ptrarith.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c11_ptrarith.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c11_ptrarith_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c11_ptrarith_sim" >&2; exit 1; }
 echo "PASS c11_ptrarith_sim"
 
 "$BIN" -o "$OUT/c11_sizeof.elf" "$ROOT_DIR/tests/c11_sizeof.c"
-OUT_LOG=$("$SIM" "$OUT/c11_sizeof.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c11_sizeof.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c11_sizeof_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c11_sizeof_sim" >&2; exit 1; }
 echo "PASS c11_sizeof_sim"
 
 # C12 tests
 "$BIN" -o "$OUT/c12_struct.elf" "$ROOT_DIR/tests/c12_struct.c"
-OUT_LOG=$("$SIM" "$OUT/c12_struct.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c12_struct.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c12_struct_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c12_struct_sim" >&2; exit 1; }
 echo "PASS c12_struct_sim"
 
 "$BIN" -o "$OUT/c12_union.elf" "$ROOT_DIR/tests/c12_union.c"
-OUT_LOG=$("$SIM" "$OUT/c12_union.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c12_union.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c12_union_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c12_union_sim" >&2; exit 1; }
 echo "PASS c12_union_sim"
 
 # C13 tests
 "$BIN" -o "$OUT/c13_include.elf" "$ROOT_DIR/tests/c13_include.c"
-OUT_LOG=$("$SIM" "$OUT/c13_include.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c13_include.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c13_include_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c13_include_sim" >&2; exit 1; }
 echo "PASS c13_include_sim"
 
 "$BIN" -o "$OUT/c13_define.elf" "$ROOT_DIR/tests/c13_define.c"
-OUT_LOG=$("$SIM" "$OUT/c13_define.elf" 2>&1 || true)
+OUT_LOG=$(sim "$OUT/c13_define.elf" 2>&1 || true)
 echo "$OUT_LOG" | grep -q "OK" || { echo "FAIL c13_define_sim" >&2; exit 1; }
 echo "$OUT_LOG" | grep -q "halted on ebreak" || { echo "FAIL c13_define_sim" >&2; exit 1; }
 echo "PASS c13_define_sim"
@@ -58,7 +58,7 @@ int ends_with(const char *s, const char *suffix);
 uint64_t align_up(uint64_t v, uint64_t a);
 int section_from_name(const char *s, SectionKind *out);
 
-int write_elf_file_sections(const char *out_path, const Section *text, const Section *data, const Section *bss, uint64_t entry, uint64_t seg_align);
+int write_elf_file_sections(const char *out_path, const Section *text, const Section *data, const Section *bss, const LabelTable *labels, uint64_t entry, uint64_t seg_align);
 
 void label_add(LabelTable *t, const char *name, uint64_t addr);
 int label_find(const LabelTable *t, const char *name, uint64_t *out);
@@ -89,6 +89,7 @@ int assemble_file(const char *in_path, const char *out_path, bool elf_output, co
 void optimize_text_section(Section *text);
 
 uint32_t csr_addr_from_name(const char *s);
+int amo_from_name(const char *s, uint32_t *funct5, uint32_t *funct3);
 uint32_t tensor_func_from_name(const char *s);
 uint32_t tensor_fmt_from_name(const char *s);
 uint32_t tensor_redop_from_name(const char *s);
@@ -458,6 +458,13 @@ int assemble_line(Section *sec, SectionKind kind, char *tokens[], int count, con
     if (strcmp(op, "ebreak") == 0) { buf_write_u32(&sec->buf, encode_i(0x001, 0, 0, 0, 0x73)); sec->pc += 4; return 1; }
     if (strcmp(op, "mret") == 0) { buf_write_u32(&sec->buf, encode_i(0x302, 0, 0, 0, 0x73)); sec->pc += 4; return 1; }
     if (strcmp(op, "sret") == 0) { buf_write_u32(&sec->buf, encode_i(0x102, 0, 0, 0, 0x73)); sec->pc += 4; return 1; }
+    if (strcmp(op, "wfi") == 0) { buf_write_u32(&sec->buf, encode_i(0x105, 0, 0, 0, 0x73)); sec->pc += 4; return 1; }
+    if (strcmp(op, "sfence.vma") == 0) {
+        int rs1 = count >= 2 ? parse_reg(tokens[1]) : 0;
+        int rs2 = count >= 3 ? parse_reg(tokens[2]) : 0;
+        if (rs1 < 0 || rs2 < 0) return 0;
+        buf_write_u32(&sec->buf, encode_r(0x09, (uint32_t)rs2, (uint32_t)rs1, 0x0, 0, 0x73)); sec->pc += 4; return 1;
+    }
     if (strcmp(op, "fence") == 0) { buf_write_u32(&sec->buf, encode_i(0x000, 0, 0, 0, 0x0F)); sec->pc += 4; return 1; }
 
     if (strcmp(op, "jal") == 0 && count >= 3) {
@@ -579,13 +586,16 @@ int assemble_line(Section *sec, SectionKind kind, char *tokens[], int count, con
         buf_write_u32(&sec->buf, encode_r(f7, rs2, rs1, f3, rd, 0x33)); sec->pc += 4; return 1;
     }
 
-    // AMO
-    if ((strcmp(op, "amoswap.w") == 0 || strcmp(op, "amoswap.d") == 0) && count >= 4) {
+    // AMO: op.w / op.d rd, rs1(addr), rs2; lr.w / lr.d rd, rs1
+    uint32_t amo_f5, amo_f3;
+    if (amo_from_name(op, &amo_f5, &amo_f3)) {
+        bool is_lr = (amo_f5 == 0x02);
+        if (count < (is_lr ? 3 : 4)) return 0;
         int rd = parse_reg(tokens[1]);
         int rs1 = parse_reg(tokens[2]);
-        int rs2 = parse_reg(tokens[3]);
-        uint32_t f3 = (strcmp(op, "amoswap.w") == 0) ? 0x2 : 0x3;
-        buf_write_u32(&sec->buf, encode_r(0x04, rs2, rs1, f3, rd, 0x2F)); sec->pc += 4; return 1;
+        int rs2 = is_lr ? 0 : parse_reg(tokens[3]);
+        if (rd < 0 || rs1 < 0 || rs2 < 0) return 0;
+        buf_write_u32(&sec->buf, encode_r(amo_f5 << 2, rs2, rs1, amo_f3, rd, 0x2F)); sec->pc += 4; return 1;
     }
 
     // CSR
@@ -674,6 +684,11 @@ int assemble_line(Section *sec, SectionKind kind, char *tokens[], int count, con
         int rs1 = parse_reg(tokens[2]);
         buf_write_u32(&sec->buf, encode_i(0, rs1, 0x6, trd, 0x5B)); sec->pc += 4; return 1;
     }
+    if ((strcmp(op, "tsave") == 0 || strcmp(op, "trestore") == 0) && count >= 2) {
+        int rs1 = parse_reg(tokens[1]);
+        int32_t sel = (strcmp(op, "tsave") == 0) ? 0 : 1;
+        buf_write_u32(&sec->buf, encode_i(sel, rs1, 0x7, 0, 0x5B)); sec->pc += 4; return 1;
+    }
 
     return 0;
 }
@@ -907,7 +922,7 @@ int assemble_file(const char *in_path, const char *out_path, bool elf_output, co
 
     int ok_write = 1;
     if (elf_output) {
-        ok_write = write_elf_file_sections(out_path, &text, &data, &bss, entry, opt->seg_align);
+        ok_write = write_elf_file_sections(out_path, &text, &data, &bss, labels, entry, opt->seg_align);
     } else {
         FILE *out = fopen(out_path, "wb");
         if (!out) ok_write = 0;
@@ -1,4 +1,5 @@
 #include "asm.h"
+#include <stdlib.h>
 #include <string.h>
 
 #define ELF_MAGIC0 0x7F
@@ -13,6 +14,14 @@
 #define PF_X 1
 #define PF_W 2
 #define PF_R 4
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+#define SHN_ABS 0xFFF1
+#define STB_LOCAL 0
+#define STB_GLOBAL 1
+#define STT_NOTYPE 0
+#define STT_OBJECT 1
+#define STT_FUNC 2
 
 typedef struct {
     unsigned char e_ident[16];
@@ -42,7 +51,108 @@ typedef struct {
     uint64_t p_align;
 } Elf64_Phdr;
 
-int write_elf_file_sections(const char *out_path, const Section *text, const Section *data, const Section *bss, uint64_t entry, uint64_t seg_align) {
+typedef struct {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+} Elf64_Shdr;
+
+typedef struct {
+    uint32_t st_name;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+} Elf64_Sym;
+
+static const char shstrtab[] = "\0.symtab\0.strtab\0.shstrtab";
+#define SHSTR_SYMTAB 1
+#define SHSTR_STRTAB 9
+#define SHSTR_SHSTRTAB 17
+
+// Labels go out as absolute symbols (the image has no PROGBITS section
+// headers to point at), so tools such as the simulator's coverage report
+// can name code addresses. Compiler-generated ".L" labels stay local, and
+// ELF requires locals to precede globals.
+static int write_symbols(FILE *out, Elf64_Ehdr *eh, const Section *text, const LabelTable *labels) {
+    size_t n = labels ? (size_t)labels->count : 0;
+    Elf64_Sym *syms = (Elf64_Sym *)calloc(n + 1, sizeof(Elf64_Sym));
+    Buffer str = {0};
+    if (!syms) return 0;
+    buf_write_u8(&str, 0);
+
+    size_t nsym = 1;
+    uint32_t first_global = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < n; i++) {
+            const Label *l = &labels->labels[i];
+            int local = strncmp(l->name, ".L", 2) == 0;
+            if (local != (pass == 0)) continue;
+            int in_text = l->addr >= text->base && l->addr < text->base + text->buf.size;
+            Elf64_Sym *s = &syms[nsym++];
+            s->st_name = (uint32_t)str.size;
+            s->st_info = (unsigned char)(((local ? STB_LOCAL : STB_GLOBAL) << 4) |
+                                         (local ? STT_NOTYPE : in_text ? STT_FUNC : STT_OBJECT));
+            s->st_shndx = SHN_ABS;
+            s->st_value = l->addr;
+            buf_write(&str, l->name, strlen(l->name) + 1);
+        }
+        if (pass == 0) first_global = (uint32_t)nsym;
+    }
+
+    long pos = ftell(out);
+    if (pos < 0) { free(syms); free(str.data); return 0; }
+    uint64_t off = align_up((uint64_t)pos, 8);
+    for (uint64_t p = (uint64_t)pos; p < off; p++) fputc(0, out);
+
+    Elf64_Shdr sh[4];
+    memset(sh, 0, sizeof(sh));
+    sh[1].sh_name = SHSTR_SYMTAB;
+    sh[1].sh_type = SHT_SYMTAB;
+    sh[1].sh_offset = off;
+    sh[1].sh_size = nsym * sizeof(Elf64_Sym);
+    sh[1].sh_link = 2;
+    sh[1].sh_info = first_global;
+    sh[1].sh_addralign = 8;
+    sh[1].sh_entsize = sizeof(Elf64_Sym);
+    sh[2].sh_name = SHSTR_STRTAB;
+    sh[2].sh_type = SHT_STRTAB;
+    sh[2].sh_offset = sh[1].sh_offset + sh[1].sh_size;
+    sh[2].sh_size = str.size;
+    sh[2].sh_addralign = 1;
+    sh[3].sh_name = SHSTR_SHSTRTAB;
+    sh[3].sh_type = SHT_STRTAB;
+    sh[3].sh_offset = sh[2].sh_offset + sh[2].sh_size;
+    sh[3].sh_size = sizeof(shstrtab);
+    sh[3].sh_addralign = 1;
+    uint64_t shoff = align_up(sh[3].sh_offset + sh[3].sh_size, 8);
+
+    int ok = fwrite(syms, sizeof(Elf64_Sym), nsym, out) == nsym &&
+             fwrite(str.data, 1, str.size, out) == str.size &&
+             fwrite(shstrtab, 1, sizeof(shstrtab), out) == sizeof(shstrtab);
+    free(syms);
+    free(str.data);
+    if (!ok) return 0;
+    for (uint64_t p = sh[3].sh_offset + sh[3].sh_size; p < shoff; p++) fputc(0, out);
+    if (fwrite(sh, sizeof(Elf64_Shdr), 4, out) != 4) return 0;
+
+    eh->e_shoff = shoff;
+    eh->e_shentsize = sizeof(Elf64_Shdr);
+    eh->e_shnum = 4;
+    eh->e_shstrndx = 3;
+    if (fseek(out, 0, SEEK_SET) != 0) return 0;
+    return fwrite(eh, 1, sizeof(*eh), out) == sizeof(*eh);
+}
+
+int write_elf_file_sections(const char *out_path, const Section *text, const Section *data, const Section *bss, const LabelTable *labels, uint64_t entry, uint64_t seg_align) {
     FILE *out = fopen(out_path, "wb");
     if (!out) return 0;
 
@@ -141,6 +251,7 @@ int write_elf_file_sections(const char *out_path, const Section *text, const Sec
         if (size > 0 && fwrite(buf, 1, size, out) != size) { fclose(out); return 0; }
     }
 
+    if (!write_symbols(out, &eh, text, labels)) { fclose(out); return 0; }
     fclose(out);
     return 1;
 }
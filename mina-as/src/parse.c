@@ -86,9 +86,29 @@ uint32_t csr_addr_from_name(const char *s) {
     if (strcmp(s, "sepc") == 0) return 0x141;
     if (strcmp(s, "scause") == 0) return 0x142;
     if (strcmp(s, "stval") == 0) return 0x143;
+    if (strcmp(s, "satp") == 0) return 0x180;
     return 0xFFFFFFFFu;
 }
 
+int amo_from_name(const char *s, uint32_t *funct5, uint32_t *funct3) {
+    static const struct { const char *name; uint32_t funct5; } ops[] = {
+        {"amoadd", 0x00}, {"amoswap", 0x01}, {"lr", 0x02}, {"sc", 0x03},
+        {"amoxor", 0x04}, {"amoor", 0x08}, {"amoand", 0x0C}, {"amomin", 0x10},
+        {"amomax", 0x14}, {"amominu", 0x18}, {"amomaxu", 0x1C},
+    };
+    const char *dot = strrchr(s, '.');
+    if (!dot || (strcmp(dot, ".w") != 0 && strcmp(dot, ".d") != 0)) return 0;
+    size_t n = (size_t)(dot - s);
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (strlen(ops[i].name) == n && strncmp(s, ops[i].name, n) == 0) {
+            *funct5 = ops[i].funct5;
+            *funct3 = (dot[1] == 'w') ? 0x2 : 0x3;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 uint32_t tensor_func_from_name(const char *s) {
     if (strcmp(s, "relu") == 0) return 0;
     if (strcmp(s, "gelu") == 0) return 1;
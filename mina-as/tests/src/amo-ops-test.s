@@ -0,0 +1,130 @@
+.org 0x0000
+
+# AMO arithmetic/logic/min/max (.w sign-extends, .d full width) and lr/sc:
+# success, sc without a reservation, sc after the value changed.
+
+start:
+    li   r1, data_d
+    li   r2, data_w
+
+    # amoadd.d: 40 + 2
+    addi r3, r0, 40
+    st   r3, 0(r1)
+    addi r4, r0, 2
+    amoadd.d r5, r1, r4
+    bne  r5, r3, fail
+    ld   r6, 0(r1)
+    addi r7, r0, 42
+    bne  r6, r7, fail
+
+    # amoand/amoor/amoxor.d on 0b1100
+    addi r3, r0, 12
+    st   r3, 0(r1)
+    addi r4, r0, 10
+    amoand.d r5, r1, r4
+    ld   r6, 0(r1)
+    addi r7, r0, 8
+    bne  r6, r7, fail
+    amoor.d r5, r1, r4
+    ld   r6, 0(r1)
+    addi r7, r0, 10
+    bne  r6, r7, fail
+    addi r4, r0, 3
+    amoxor.d r5, r1, r4
+    ld   r6, 0(r1)
+    addi r7, r0, 9
+    bne  r6, r7, fail
+
+    # signed vs unsigned min/max with -1 and 5
+    addi r3, r0, -1
+    st   r3, 0(r1)
+    addi r4, r0, 5
+    amomin.d r5, r1, r4
+    ld   r6, 0(r1)
+    bne  r6, r3, fail
+    amomax.d r5, r1, r4
+    ld   r6, 0(r1)
+    bne  r6, r4, fail
+    st   r3, 0(r1)
+    amominu.d r5, r1, r4
+    ld   r6, 0(r1)
+    bne  r6, r4, fail
+    addi r4, r0, -2
+    amomaxu.d r5, r1, r4
+    ld   r6, 0(r1)
+    bne  r6, r4, fail
+
+    # .w: old value sign-extended, 32-bit wraparound on add
+    addi r3, r0, -1
+    srli r3, r3, 33
+    stw  r3, 0(r2)
+    addi r4, r0, 1
+    amoadd.w r5, r2, r4
+    bne  r5, r3, fail
+    amoadd.w r5, r2, r0
+    addi r7, r0, 1
+    slli r7, r7, 31
+    slli r7, r7, 32
+    srai r7, r7, 32
+    bne  r5, r7, fail
+    addi r4, r0, 3
+    amominu.w r5, r2, r4
+    ldwu r6, 0(r2)
+    bne  r6, r4, fail
+
+    # lr/sc success
+    addi r3, r0, 100
+    st   r3, 0(r1)
+    lr.d r5, r1
+    bne  r5, r3, fail
+    addi r5, r5, 1
+    sc.d r6, r1, r5
+    bne  r6, r0, fail
+    ld   r6, 0(r1)
+    addi r7, r0, 101
+    bne  r6, r7, fail
+
+    # sc without a reservation fails and leaves memory alone
+    addi r4, r0, 7
+    sc.d r6, r1, r4
+    addi r7, r0, 1
+    bne  r6, r7, fail
+    ld   r6, 0(r1)
+    addi r7, r0, 101
+    bne  r6, r7, fail
+
+    # value changed between lr and sc -> sc fails
+    lr.w r5, r2
+    addi r4, r0, 9
+    stw  r4, 0(r2)
+    sc.w r6, r2, r0
+    beq  r6, r0, fail
+    ldw  r6, 0(r2)
+    bne  r6, r4, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 11
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 13
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 97, 109, 111, 45, 111, 112, 115, 58, 79, 75, 10
+msg_fail:
+    .byte 97, 109, 111, 45, 111, 112, 115, 58, 70, 65, 73, 76, 10
+
+.align 4
+data_d:
+    .dword 0
+data_w:
+    .word 0
+    .word 0
@@ -0,0 +1,120 @@
+.org 0x0000
+
+# Block device: one batch of two descriptors (write sector 1, read it
+# back), completion via mip.SEIP. Run with --blk on an 8-sector image.
+
+start:
+    addi r1, r0, handler
+    csrrw r2, mtvec, r1
+
+    li   r20, 0x10001000
+    ld   r1, 0(r20)          # MAGIC
+    li   r2, 0x4B4C424D
+    bne  r1, r2, fail
+    ld   r1, 8(r20)          # CAPACITY
+    addi r2, r0, 8
+    bne  r1, r2, fail
+
+    # fill 512 bytes at 0x8000 with i & 0xFF
+    li   r5, 0x8000
+    addi r6, r0, 0
+    addi r7, r0, 512
+fill:
+    add  r8, r5, r6
+    stb  r6, 0(r8)
+    addi r6, r6, 1
+    bne  r6, r7, fill
+
+    # descriptors: ring of 4 at 0x7000
+    li   r21, 0x7000
+    addi r1, r0, 1           # OUT
+    stw  r1, 0(r21)
+    addi r1, r0, -1
+    stw  r1, 4(r21)
+    addi r1, r0, 1           # sector 1
+    st   r1, 8(r21)
+    st   r5, 16(r21)
+    st   r7, 24(r21)
+    stw  r0, 32(r21)         # IN
+    addi r1, r0, -1
+    stw  r1, 36(r21)
+    addi r1, r0, 1
+    st   r1, 40(r21)
+    li   r1, 0x9000
+    st   r1, 48(r21)
+    st   r7, 56(r21)
+
+    st   r21, 16(r20)        # QUEUE_ADDR
+    addi r1, r0, 4
+    st   r1, 24(r20)         # QUEUE_SIZE
+    addi r1, r0, 1
+    st   r1, 56(r20)         # CTRL.IE
+
+    # enable SEIE and MIE
+    addi r1, r0, 0x200
+    csrrw r2, mie, r1
+    addi r1, r0, 1
+    csrrs r0, mstatus, r1
+
+    addi r1, r0, 2
+    st   r1, 32(r20)         # NOTIFY: avail = 2
+
+idle:
+    wfi
+    j    idle
+
+handler:
+    csrrw r1, mcause, r0
+    slt  r4, r1, r0
+    beq  r4, r0, fail
+    andi r4, r1, 0xFF
+    addi r3, r0, 9
+    bne  r4, r3, fail
+
+wait_used:
+    ld   r1, 40(r20)         # USED
+    addi r2, r0, 2
+    bne  r1, r2, wait_used
+
+    ldwu r1, 4(r21)
+    bne  r1, r0, fail
+    ldwu r1, 36(r21)
+    bne  r1, r0, fail
+
+    # compare 0x8000 and 0x9000
+    li   r5, 0x8000
+    li   r9, 0x9000
+    addi r6, r0, 0
+cmp:
+    add  r8, r5, r6
+    ldbu r10, 0(r8)
+    add  r8, r9, r6
+    ldbu r11, 0(r8)
+    bne  r10, r11, fail
+    addi r6, r6, 1
+    bne  r6, r7, cmp
+
+    addi r1, r0, 1
+    st   r1, 48(r20)         # ack ISR
+    ld   r1, 48(r20)
+    bne  r1, r0, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 7
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 98, 108, 107, 58, 79, 75, 10
+msg_fail:
+    .byte 98, 108, 107, 58, 70, 65, 73, 76, 10
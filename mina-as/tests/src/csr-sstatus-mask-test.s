@@ -8,7 +8,7 @@ start:
     csrrw r0, sstatus, r2
 
     csrrs r3, sstatus, r0
-    li   r4, 0x2722
+    li   r4, 0xC2722
     bne  r3, r4, fail
 
     jal  r31, print_ok
@@ -0,0 +1,111 @@
+.org 0x0000
+
+# DMA engine: 2D fill (polled), 2D copy (interrupt), out-of-range error.
+
+start:
+    addi r1, r0, handler
+    csrrw r2, mtvec, r1
+    li   r20, 0x10002000
+
+    # fill 4 rows x 8 bytes of 0x5A at 0x8000, row stride 16
+    li   r1, 0x8000
+    st   r1, 8(r20)          # DST
+    addi r1, r0, 8
+    st   r1, 16(r20)         # LEN
+    addi r1, r0, 4
+    st   r1, 24(r20)         # ROWS
+    addi r1, r0, 16
+    st   r1, 40(r20)         # DST_STRIDE
+    addi r1, r0, 0x5A
+    st   r1, 48(r20)         # FILL
+    addi r1, r0, 2
+    st   r1, 56(r20)         # CTRL.FILL
+    st   r0, 64(r20)         # START
+poll:
+    ld   r1, 72(r20)
+    andi r2, r1, 2
+    beq  r2, r0, poll
+    andi r2, r1, 4
+    bne  r2, r0, fail
+    addi r1, r0, 2
+    st   r1, 72(r20)         # clear DONE
+
+    # row 3 byte 7 filled, gap byte 8 untouched
+    li   r5, 0x8037
+    ldbu r1, 0(r5)
+    addi r2, r0, 0x5A
+    bne  r1, r2, fail
+    ldbu r1, 1(r5)
+    bne  r1, r0, fail
+
+    # gather the 4 rows into 32 contiguous bytes at 0x9000
+    li   r1, 0x8000
+    st   r1, 0(r20)          # SRC
+    li   r1, 0x9000
+    st   r1, 8(r20)          # DST
+    addi r1, r0, 16
+    st   r1, 32(r20)         # SRC_STRIDE
+    addi r1, r0, 8
+    st   r1, 40(r20)         # DST_STRIDE
+    addi r1, r0, 1
+    st   r1, 56(r20)         # CTRL.IE, copy mode
+    addi r1, r0, 0x200
+    csrrw r2, mie, r1
+    addi r1, r0, 1
+    csrrs r0, mstatus, r1
+    st   r0, 64(r20)         # START
+idle:
+    wfi
+    j    idle
+
+handler:
+    csrrw r1, mcause, r0
+    andi r4, r1, 0xFF
+    addi r3, r0, 9
+    bne  r4, r3, fail
+    csrrw r0, mie, r0
+    addi r1, r0, 2
+    st   r1, 72(r20)         # clear DONE
+
+    li   r5, 0x9000
+    addi r6, r0, 0
+    addi r7, r0, 32
+    addi r3, r0, 0x5A
+check:
+    add  r8, r5, r6
+    ldbu r1, 0(r8)
+    bne  r1, r3, fail
+    addi r6, r6, 1
+    bne  r6, r7, check
+    ldbu r1, 32(r5)
+    bne  r1, r0, fail
+
+    # source outside RAM -> ERR
+    li   r1, 0x7FFFFFF0
+    st   r1, 0(r20)
+    st   r0, 56(r20)
+    st   r0, 64(r20)
+    ld   r1, 72(r20)
+    andi r2, r1, 6
+    addi r3, r0, 6
+    bne  r2, r3, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 7
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 100, 109, 97, 58, 79, 75, 10
+msg_fail:
+    .byte 100, 109, 97, 58, 70, 65, 73, 76, 10
@@ -0,0 +1,54 @@
+.org 0x0000
+
+# Fuzz target for --forkserver --fork-pc 0x40: the prefix stores a marker
+# that every child must still see, then one input byte picks a path.
+#   'A' -> exit 7, 'C' -> misaligned load with no handler (crash),
+#   anything else -> exit 0; a lost marker exits 9.
+
+start:
+    li   r5, state
+    addi r1, r0, 0x55
+    st   r1, 0(r5)
+    jal  r0, fuzz
+
+.org 0x0040
+fuzz:
+    li   r5, state
+    ld   r1, 0(r5)
+    addi r2, r0, 0x55
+    bne  r1, r2, bad
+
+    li   r10, 0
+    li   r11, buf
+    li   r12, 1
+    li   r17, 2
+    ecall
+
+    li   r5, buf
+    ldbu r1, 0(r5)
+    addi r2, r0, 65
+    beq  r1, r2, path_a
+    addi r2, r0, 67
+    beq  r1, r2, crash
+    li   r10, 0
+    li   r17, 3
+    ecall
+
+path_a:
+    li   r10, 7
+    li   r17, 3
+    ecall
+
+crash:
+    ld   r1, 1(r5)
+
+bad:
+    li   r10, 9
+    li   r17, 3
+    ecall
+
+.align 4
+state:
+    .dword 0
+buf:
+    .dword 0
@@ -0,0 +1,73 @@
+.org 0x0000
+
+# Instruction pairs the simulator runs fused: li (movhi+addi), slt+beq/bne,
+# ld+addi and the addi sp / st ra prologue. Results must match unfused
+# execution; run.sh also checks the fusion counters.
+
+start:
+    li   r5, 0x12345
+    li   r6, 0x12345
+    addi r7, r0, 0x345
+    sub  r6, r6, r7
+    srli r6, r6, 12
+    addi r7, r0, 0x12
+    bne  r6, r7, fail
+
+    # sum a 4-element array: ld+addi pointer bump, sltu+bne loop test
+    li   r1, array
+    li   r2, array_end
+    addi r3, r0, 0
+sum:
+    ld   r4, 0(r1)
+    addi r1, r1, 8
+    add  r3, r3, r4
+    sltu r8, r1, r2
+    bne  r8, r0, sum
+    addi r7, r0, 100
+    bne  r3, r7, fail
+
+    # slt+beq both ways
+    addi r8, r0, -1
+    slt  r9, r8, r0
+    beq  r9, r0, fail
+    slt  r9, r0, r8
+    bne  r9, r0, fail
+
+    # call through a prologue/epilogue; the callee sees its own ra on the stack
+    jal  r31, leaf
+    bne  r10, r31, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 8
+    li   r17, 1
+    ecall
+    ebreak
+
+leaf:
+    addi r30, r30, -16
+    st   r31, 8(r30)
+    ld   r10, 8(r30)
+    addi r30, r30, 16
+    jalr r0, r31, 0
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 10
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 102, 117, 115, 101, 58, 79, 75, 10
+msg_fail:
+    .byte 102, 117, 115, 101, 58, 70, 65, 73, 76, 10
+
+.align 3
+array:
+    .dword 10
+    .dword 20
+    .dword 30
+    .dword 40
+array_end:
@@ -0,0 +1,94 @@
+.org 0x0000
+
+start:
+    # escaping the sandbox is refused
+    li   r10, bad_path
+    li   r11, 0        # O_RDONLY
+    li   r12, 0
+    li   r17, 6        # SYS_open
+    ecall
+    blt  r10, r0, open_file
+    ebreak
+
+open_file:
+    li   r10, path
+    li   r11, 0x242    # O_RDWR | O_CREAT | O_TRUNC
+    li   r12, 0x1a4    # 0644
+    li   r17, 6        # SYS_open
+    ecall
+    blt  r10, r0, fail
+    add  r20, r10, r0  # fd
+
+    add  r10, r20, r0
+    li   r11, msg
+    li   r12, 8
+    li   r13, 0
+    li   r17, 10       # SYS_pwrite
+    ecall
+    addi r1, r0, 8
+    bne  r10, r1, fail
+
+    # fstat: size == 8
+    addi r30, r30, -32
+    add  r10, r20, r0
+    add  r11, r30, r0
+    li   r17, 11       # SYS_fstat
+    ecall
+    bne  r10, r0, fail
+    ld   r1, 0, r30
+    addi r2, r0, 8
+    bne  r1, r2, fail
+
+    # pread the tail "OK\n" into the stack buffer
+    add  r10, r20, r0
+    add  r11, r30, r0
+    li   r12, 16
+    li   r13, 5
+    li   r17, 9        # SYS_pread
+    ecall
+    addi r1, r0, 3
+    bne  r10, r1, fail
+
+    # lseek + read the head "file:" into buf
+    add  r10, r20, r0
+    li   r11, 0
+    li   r12, 0        # SEEK_SET
+    li   r17, 8        # SYS_lseek
+    ecall
+    bne  r10, r0, fail
+    add  r10, r20, r0
+    li   r11, buf
+    li   r12, 5
+    li   r17, 2        # SYS_read
+    ecall
+    addi r1, r0, 5
+    bne  r10, r1, fail
+
+    add  r10, r20, r0
+    li   r17, 7        # SYS_close
+    ecall
+    bne  r10, r0, fail
+
+    li   r10, 1
+    li   r11, buf
+    li   r12, 5
+    li   r17, 1
+    ecall
+    li   r10, 1
+    add  r11, r30, r0
+    li   r12, 3
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    ebreak
+
+bad_path:
+    .byte 46, 46, 47, 120, 0
+path:
+    .byte 116, 46, 116, 120, 116, 0
+msg:
+    .byte 102, 105, 108, 101, 58, 79, 75, 10
+buf:
+    .byte 0, 0, 0, 0, 0, 0, 0, 0
@@ -0,0 +1,114 @@
+.org 0x0000
+
+# Memory syscalls: strlen, memcpy, memcmp and memset on guest buffers,
+# the cycle charge for a bulk memset, then a memcpy from U-mode past the
+# DDC bounds, which takes a capability fault without copying.
+start:
+    li   r1, handler
+    csrrw r2, mtvec, r1
+
+    li   r10, src
+    li   r17, 15       # SYS_strlen
+    ecall
+    addi r1, r0, 15
+    bne  r10, r1, fail
+
+    li   r10, dst
+    li   r11, src
+    li   r12, 15
+    li   r17, 12       # SYS_memcpy
+    ecall
+    li   r1, dst
+    bne  r10, r1, fail
+
+    li   r10, dst
+    li   r11, src
+    li   r12, 15
+    li   r17, 14       # SYS_memcmp
+    ecall
+    bne  r10, r0, fail
+
+    li   r10, dst
+    addi r11, r0, 120  # 'x'
+    li   r12, 5
+    li   r17, 13       # SYS_memset
+    ecall
+
+    # 'x' - 'h'
+    li   r10, dst
+    li   r11, src
+    li   r12, 15
+    li   r17, 14
+    ecall
+    addi r1, r0, 16
+    bne  r10, r1, fail
+
+    li   r10, 1
+    li   r11, dst
+    li   r12, 15
+    li   r17, 1
+    ecall
+
+    # 800 bytes at the default 1 cycle per 8 bytes: 100 cycles plus the
+    # few instructions in between.
+    csrrs r5, 0xC00, r0   # cycle
+    li   r10, big
+    addi r11, r0, 0
+    li   r12, 800
+    li   r17, 13
+    ecall
+    csrrs r6, 0xC00, r0
+    sub  r6, r6, r5
+    addi r1, r0, 100
+    blt  r6, r1, fail
+    addi r1, r0, 110
+    bge  r6, r1, fail
+
+    # DDC = [0, big), then drop to U-mode (MPP = 0).
+    li   r3, big
+    csetbounds c0, c0, r3
+    li   r1, user
+    csrrw r2, mepc, r1
+    mret
+
+user:
+    li   r10, big
+    li   r11, src
+    li   r12, 15
+    li   r17, 12
+    ecall
+    j    fail
+
+handler:
+    csrrw r1, mcause, r0
+    addi r2, r0, 11
+    bne  r1, r2, fail
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 11
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 13
+    li   r17, 1
+    ecall
+    ebreak
+
+src:
+    .ascii "hello, memcall"
+    .byte 10
+dst:
+    .zero 16
+msg_ok:
+    .ascii "memcall:OK"
+    .byte 10
+msg_fail:
+    .ascii "memcall:FAIL"
+    .byte 10
+.align 3
+big:
+    .zero 800
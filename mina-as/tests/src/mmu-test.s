@@ -0,0 +1,127 @@
+.org 0x0000
+
+# Sv39 MMU: superpage identity map, 4 KiB page with A/D update, load and
+# fetch page faults, stale TLB entry until sfence.vma.
+#   root  0x10000: [0] -> L1 0x11000
+#   L1    0x11000: [0] = 2 MiB leaf at PA 0 (RWX), [1] -> L0 0x12000
+#   L0    0x12000: [5] = VA 0x205000 -> PA 0x30000 (RW, D clear)
+
+start:
+    addi r1, r0, handler
+    csrrw r2, mtvec, r1
+
+    li   r5, 0x10000
+    li   r1, 0x4401
+    st   r1, 0(r5)
+    li   r5, 0x11000
+    addi r1, r0, 0xCF
+    st   r1, 0(r5)
+    li   r1, 0x4801
+    st   r1, 8(r5)
+    li   r5, 0x12000
+    li   r1, 0xC047
+    st   r1, 40(r5)
+    li   r5, 0x31008
+    li   r1, 0x777
+    st   r1, 0(r5)
+
+    # satp = Sv39 | root PPN 0x10
+    addi r1, r0, 8
+    slli r1, r1, 60
+    ori  r1, r1, 0x10
+    csrrw r0, satp, r1
+
+    # enter S-mode at s_main (MPP = S, CAP off)
+    addi r1, r0, s_main
+    csrrw r2, mepc, r1
+    li   r1, 0x800
+    csrrw r0, mstatus, r1
+    mret
+
+s_main:
+    # store through the 4 KiB page, read back via VA and via identity map
+    li   r5, 0x205008
+    li   r1, 0x1234
+    st   r1, 0(r5)
+    ld   r2, 0(r5)
+    bne  r1, r2, fail
+    li   r6, 0x30008
+    ld   r2, 0(r6)
+    bne  r1, r2, fail
+
+    # walker set A and D in the leaf PTE
+    li   r6, 0x12000
+    ld   r2, 40(r6)
+    andi r2, r2, 0xC0
+    addi r3, r0, 0xC0
+    bne  r2, r3, fail
+
+    # unmapped page -> load page fault (13), tval = VA
+    addi r20, r0, 0
+    li   r5, 0x201000
+    ld   r2, 0(r5)
+    addi r3, r0, 13
+    bne  r20, r3, fail
+    bne  r21, r5, fail
+
+    # remap VA 0x205000 -> PA 0x31000: stale until sfence.vma
+    li   r6, 0x12000
+    li   r1, 0xC447
+    st   r1, 40(r6)
+    li   r5, 0x205008
+    ld   r2, 0(r5)
+    li   r3, 0x1234
+    bne  r2, r3, fail
+    sfence.vma r5, r0
+    ld   r2, 0(r5)
+    li   r3, 0x777
+    bne  r2, r3, fail
+
+    # fetch from an unmapped page -> instruction page fault (12)
+    addi r20, r0, 0
+    li   r5, 0x201000
+    jalr r31, r5, 0
+    addi r3, r0, 12
+    bne  r20, r3, fail
+    bne  r21, r5, fail
+
+    # TLB counters advanced
+    csrrs r1, 0xC03, r0
+    beq  r1, r0, fail
+    csrrs r1, 0xC04, r0
+    beq  r1, r0, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 7
+    li   r17, 1
+    ecall
+    ebreak
+
+# M-mode: record cause/tval, resume after the faulting load or at the
+# return address of a faulting jump.
+handler:
+    csrrs r20, mcause, r0
+    csrrs r21, mtval, r0
+    addi r3, r0, 12
+    beq  r20, r3, handler_fetch
+    csrrs r1, mepc, r0
+    addi r1, r1, 4
+    csrrw r0, mepc, r1
+    mret
+handler_fetch:
+    csrrw r0, mepc, r31
+    mret
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 109, 109, 117, 58, 79, 75, 10
+msg_fail:
+    .byte 109, 109, 117, 58, 70, 65, 73, 76, 10
@@ -0,0 +1,37 @@
+.org 0x0000
+
+# Console input whose timing shows in the instruction count: spin on UART
+# STATUS until the first byte arrives, echo it, then echo whatever each
+# read syscall returns until EOF.
+
+start:
+    # UART TX 0x10000000, RX 0x10000004, STATUS 0x10000008
+    movhi r10, 0x10000
+    addi r11, r10, 4
+    addi r12, r10, 8
+
+wait:
+    ldbu r1, 0, r12
+    beq  r1, r0, wait
+    ldbu r1, 0, r11
+    stb  r1, 0, r10
+
+copy:
+    li   r10, 0
+    li   r11, buf
+    li   r12, 64
+    li   r17, 2
+    ecall
+    beq  r10, r0, done
+    add  r12, r10, r0
+    li   r10, 1
+    li   r11, buf
+    li   r17, 1
+    ecall
+    j    copy
+
+done:
+    ebreak
+
+buf:
+    .zero 64
@@ -0,0 +1,97 @@
+.org 0x0000
+
+# Run with --rom 1000:1000. Loads from the ROM page work. A store, a
+# tsave, a read syscall, a memset syscall and a DMA fill aimed at it are
+# all rejected: the CPU paths take store access faults (mcause 7), the
+# DMA engine reports an error, and the page is left unchanged.
+start:
+    addi r1, r0, handler
+    csrrw r2, mtvec, r1
+    li   r21, 0              # store faults taken
+    li   r3, rom
+
+    ldbu r4, 0(r3)
+    addi r1, r0, 0x5A
+    bne  r4, r1, fail
+
+    addi r5, r0, 1
+    stb  r5, 0(r3)
+    st   r5, 8(r3)
+
+    mov  r10, r3
+    tsave r10
+
+    addi r10, r0, 0          # SYS_read from stdin
+    mov  r11, r3
+    addi r12, r0, 4
+    addi r17, r0, 2
+    ecall
+
+    mov  r10, r3             # SYS_memset
+    addi r11, r0, 0
+    addi r12, r0, 16
+    addi r17, r0, 13
+    ecall
+
+    addi r1, r0, 5
+    bne  r21, r1, fail
+
+    li   r20, 0x10002000
+    st   r3, 8(r20)          # DST
+    addi r1, r0, 16
+    st   r1, 16(r20)         # LEN
+    addi r1, r0, 1
+    st   r1, 24(r20)         # ROWS
+    addi r1, r0, 2
+    st   r1, 56(r20)         # CTRL.FILL
+    st   r0, 64(r20)         # START
+poll:
+    ld   r1, 72(r20)
+    andi r2, r1, 2
+    beq  r2, r0, poll
+    andi r2, r1, 4
+    beq  r2, r0, fail
+
+    ldbu r4, 0(r3)
+    addi r1, r0, 0x5A
+    bne  r4, r1, fail
+    ld   r4, 8(r3)
+    bne  r4, r0, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 7
+    li   r17, 1
+    ecall
+    ebreak
+
+# Count the store fault and skip the faulting instruction.
+handler:
+    csrrw r1, mcause, r0
+    addi r2, r0, 7
+    bne  r1, r2, fail
+    addi r21, r21, 1
+    csrrs r1, mepc, r0
+    addi r1, r1, 4
+    csrrw r0, mepc, r1
+    mret
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .ascii "rom:OK"
+    .byte 10
+msg_fail:
+    .ascii "rom:FAIL"
+    .byte 10
+
+.org 0x1000
+rom:
+    .byte 0x5A
+    .zero 15
@@ -0,0 +1,34 @@
+.org 0x0000
+
+# Two program phases for --sample/--bbv: an ALU loop with a multiply,
+# then a loop striding 64 bytes through 256 KiB (one L1D miss per load).
+
+start:
+    li   r1, 20000
+    addi r2, r0, 0
+    addi r3, r0, 3
+alu_loop:
+    add  r2, r2, r1
+    mul  r4, r2, r3
+    xor  r2, r2, r4
+    addi r1, r1, -1
+    bne  r1, r0, alu_loop
+
+    li   r5, 0x100000
+    li   r6, 0x140000
+    addi r7, r0, 0
+mem_loop:
+    ld   r8, 0(r5)
+    add  r7, r7, r8
+    addi r5, r5, 64
+    bltu r5, r6, mem_loop
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 10
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 115, 97, 109, 112, 108, 101, 58, 79, 75, 10
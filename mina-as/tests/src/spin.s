@@ -0,0 +1,9 @@
+.org 0x0000
+
+# Endless loop, stopped by the -s step limit (progress reporting tests).
+
+start:
+    addi r1, r0, 0
+loop:
+    addi r1, r1, 1
+    jal  r0, loop
@@ -0,0 +1,62 @@
+.org 0x0000
+
+start:
+    # iov[3] on the stack: "io" "v:" "OK\n"
+    addi r30, r30, -48
+    li   r1, seg_a
+    st   r1, 0, r30
+    addi r1, r0, 2
+    st   r1, 8, r30
+    li   r1, seg_b
+    st   r1, 16, r30
+    addi r1, r0, 2
+    st   r1, 24, r30
+    li   r1, seg_c
+    st   r1, 32, r30
+    addi r1, r0, 3
+    st   r1, 40, r30
+
+    li   r10, 1        # fd = stdout
+    add  r11, r30, r0  # iov
+    li   r12, 3        # iovcnt
+    li   r17, 4        # SYS_writev
+    ecall
+    addi r1, r0, 7
+    bne  r10, r1, fail
+
+    # write larger than the old 4 KiB cap (to stderr)
+    li   r10, 2
+    li   r11, 0
+    li   r12, 6000
+    li   r17, 1        # SYS_write
+    ecall
+    li   r1, 6000
+    bne  r10, r1, fail
+
+    # more than 64 entries is EINVAL rather than a short write
+    li   r10, 1
+    add  r11, r30, r0
+    li   r12, 65
+    li   r17, 4        # SYS_writev
+    ecall
+    addi r1, r0, -22
+    bne  r10, r1, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    ebreak
+
+seg_a:
+    .byte 105, 111
+seg_b:
+    .byte 118, 58
+seg_c:
+    .byte 79, 75, 10
+msg_ok:
+    .byte 108, 97, 114, 103, 101, 58, 79, 75, 10
@@ -0,0 +1,116 @@
+.org 0x0000
+
+# mstatus.TS: Initial at reset, Dirty after a tensor write, Off traps
+# every tensor instruction. The handler restores the state saved by
+# tsave (lazy restore) and retries; a save area with a bad format tag
+# makes trestore illegal and leaves TS unchanged.
+start:
+    li   r1, handler
+    csrrw r2, mtvec, r1
+    li   r21, area
+
+    # TS = Initial (01)
+    csrrs r1, mstatus, r0
+    srli r1, r1, 9
+    andi r1, r1, 3
+    addi r2, r0, 1
+    bne  r1, r2, fail
+
+    # tr2 = INT8 {1, 2, 0, ...}
+    li   r1, tile
+    tld  tr1, r1, 64
+    tcvt tr2, tr1, int8
+    csrrs r1, mstatus, r0
+    srli r1, r1, 9
+    andi r1, r1, 3
+    addi r2, r0, 3
+    bne  r1, r2, fail
+
+    tsave r21
+    li   r3, area
+    ldwu r4, 1024, r3          # tr1[0] = 1.0f
+    li   r5, 0x3F800000
+    bne  r4, r5, fail
+    li   r3, tags
+    ldbu r4, 2, r3             # tr2 tag = INT8 (5)
+    addi r5, r0, 5
+    bne  r4, r5, fail
+
+    # Clobber tr2 and turn TS Off: the next tensor instruction traps and
+    # the handler brings the saved state back.
+    tzero tr2
+    addi r20, r0, 1
+    li   r1, 0x600
+    csrrc r0, mstatus, r1
+    tred tr2, r6, sum
+    addi r5, r0, 3
+    bne  r6, r5, fail
+    bne  r20, r0, fail
+
+    # Format tag 9 does not exist. The trestore traps before it writes
+    # anything, so TS stays Clean (10).
+    li   r1, 0x600
+    csrrc r0, mstatus, r1
+    li   r1, 0x400
+    csrrs r0, mstatus, r1
+    addi r20, r0, 2
+    li   r3, tags
+    addi r4, r0, 9
+    stb  r4, 0, r3
+    trestore r21
+    bne  r20, r0, fail
+    csrrs r1, mstatus, r0
+    srli r1, r1, 9
+    andi r1, r1, 3
+    addi r2, r0, 2
+    bne  r1, r2, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 13
+    li   r17, 1
+    ecall
+    ebreak
+
+# r20 = 1: TS was Off; turn it on, restore the saved state and retry.
+# r20 = 2: the bad-tag trestore; skip it.
+handler:
+    csrrs r1, mcause, r0
+    addi r2, r0, 2
+    bne  r1, r2, fail
+    addi r2, r0, 1
+    bne  r20, r2, skip
+    li   r1, 0x200
+    csrrs r0, mstatus, r1
+    trestore r21
+    addi r20, r0, 0
+    mret
+skip:
+    addi r20, r0, 0
+    csrrs r1, mepc, r0
+    addi r1, r1, 4
+    csrrw r0, mepc, r1
+    mret
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 15
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .ascii "tensor-ts:OK"
+    .byte 10
+msg_fail:
+    .ascii "tensor-ts:FAIL"
+    .byte 10
+.align 3
+tile:
+    .word 0x3F800000, 0x40000000
+    .zero 1016
+area:
+    .zero 8192
+tags:
+    .zero 8
@@ -0,0 +1,70 @@
+.org 0x0000
+
+start:
+    addi r1, r0, handler
+    csrrw r2, mtvec, r1
+
+    # mtimecmp = mtime + 10000000 (beyond the default step limit)
+    li   r5, 0x1001BFF8
+    ld   r6, 0(r5)
+    li   r7, 10000000
+    add  r8, r6, r7
+    li   r5, 0x10014000
+    st   r8, 0(r5)
+
+    # enable MTIE and MIE
+    addi r1, r0, 0x80
+    csrrw r2, mie, r1
+    addi r1, r0, 1
+    csrrs r0, mstatus, r1
+
+idle:
+    wfi
+    j    idle
+
+handler:
+    csrrw r1, mcause, r0
+    slt  r4, r1, r0
+    beq  r4, r0, fail
+    andi r4, r1, 0xFF
+    addi r3, r0, 7
+    bne  r4, r3, fail
+
+    # mtime must have reached mtimecmp
+    li   r5, 0x1001BFF8
+    ld   r6, 0(r5)
+    bltu r6, r8, fail
+
+    # disarm: mtimecmp = all ones
+    li   r5, 0x10014000
+    addi r6, r0, -1
+    st   r6, 0(r5)
+
+    jal  r31, print_ok
+    ebreak
+
+fail:
+    jal  r31, print_fail
+    ebreak
+
+print_ok:
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ret
+
+print_fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 11
+    li   r17, 1
+    ecall
+    ret
+
+msg_ok:
+    .byte 116, 105, 109, 101, 114, 58, 79, 75, 10
+
+msg_fail:
+    .byte 116, 105, 109, 101, 114, 58, 70, 65, 73, 76, 10
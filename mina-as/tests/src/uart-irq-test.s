@@ -0,0 +1,36 @@
+.org 0x0000
+
+start:
+    # UART TX 0x10000000, RX 0x10000004, CTRL 0x1000000C
+    movhi r10, 0x10000
+    addi r11, r10, 4
+    addi r13, r10, 12
+
+    addi r1, r0, handler
+    csrrw r2, mtvec, r1
+
+    # enable MEIE and MIE
+    li   r1, 0x800
+    csrrw r2, mie, r1
+    addi r1, r0, 1
+    csrrs r0, mstatus, r1
+
+    # enable RX-available interrupt
+    addi r1, r0, 1
+    stb  r1, 0, r13
+
+idle:
+    wfi
+    j    idle
+
+handler:
+    csrrw r1, mcause, r0
+    andi r1, r1, 0xFF
+    addi r2, r0, 11
+    bne  r1, r2, fail
+    ldbu r1, 0, r11
+    stb  r1, 0, r10
+    ebreak
+
+fail:
+    ebreak
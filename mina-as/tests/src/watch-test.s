@@ -0,0 +1,48 @@
+.org 0x0000
+
+# Watchpoint target: data at 0x2000 (watched by the runner at 0x2008,
+# 8 bytes), a load and AMO on the same page, and a call to `probe` at
+# 0x100 (breakpoint target).
+
+start:
+    li   r5, 0x2000
+    addi r1, r0, 5
+    st   r1, 0(r5)
+    ld   r2, 0(r5)
+    bne  r1, r2, fail
+
+    jal  r31, probe
+
+    addi r1, r0, 7
+    st   r1, 8(r5)
+    ld   r2, 8(r5)
+    bne  r1, r2, fail
+    addi r4, r0, 1
+    amoadd.d r3, r5, r4
+    ld   r2, 0(r5)
+    addi r3, r0, 6
+    bne  r2, r3, fail
+
+    li   r10, 1
+    li   r11, msg_ok
+    li   r12, 9
+    li   r17, 1
+    ecall
+    ebreak
+
+fail:
+    li   r10, 1
+    li   r11, msg_fail
+    li   r12, 11
+    li   r17, 1
+    ecall
+    ebreak
+
+msg_ok:
+    .byte 119, 97, 116, 99, 104, 58, 79, 75, 10
+msg_fail:
+    .byte 119, 97, 116, 99, 104, 58, 70, 65, 73, 76, 10
+
+.org 0x100
+probe:
+    jalr r0, r31, 0
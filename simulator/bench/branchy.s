@@ -0,0 +1,28 @@
+.org 0x0000
+
+# Data-dependent branches on the bits of an LCG, so direction is close to
+# random.
+
+start:
+    li   r1, 3000000
+    addi r2, r0, 1
+    li   r3, 1103515245
+    addi r5, r0, 0
+loop:
+    mul  r2, r2, r3
+    addi r2, r2, 1234
+    srli r4, r2, 16
+    andi r6, r4, 1
+    beq  r6, r0, even
+    addi r5, r5, 3
+    jal  r0, next
+even:
+    andi r6, r4, 2
+    beq  r6, r0, skip
+    xor  r5, r5, r4
+skip:
+    addi r5, r5, -1
+next:
+    addi r1, r1, -1
+    bne  r1, r0, loop
+    ebreak
@@ -0,0 +1,6 @@
+.org 0x0000
+
+# Tensor GEMM, fp32 tiles.
+
+.include "gemm.inc"
+    gemm fp32 256 64 0x3f800000 500
@@ -0,0 +1,6 @@
+.org 0x0000
+
+# Tensor GEMM, fp8 tiles.
+
+.include "gemm.inc"
+    gemm fp8e4m3 64 16 0x38383838 500
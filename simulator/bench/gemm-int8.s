@@ -0,0 +1,6 @@
+.org 0x0000
+
+# Tensor GEMM, int8 tiles.
+
+.include "gemm.inc"
+    gemm int8 64 16 0x01010101 500
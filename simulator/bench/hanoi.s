@@ -0,0 +1,47 @@
+.org 0x0000
+
+# Call-heavy recursion: towers of Hanoi with 19 discs (2^19 - 1 moves),
+# frames on the stack. A wrong move count spins until the step limit.
+
+start:
+    li   r30, 0x800000
+    addi r16, r0, 19
+    addi r17, r0, 1
+    addi r18, r0, 3
+    addi r19, r0, 2
+    addi r20, r0, 0
+    jal  r31, hanoi
+    li   r5, 524287
+    bne  r20, r5, fail
+    ebreak
+fail:
+    jal  r0, fail
+
+# hanoi(n = r16, from = r17, to = r18, via = r19); r20 counts moves
+hanoi:
+    beq  r16, r0, hanoi_ret
+    addi r30, r30, -48
+    st   r31, 40(r30)
+    st   r16, 0(r30)
+    st   r17, 8(r30)
+    st   r18, 16(r30)
+    st   r19, 24(r30)
+    addi r16, r16, -1
+    add  r5, r18, r0
+    add  r18, r19, r0
+    add  r19, r5, r0
+    jal  r31, hanoi
+    ld   r16, 0(r30)
+    ld   r17, 8(r30)
+    ld   r18, 16(r30)
+    ld   r19, 24(r30)
+    addi r20, r20, 1
+    addi r16, r16, -1
+    add  r5, r17, r0
+    add  r17, r19, r0
+    add  r19, r5, r0
+    jal  r31, hanoi
+    ld   r31, 40(r30)
+    addi r30, r30, 48
+hanoi_ret:
+    jalr r0, r31, 0
@@ -0,0 +1,19 @@
+.org 0x0000
+
+# Integer ALU loop: dependent add/xor/shift/mul chain, 8 instructions per
+# iteration.
+
+start:
+    li   r1, 4000000
+    addi r2, r0, 1
+    addi r3, r0, 7
+loop:
+    add  r2, r2, r3
+    xor  r3, r3, r2
+    slli r4, r2, 3
+    srli r5, r3, 5
+    mul  r6, r4, r5
+    sub  r2, r2, r6
+    addi r1, r1, -1
+    bne  r1, r0, loop
+    ebreak
@@ -0,0 +1,26 @@
+.org 0x0000
+
+# Memory-bound copy: 1 MiB with 8-byte loads/stores, unrolled 4x, 64
+# passes.
+
+start:
+    li   r20, 64
+pass:
+    li   r1, 0x100000
+    li   r2, 0x300000
+    li   r3, 0x200000
+copy:
+    ld   r4, 0(r1)
+    ld   r5, 8(r1)
+    ld   r6, 16(r1)
+    ld   r7, 24(r1)
+    st   r4, 0(r2)
+    st   r5, 8(r2)
+    st   r6, 16(r2)
+    st   r7, 24(r2)
+    addi r1, r1, 32
+    addi r2, r2, 32
+    bltu r1, r3, copy
+    addi r20, r20, -1
+    bne  r20, r0, pass
+    ebreak
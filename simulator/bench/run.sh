@@ -0,0 +1,110 @@
+#!/bin/sh
+set -e
+
+# Simulator throughput: run each guest workload REPEAT times (best run
+# kept), report guest instructions, host seconds and MIPS as a table and
+# as JSON, and compare MIPS against a saved baseline when there is one.
+#
+#   BENCH="hanoi memcpy"  only these workloads
+#   REPEAT=N              runs per workload (default 3)
+#   BASELINE=FILE         baseline to compare with (default out/bench/baseline.json)
+#   SAVE_BASELINE=1       also store this run as the baseline
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+AS="$ROOT/../mina-as/mina-as"
+SIM="$ROOT/mina-sim"
+OUT="$(cd "$ROOT/.." && pwd)/out/bench"
+WORKLOADS="int-loop memcpy branchy hanoi uart gemm-fp32 gemm-fp8 gemm-int8"
+BENCH=${BENCH:-$WORKLOADS}
+REPEAT=${REPEAT:-3}
+BASELINE=${BASELINE:-$OUT/baseline.json}
+RESULT="$OUT/bench.json"
+
+mkdir -p "$OUT"
+if [ ! -x "$SIM" ]; then
+  make -s -C "$ROOT"
+fi
+if [ ! -x "$AS" ]; then
+  make -s -C "$ROOT/../mina-as"
+fi
+
+# field NAME FILE: numeric value of "NAME": in a --stats-json file.
+field() {
+  sed -n "s/^ *\"$1\": \([0-9.]*\),*$/\1/p" "$2"
+}
+
+# baseline_mips NAME: MIPS recorded for NAME in the baseline, if any.
+baseline_mips() {
+  [ -f "$BASELINE" ] || return 0
+  sed -n "s/^ *\"$1\": {.*\"mips\": \([0-9.]*\)}.*$/\1/p" "$BASELINE"
+}
+
+rows="$OUT/rows.$$"
+: > "$rows"
+printf '%-10s %14s %9s %9s %9s %8s\n' workload instructions seconds MIPS baseline change
+total_insns=0
+total_secs=0
+status=0
+for w in $BENCH; do
+  if [ ! -f "$ROOT/bench/$w.s" ]; then
+    echo "unknown workload: $w" >&2
+    exit 1
+  fi
+  $AS "$ROOT/bench/$w.s" -o "$OUT/$w.elf"
+  best=""
+  n=0
+  while [ "$n" -lt "$REPEAT" ]; do
+    n=$((n + 1))
+    $SIM -s 1000000000 --stats-json "$OUT/$w.json" "$OUT/$w.elf" > /dev/null 2> "$OUT/$w.err" || true
+    if ! grep -q '^halted on ebreak' "$OUT/$w.err"; then
+      echo "$w: did not finish:" >&2
+      cat "$OUT/$w.err" >&2
+      status=1
+      continue
+    fi
+    secs=$(field seconds "$OUT/$w.json")
+    if [ -z "$best" ] || awk "BEGIN { exit !($secs < $best) }"; then
+      best=$secs
+      insns=$(field instructions "$OUT/$w.json")
+    fi
+  done
+  rm -f "$OUT/$w.json" "$OUT/$w.err"
+  [ -n "$best" ] || continue
+  mips=$(awk "BEGIN { printf \"%.3f\", ($best > 0) ? $insns / $best / 1e6 : 0 }")
+  base=$(baseline_mips "$w")
+  if [ -n "$base" ]; then
+    change=$(awk "BEGIN { printf \"%+.1f%%\", ($base > 0) ? ($mips / $base - 1) * 100 : 0 }")
+    base=$(awk "BEGIN { printf \"%.2f\", $base }")
+  else
+    base="-"
+    change="-"
+  fi
+  printf '%-10s %14s %9.3f %9.2f %9s %8s\n' "$w" "$insns" "$best" "$mips" "$base" "$change"
+  printf '    "%s": {"instructions": %s, "seconds": %s, "mips": %s}' "$w" "$insns" "$best" "$mips" >> "$rows"
+  echo "," >> "$rows"
+  total_insns=$((total_insns + insns))
+  total_secs=$(awk "BEGIN { printf \"%.6f\", $total_secs + $best }")
+done
+
+total_mips=$(awk "BEGIN { printf \"%.3f\", ($total_secs > 0) ? $total_insns / $total_secs / 1e6 : 0 }")
+printf '%-10s %14s %9.3f %9.2f\n' total "$total_insns" "$total_secs" "$total_mips"
+
+{
+  echo "{"
+  echo "  \"host\": \"$(uname -sm)\","
+  echo "  \"repeat\": $REPEAT,"
+  echo "  \"workloads\": {"
+  sed '$ s/,$//' "$rows"
+  echo "  },"
+  echo "  \"total\": {\"instructions\": $total_insns, \"seconds\": $total_secs, \"mips\": $total_mips}"
+  echo "}"
+} > "$RESULT"
+rm -f "$rows"
+echo "results: $RESULT"
+if [ -f "$BASELINE" ]; then echo "baseline: $BASELINE"; fi
+
+if [ -n "$SAVE_BASELINE" ]; then
+  cp "$RESULT" "$BASELINE"
+  echo "saved baseline: $BASELINE"
+fi
+exit $status
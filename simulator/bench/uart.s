@@ -0,0 +1,28 @@
+.org 0x0000
+
+# Console-heavy output: 1M bytes through the UART TX register, then 200k
+# SYS_write calls of 32 bytes.
+
+start:
+    li   r1, 1000000
+    li   r2, 0x10000000
+    addi r3, r0, 46
+tx:
+    stb  r3, 0(r2)
+    addi r1, r1, -1
+    bne  r1, r0, tx
+
+    li   r20, 200000
+write:
+    addi r10, r0, 1
+    li   r11, line
+    addi r12, r0, 32
+    addi r17, r0, 1
+    ecall
+    addi r20, r20, -1
+    bne  r20, r0, write
+    ebreak
+
+line:
+    .byte 98, 101, 110, 99, 104, 32, 111, 117, 116, 112, 117, 116, 32, 108, 105, 110
+    .byte 101, 32, 116, 104, 114, 111, 117, 103, 104, 32, 119, 114, 105, 116, 101, 10
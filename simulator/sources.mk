@@ -0,0 +1,4 @@
+# Simulator sources, shared with the Emscripten build in docs/Makefile.
+# LIB_SRC is libminasim; mina-sim adds CLI_SRC on top.
+LIB_SRC = src/cpu.c src/mem.c src/event.c src/clint.c src/uart.c src/hostfs.c src/blk.c src/dma.c src/mmu.c src/stats.c src/watch.c src/replay.c src/loader.c src/minasim.c
+CLI_SRC = src/main.c src/forkserver.c src/cov.c src/progress.c src/sample.c
@@ -0,0 +1,269 @@
+#define _XOPEN_SOURCE 700
+#include "blk.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The worker owns the ring between its own head and `avail`; the hart owns
+// the registers. `avail` and `used` are the only fields both sides touch.
+static struct {
+    bool attached;
+    bool readonly;
+    int fd;
+    uint64_t sectors;
+    Mem *mem;
+
+    uint64_t queue_addr;
+    uint32_t queue_size;
+    atomic_uint avail;
+    atomic_uint used;
+    uint32_t used_seen;
+    uint32_t isr;
+    uint32_t ctrl;
+
+    bool started;
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+} blk = {
+    .fd = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+bool blk_attach(const char *path, Mem *m) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    bool ro = false;
+    if (fd < 0 && (errno == EACCES || errno == EROFS)) {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        ro = true;
+    }
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) { close(fd); return false; }
+    blk.fd = fd;
+    blk.readonly = ro;
+    blk.sectors = (uint64_t)st.st_size / BLK_SECTOR;
+    blk.mem = m;
+    blk.attached = true;
+    return true;
+}
+
+static bool io_full(bool write, uint8_t *buf, size_t len, uint64_t off) {
+    while (len > 0) {
+        ssize_t n = write ? pwrite(blk.fd, buf, len, (off_t)off) : pread(blk.fd, buf, len, (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return true;
+}
+
+static uint32_t blk_do(uint8_t *desc) {
+    uint32_t type;
+    uint64_t sector, addr, len;
+    memcpy(&type, desc + 0, 4);
+    memcpy(&sector, desc + 8, 8);
+    memcpy(&addr, desc + 16, 8);
+    memcpy(&len, desc + 24, 8);
+    if (type == BLK_T_FLUSH) return fsync(blk.fd) == 0 ? BLK_S_OK : BLK_S_IOERR;
+    if (type != BLK_T_IN && type != BLK_T_OUT) return BLK_S_UNSUPP;
+    if (type == BLK_T_OUT && blk.readonly) return BLK_S_IOERR;
+    if (len % BLK_SECTOR) return BLK_S_IOERR;
+    uint64_t count = len / BLK_SECTOR;
+    if (sector > blk.sectors || count > blk.sectors - sector) return BLK_S_IOERR;
+    // Writing the image only reads guest memory, which stays clean.
+    bool out = (type == BLK_T_OUT);
+    uint8_t *buf = out ? (uint8_t *)mem_cptr(blk.mem, addr, (size_t)len) : mem_ptr(blk.mem, addr, (size_t)len);
+    if (!buf) return BLK_S_IOERR;
+    return io_full(out, buf, (size_t)len, sector * BLK_SECTOR) ? BLK_S_OK : BLK_S_IOERR;
+}
+
+// Completes the descriptors from `head` up to `avail`, publishing each.
+static uint32_t blk_serve(uint32_t head, uint32_t avail, uint64_t qaddr, uint32_t qsize) {
+    while (head != avail) {
+        uint64_t daddr = qaddr + (uint64_t)(head & (qsize - 1)) * BLK_DESC_SIZE;
+        uint8_t *desc = mem_ptr(blk.mem, daddr, BLK_DESC_SIZE);
+        if (desc) {
+            uint32_t status = blk_do(desc);
+            memcpy(desc + 4, &status, 4);
+        }
+        head++;
+        atomic_store_explicit(&blk.used, head, memory_order_release);
+    }
+    return head;
+}
+
+// Services whole batches: everything posted up to `avail` is completed
+// before the worker sleeps again, with one wake-up per batch.
+static void *blk_worker(void *arg) {
+    (void)arg;
+    uint32_t head = atomic_load(&blk.used);
+    for (;;) {
+        pthread_mutex_lock(&blk.lock);
+        while (!blk.stop && head == atomic_load(&blk.avail)) pthread_cond_wait(&blk.work, &blk.lock);
+        uint32_t avail = atomic_load(&blk.avail);
+        uint64_t qaddr = blk.queue_addr;
+        uint32_t qsize = blk.queue_size;
+        bool stop = blk.stop;
+        pthread_mutex_unlock(&blk.lock);
+        if (head == avail && stop) return NULL;
+
+        head = blk_serve(head, avail, qaddr, qsize);
+        pthread_mutex_lock(&blk.lock);
+        pthread_cond_broadcast(&blk.done);
+        pthread_mutex_unlock(&blk.lock);
+    }
+}
+
+void blk_detach(void) {
+    if (!blk.attached) return;
+    if (blk.started) {
+        pthread_mutex_lock(&blk.lock);
+        blk.stop = true;
+        pthread_cond_broadcast(&blk.work);
+        pthread_mutex_unlock(&blk.lock);
+        pthread_join(blk.thread, NULL);
+        blk.started = false;
+    }
+    close(blk.fd);
+    blk.fd = -1;
+    blk.attached = false;
+}
+
+static inline bool blk_busy(void) {
+    return atomic_load_explicit(&blk.used, memory_order_acquire) != atomic_load(&blk.avail);
+}
+
+// Completions are sampled on the hart side, never pushed from the worker:
+// a poll event runs every BLK_POLL_CYCLES while requests are in flight.
+static void blk_poll(void *ctx, uint64_t now);
+
+static void blk_sync(Cpu *c) {
+    event_cancel(&c->events, blk_poll, c);
+    uint32_t used = atomic_load_explicit(&blk.used, memory_order_acquire);
+    if (used != blk.used_seen) {
+        blk.used_seen = used;
+        blk.isr |= BLK_ISR_USED;
+    }
+    cpu_set_irq_line(c, IRQ_LINE_BLK, blk.isr && (blk.ctrl & BLK_CTRL_IE));
+    if (used != atomic_load(&blk.avail)) event_schedule(&c->events, c->cycle + BLK_POLL_CYCLES, blk_poll, c);
+}
+
+static void blk_poll(void *ctx, uint64_t now) {
+    Cpu *c = (Cpu *)ctx;
+    (void)now;
+    if (c->in_wfi && atomic_load(&blk.used) == blk.used_seen) {
+        if (c->events.count > 0) {
+            event_schedule(&c->events, c->events.next, blk_poll, c);
+            return;
+        }
+        // Nothing else can happen before the disk answers.
+        pthread_mutex_lock(&blk.lock);
+        while (atomic_load(&blk.used) == blk.used_seen) pthread_cond_wait(&blk.done, &blk.lock);
+        pthread_mutex_unlock(&blk.lock);
+    }
+    blk_sync(c);
+}
+
+static void blk_notify(Cpu *c, uint32_t idx) {
+    uint32_t used = atomic_load(&blk.used);
+    if (blk.queue_size == 0 || idx - used > blk.queue_size) return;
+    if (c->replay && !blk.started) {
+        // Recorded and replayed runs complete requests on notify, so USED
+        // never depends on how fast the host disk answered.
+        atomic_store(&blk.avail, idx);
+        blk_serve(used, idx, blk.queue_addr, blk.queue_size);
+        blk_sync(c);
+        return;
+    }
+    if (!blk.started) {
+        if (pthread_create(&blk.thread, NULL, blk_worker, NULL) != 0) return;
+        blk.started = true;
+    }
+    pthread_mutex_lock(&blk.lock);
+    atomic_store(&blk.avail, idx);
+    pthread_cond_signal(&blk.work);
+    pthread_mutex_unlock(&blk.lock);
+    blk_sync(c);
+}
+
+static bool blk_reg(uint64_t base, uint64_t *out) {
+    switch (base) {
+        case BLK_MAGIC: *out = BLK_MAGIC_VALUE; return true;
+        case BLK_CAPACITY: *out = blk.sectors; return true;
+        case BLK_QUEUE_ADDR: *out = blk.queue_addr; return true;
+        case BLK_QUEUE_SIZE: *out = blk.queue_size; return true;
+        case BLK_NOTIFY: *out = atomic_load(&blk.avail); return true;
+        case BLK_USED: *out = atomic_load_explicit(&blk.used, memory_order_acquire); return true;
+        case BLK_ISR: *out = blk.isr; return true;
+        case BLK_CTRL: *out = blk.ctrl; return true;
+        default: return false;
+    }
+}
+
+bool blk_load(void *ctx, uint64_t addr, size_t size, uint64_t *out) {
+    Cpu *c = (Cpu *)ctx;
+    if (!blk.attached) return false;
+    if (size != 4 && size != 8) return false;
+    uint64_t off = addr & 0x7;
+    if (off + size > 8) return false;
+    uint64_t base = addr & ~0x7ull;
+    if (base == BLK_ISR) blk_sync(c);
+    uint64_t v = 0;
+    if (!blk_reg(base, &v)) return false;
+    v >>= off * 8;
+    *out = (size == 8) ? v : (v & 0xFFFFFFFFull);
+    return true;
+}
+
+bool blk_store(void *ctx, uint64_t addr, size_t size, uint64_t val) {
+    Cpu *c = (Cpu *)ctx;
+    if (!blk.attached) return false;
+    if (size != 4 && size != 8) return false;
+    uint64_t off = addr & 0x7;
+    if (off + size > 8) return false;
+    uint64_t base = addr & ~0x7ull;
+    uint64_t cur = 0;
+    if (!blk_reg(base, &cur)) return false;
+    uint64_t mask = (size == 8) ? UINT64_MAX : (0xFFFFFFFFull << (off * 8));
+    uint64_t nv = (cur & ~mask) | ((val << (off * 8)) & mask);
+    switch (base) {
+        case BLK_QUEUE_ADDR:
+            if (!blk_busy()) {
+                pthread_mutex_lock(&blk.lock);
+                blk.queue_addr = nv;
+                pthread_mutex_unlock(&blk.lock);
+            }
+            return true;
+        case BLK_QUEUE_SIZE:
+            if (!blk_busy() && nv <= BLK_QUEUE_MAX && (nv & (nv - 1)) == 0) {
+                pthread_mutex_lock(&blk.lock);
+                blk.queue_size = (uint32_t)nv;
+                pthread_mutex_unlock(&blk.lock);
+            }
+            return true;
+        case BLK_NOTIFY:
+            blk_notify(c, (uint32_t)nv);
+            return true;
+        case BLK_ISR:
+            blk.isr &= ~(uint32_t)(val << (off * 8));
+            blk_sync(c);
+            return true;
+        case BLK_CTRL:
+            blk.ctrl = (uint32_t)nv & BLK_CTRL_IE;
+            blk_sync(c);
+            return true;
+        default:
+            return true; // read-only registers ignore writes
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef MINA_BLK_H
+#define MINA_BLK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+
+// Block device MMIO, loosely modeled on virtio-blk. The guest fills
+// descriptors in a ring in RAM and writes the new producer index to
+// NOTIFY; a worker thread services every posted descriptor with
+// pread/pwrite against the host image while the hart keeps running.
+// Completion is published through USED and ISR, and raises mip.SEIP
+// when CTRL.IE is set. One device per process (attached with --blk).
+
+#define BLK_BASE 0x10001000ull
+#define BLK_SIZE 0x1000ull
+
+#define BLK_MAGIC      (BLK_BASE + 0x00) // RO "MBLK"
+#define BLK_CAPACITY   (BLK_BASE + 0x08) // RO, 512-byte sectors
+#define BLK_QUEUE_ADDR (BLK_BASE + 0x10) // RW, descriptor ring base
+#define BLK_QUEUE_SIZE (BLK_BASE + 0x18) // RW, power of two, 1..256
+#define BLK_NOTIFY     (BLK_BASE + 0x20) // WO, free-running avail index
+#define BLK_USED       (BLK_BASE + 0x28) // RO, free-running used index
+#define BLK_ISR        (BLK_BASE + 0x30) // R/W1C, bit 0 = completion
+#define BLK_CTRL       (BLK_BASE + 0x38) // RW, bit 0 = interrupt enable
+
+#define BLK_MAGIC_VALUE 0x4B4C424Dull
+#define BLK_SECTOR      512u
+#define BLK_QUEUE_MAX   256u
+#define BLK_POLL_CYCLES 1024u
+
+#define BLK_CTRL_IE 0x1u
+#define BLK_ISR_USED 0x1u
+
+// Descriptor: 32 bytes at QUEUE_ADDR + (idx % QUEUE_SIZE) * 32.
+//   u32 type; u32 status; u64 sector; u64 addr; u64 len (bytes)
+#define BLK_DESC_SIZE 32u
+#define BLK_T_IN    0u
+#define BLK_T_OUT   1u
+#define BLK_T_FLUSH 4u
+#define BLK_S_OK     0u
+#define BLK_S_IOERR  1u
+#define BLK_S_UNSUPP 2u
+
+bool blk_attach(const char *path, Mem *m);
+void blk_detach(void);
+
+// MMIO callbacks (ctx is the Cpu).
+bool blk_load(void *ctx, uint64_t addr, size_t size, uint64_t *out);
+bool blk_store(void *ctx, uint64_t addr, size_t size, uint64_t val);
+
+#endif
@@ -0,0 +1,104 @@
+#include "clint.h"
+
+static void mtimer_fire(void *ctx, uint64_t now);
+static void stimer_fire(void *ctx, uint64_t now);
+
+static inline uint64_t clint_mtime(const Cpu *c) {
+    return c->cycle + c->mtime_offset;
+}
+
+static void clint_set_pending(Cpu *c, uint64_t bit, bool on) {
+    bool s_level = (bit & (MIP_SSIP | MIP_STIP)) != 0;
+    if (on) {
+        if (s_level) c->sip |= bit;
+        cpu_set_mip(c, bit);
+    } else {
+        if (s_level) c->sip &= ~bit;
+        cpu_clear_mip(c, bit);
+    }
+}
+
+// Raise the timer line now if the comparator has been reached, otherwise
+// schedule an event for the cycle on which mtime will reach it.
+static void clint_arm(Cpu *c, uint64_t cmp, uint64_t bit, EventFn fn) {
+    event_cancel(&c->events, fn, c);
+    uint64_t now = clint_mtime(c);
+    if (now >= cmp) {
+        clint_set_pending(c, bit, true);
+        return;
+    }
+    clint_set_pending(c, bit, false);
+    uint64_t delta = cmp - now;
+    if (delta > UINT64_MAX - c->cycle) return;
+    event_schedule(&c->events, c->cycle + delta, fn, c);
+}
+
+static void mtimer_fire(void *ctx, uint64_t now) {
+    Cpu *c = (Cpu *)ctx;
+    (void)now;
+    clint_arm(c, c->mtimecmp, MIP_MTIP, mtimer_fire);
+}
+
+static void stimer_fire(void *ctx, uint64_t now) {
+    Cpu *c = (Cpu *)ctx;
+    (void)now;
+    clint_arm(c, c->stimecmp, MIP_STIP, stimer_fire);
+}
+
+void clint_init(Cpu *c) {
+    c->mtimecmp = UINT64_MAX;
+    c->stimecmp = UINT64_MAX;
+    c->mtime_offset = 0;
+}
+
+static uint64_t *clint_reg64(Cpu *c, uint64_t base, uint64_t *scratch) {
+    switch (base) {
+        case CLINT_MTIMECMP: return &c->mtimecmp;
+        case CLINT_STIMECMP: return &c->stimecmp;
+        case CLINT_MTIME: *scratch = clint_mtime(c); return scratch;
+        default: return NULL;
+    }
+}
+
+bool clint_load(void *ctx, uint64_t addr, size_t size, uint64_t *out) {
+    Cpu *c = (Cpu *)ctx;
+    if (addr == CLINT_MSIP || addr == CLINT_SSIP) {
+        if (size > 4) return false;
+        uint64_t bit = (addr == CLINT_MSIP) ? MIP_MSIP : MIP_SSIP;
+        *out = (c->mip & bit) ? 1 : 0;
+        return true;
+    }
+    if (size != 4 && size != 8) return false;
+    uint64_t off = addr & 0x7;
+    if (off + size > 8) return false;
+    uint64_t scratch = 0;
+    uint64_t *reg = clint_reg64(c, addr & ~0x7ull, &scratch);
+    if (!reg) return false;
+    uint64_t v = *reg >> (off * 8);
+    *out = (size == 8) ? v : (v & 0xFFFFFFFFull);
+    return true;
+}
+
+bool clint_store(void *ctx, uint64_t addr, size_t size, uint64_t val) {
+    Cpu *c = (Cpu *)ctx;
+    if (addr == CLINT_MSIP || addr == CLINT_SSIP) {
+        if (size > 4) return false;
+        uint64_t bit = (addr == CLINT_MSIP) ? MIP_MSIP : MIP_SSIP;
+        clint_set_pending(c, bit, (val & 1) != 0);
+        return true;
+    }
+    if (size != 4 && size != 8) return false;
+    uint64_t off = addr & 0x7;
+    if (off + size > 8) return false;
+    uint64_t base = addr & ~0x7ull;
+    uint64_t scratch = 0;
+    uint64_t *reg = clint_reg64(c, base, &scratch);
+    if (!reg) return false;
+    uint64_t mask = (size == 8) ? UINT64_MAX : (0xFFFFFFFFull << (off * 8));
+    uint64_t nv = (*reg & ~mask) | ((val << (off * 8)) & mask);
+    if (base == CLINT_MTIME) c->mtime_offset = nv - c->cycle;
+    else *reg = nv;
+    if (base != CLINT_STIMECMP) clint_arm(c, c->mtimecmp, MIP_MTIP, mtimer_fire);
+    if (base != CLINT_MTIMECMP) clint_arm(c, c->stimecmp, MIP_STIP, stimer_fire);
+    return true;
+}
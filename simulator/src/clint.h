@@ -0,0 +1,31 @@
+#ifndef MINA_CLINT_H
+#define MINA_CLINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+
+// CLINT-style timer and software-interrupt device.
+// mtime advances with the cycle counter; comparators are serviced from the
+// cycle-keyed event queue, so an armed timer costs nothing per instruction.
+
+#define CLINT_BASE      0x10010000ull
+#define CLINT_SIZE      0x00010000ull
+#define CLINT_MSIP      (CLINT_BASE + 0x0000)
+#define CLINT_SSIP      (CLINT_BASE + 0x0004)
+#define CLINT_MTIMECMP  (CLINT_BASE + 0x4000)
+#define CLINT_STIMECMP  (CLINT_BASE + 0x4008)
+#define CLINT_MTIME     (CLINT_BASE + 0xBFF8)
+
+#define MIP_SSIP (1ull << 1)
+#define MIP_MSIP (1ull << 3)
+#define MIP_STIP (1ull << 5)
+#define MIP_MTIP (1ull << 7)
+
+void clint_init(Cpu *c);
+// MMIO callbacks (ctx is the Cpu).
+bool clint_load(void *ctx, uint64_t addr, size_t size, uint64_t *out);
+bool clint_store(void *ctx, uint64_t addr, size_t size, uint64_t val);
+
+#endif
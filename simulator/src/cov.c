@@ -0,0 +1,164 @@
+#include "cov.h"
+#include "isa.h"
+#include "loader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COV_MAX_SEGMENTS 8
+
+Coverage *cov_create(uint64_t limit) {
+    Coverage *cv = (Coverage *)calloc(1, sizeof(*cv));
+    if (!cv) return NULL;
+    size_t bytes = (size_t)((limit + 31) >> 5);
+    cv->limit = limit;
+    cv->blocks = (uint8_t *)calloc(bytes ? bytes : 1, 1);
+    cv->taken = (uint8_t *)calloc(bytes ? bytes : 1, 1);
+    cv->not_taken = (uint8_t *)calloc(bytes ? bytes : 1, 1);
+    if (!cv->blocks || !cv->taken || !cv->not_taken) {
+        cov_destroy(cv);
+        return NULL;
+    }
+    return cv;
+}
+
+void cov_destroy(Coverage *cv) {
+    if (!cv) return;
+    free(cv->blocks);
+    free(cv->taken);
+    free(cv->not_taken);
+    free(cv);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+bool cov_save(const Coverage *cv, const char *path) {
+    size_t bytes = (size_t)((cv->limit + 31) >> 5);
+    size_t lo = bytes, hi = 0;
+    for (size_t k = 0; k < bytes; k++) {
+        if (!(cv->blocks[k] | cv->taken[k] | cv->not_taken[k])) continue;
+        if (lo == bytes) lo = k;
+        hi = k + 1;
+    }
+    if (lo == bytes) lo = hi = 0;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    uint8_t hdr[24];
+    memcpy(hdr, COV_MAGIC, 4);
+    put_u32(hdr + 4, COV_VERSION);
+    put_u64(hdr + 8, (uint64_t)lo << 5);
+    put_u64(hdr + 16, hi - lo);
+    bool ok = fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+              fwrite(cv->blocks + lo, 1, hi - lo, f) == hi - lo &&
+              fwrite(cv->taken + lo, 1, hi - lo, f) == hi - lo &&
+              fwrite(cv->not_taken + lo, 1, hi - lo, f) == hi - lo;
+    return (fclose(f) == 0) && ok;
+}
+
+static uint32_t word_at(const ImageSegment *s, uint64_t i) {
+    const uint8_t *p = s->data + i * 4;
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Instructions after which the next word does not run in the same block.
+static bool ends_block(uint32_t insn) {
+    uint32_t op = insn & 0x7F;
+    if (op == OP_BRANCH || op == OP_JAL || op == OP_JALR) return true;
+    return insn == 0x00100073u   // ebreak
+        || insn == 0x30200073u   // mret
+        || insn == 0x10200073u;  // sret
+}
+
+static int sym_cmp(const void *a, const void *b) {
+    const ImageSymbol *x = (const ImageSymbol *)a;
+    const ImageSymbol *y = (const ImageSymbol *)b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+bool cov_report(const Coverage *cv, const char *path, const char *image_name, const uint8_t *image, size_t len) {
+    ImageSegment segs[COV_MAX_SEGMENTS];
+    size_t nseg = load_image_code(image, len, segs, COV_MAX_SEGMENTS);
+    size_t nsym = 0;
+    ImageSymbol *syms = load_image_symbols(image, len, &nsym);
+    if (nsym) qsort(syms, nsym, sizeof(*syms), sym_cmp);
+
+    FILE *f = fopen(path, "w");
+    if (!f) { free(syms); return false; }
+    fprintf(f, "TN:\nSF:%s\n", image_name);
+
+    uint64_t lf = 0, lh = 0, brf = 0, brh = 0, fnf = 0, fnh = 0;
+    uint8_t *hit[COV_MAX_SEGMENTS] = {0};
+    bool ok = true;
+    for (size_t s = 0; s < nseg && ok; s++) {
+        uint64_t n = segs[s].size / 4;
+        hit[s] = (uint8_t *)calloc(n ? (size_t)n : 1, 1);
+        if (!hit[s]) { ok = false; break; }
+        // Walk forward from each recorded block start. Blocks are visited in
+        // address order, so reaching an already-marked word means the rest
+        // of this block was marked by an earlier walk.
+        for (uint64_t i = 0; i < n; i++) {
+            if (!cov_test(cv->blocks, cv->limit, segs[s].vaddr + i * 4)) continue;
+            for (uint64_t j = i; j < n; j++) {
+                if (j > i && hit[s][j]) break;
+                hit[s][j] = 1;
+                if (ends_block(word_at(&segs[s], j))) break;
+            }
+        }
+    }
+
+    for (size_t k = 0; k < nsym && ok; k++) {
+        if (!syms[k].func || (syms[k].addr & 3)) continue;
+        for (size_t s = 0; s < nseg; s++) {
+            uint64_t off = syms[k].addr - segs[s].vaddr;
+            if (syms[k].addr < segs[s].vaddr || off / 4 >= segs[s].size / 4) continue;
+            int h = hit[s][off / 4];
+            fprintf(f, "FN:%llu,%s\nFNDA:%d,%s\n", (unsigned long long)syms[k].addr, syms[k].name, h, syms[k].name);
+            fnf++;
+            fnh += (uint64_t)h;
+            break;
+        }
+    }
+    if (ok) fprintf(f, "FNF:%llu\nFNH:%llu\n", (unsigned long long)fnf, (unsigned long long)fnh);
+
+    for (size_t s = 0; s < nseg && ok; s++) {
+        for (uint64_t i = 0; i < segs[s].size / 4; i++) {
+            if ((word_at(&segs[s], i) & 0x7F) != OP_BRANCH) continue;
+            uint64_t pc = segs[s].vaddr + i * 4;
+            bool dir[2] = { cov_test(cv->taken, cv->limit, pc), cov_test(cv->not_taken, cv->limit, pc) };
+            for (int d = 0; d < 2; d++) {
+                if (hit[s][i]) fprintf(f, "BRDA:%llu,0,%d,%d\n", (unsigned long long)pc, d, dir[d] ? 1 : 0);
+                else fprintf(f, "BRDA:%llu,0,%d,-\n", (unsigned long long)pc, d);
+                brf++;
+                brh += dir[d];
+            }
+        }
+    }
+    if (ok) fprintf(f, "BRF:%llu\nBRH:%llu\n", (unsigned long long)brf, (unsigned long long)brh);
+
+    for (size_t s = 0; s < nseg && ok; s++) {
+        for (uint64_t i = 0; i < segs[s].size / 4; i++) {
+            fprintf(f, "DA:%llu,%d\n", (unsigned long long)(segs[s].vaddr + i * 4), hit[s][i]);
+            lf++;
+            lh += hit[s][i];
+        }
+    }
+    if (ok) fprintf(f, "LF:%llu\nLH:%llu\nend_of_record\n", (unsigned long long)lf, (unsigned long long)lh);
+
+    for (size_t s = 0; s < nseg; s++) free(hit[s]);
+    free(syms);
+    if (fclose(f) != 0) ok = false;
+    if (ok) {
+        fprintf(stderr, "coverage: %llu/%llu instructions, %llu/%llu branch directions, %llu/%llu functions\n",
+                (unsigned long long)lh, (unsigned long long)lf,
+                (unsigned long long)brh, (unsigned long long)brf,
+                (unsigned long long)fnh, (unsigned long long)fnf);
+    }
+    return ok;
+}
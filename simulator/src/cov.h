@@ -0,0 +1,63 @@
+#ifndef MINA_COV_H
+#define MINA_COV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// PC-keyed coverage for --coverage. Three bitmaps with one bit per 4-byte
+// instruction slot below `limit`: a basic block started at this PC (the
+// target of a branch, jump, trap or trap return, or the entry point), and
+// the conditional branch at this PC was taken / fell through. Recording is
+// a null test plus one OR on control transfers only; straight-line code
+// costs nothing.
+//
+// The binary dump ("MCOV") stores the bitmaps over the touched address
+// window only:
+//   char magic[4] = "MCOV"; uint32 version = 1;
+//   uint64 base;    // PC of the first bit (32-byte aligned)
+//   uint64 bytes;   // length of each bitmap
+//   uint8 blocks[bytes], taken[bytes], not_taken[bytes];
+// all little-endian, bit i of byte k covering PC base + (8k + i) * 4.
+
+#define COV_MAGIC "MCOV"
+#define COV_VERSION 1u
+
+typedef struct Coverage {
+    uint64_t limit;
+    uint8_t *blocks;
+    uint8_t *taken;
+    uint8_t *not_taken;
+} Coverage;
+
+Coverage *cov_create(uint64_t limit);
+void cov_destroy(Coverage *cv);
+
+static inline void cov_set(uint8_t *map, uint64_t limit, uint64_t pc) {
+    if (pc < limit) map[pc >> 5] |= (uint8_t)(1u << ((pc >> 2) & 7));
+}
+
+static inline bool cov_test(const uint8_t *map, uint64_t limit, uint64_t pc) {
+    return pc < limit && (map[pc >> 5] >> ((pc >> 2) & 7)) & 1;
+}
+
+static inline void cov_block(Coverage *cv, uint64_t pc) {
+    cov_set(cv->blocks, cv->limit, pc);
+}
+
+static inline void cov_branch(Coverage *cv, uint64_t pc, bool taken, uint64_t target) {
+    cov_set(taken ? cv->taken : cv->not_taken, cv->limit, pc);
+    cov_set(cv->blocks, cv->limit, target);
+}
+
+bool cov_save(const Coverage *cv, const char *path);
+
+// lcov tracefile for one program image, with instruction addresses as line
+// numbers: DA for every word of the executable segments (executed when it
+// lies between a recorded block start and the next control transfer),
+// BRDA for each conditional branch (block 0, branch 0 taken, 1 not
+// taken), and FN/FNDA for STT_FUNC symbols. Prints a one-line summary to
+// stderr.
+bool cov_report(const Coverage *cv, const char *path, const char *image_name, const uint8_t *image, size_t len);
+
+#endif
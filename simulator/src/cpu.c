@@ -1,20 +1,42 @@
 #include "cpu.h"
+#include "blk.h"
+#include "clint.h"
+#include "cov.h"
+#include "dma.h"
+#include "hostfs.h"
 #include "isa.h"
+#include "stats.h"
+#include "uart.h"
+#include "watch.h"
 #include <limits.h>
 #include <math.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
-#define UART_TX_ADDR 0x10000000ull
-#define UART_RX_ADDR 0x10000004ull
-#define UART_STATUS_ADDR 0x10000008ull
-#define UART_RX_SIZE 256u
-
 #define SYS_WRITE 1u
 #define SYS_READ 2u
 #define SYS_EXIT 3u
+#define SYS_WRITEV 4u
+#define SYS_READV 5u
+#define SYS_OPEN 6u
+#define SYS_CLOSE 7u
+#define SYS_LSEEK 8u
+#define SYS_PREAD 9u
+#define SYS_PWRITE 10u
+#define SYS_FSTAT 11u
+#define SYS_MEMCPY 12u
+#define SYS_MEMSET 13u
+#define SYS_MEMCMP 14u
+#define SYS_STRLEN 15u
+
+#define SYS_IOV_MAX 64u
+
+// syscall_handle result when checking a guest buffer took a trap
+// (trap_entry already ran): the ecall does not retire.
+#define SYSCALL_TRAPPED TRAP_ECALL
 
 static bool cap_check(CapReg c, uint64_t addr, uint64_t len, uint16_t need, uint64_t *subcode);
 static void trap_entry(Cpu *c, uint64_t cause, uint64_t tval, bool is_interrupt);
@@ -63,11 +85,13 @@ static inline int64_t imm_j(uint32_t insn) {
 #define MSTATUS_SPIE  (1ull << 5)
 #define MSTATUS_CAP   (1ull << 8)
 #define MSTATUS_TS_MASK (3ull << 9)
+#define MSTATUS_TS_INITIAL (1ull << 9)
+#define MSTATUS_TS_DIRTY (3ull << 9)
 #define MSTATUS_MPP_SHIFT 11
 #define MSTATUS_MPP_MASK (3ull << MSTATUS_MPP_SHIFT)
 #define MSTATUS_SPP  (1ull << 13)
 
-#define SSTATUS_MASK (MSTATUS_SIE | MSTATUS_SPIE | MSTATUS_SPP | MSTATUS_TS_MASK | MSTATUS_CAP)
+#define SSTATUS_MASK (MSTATUS_SIE | MSTATUS_SPIE | MSTATUS_SPP | MSTATUS_TS_MASK | MSTATUS_CAP | MSTATUS_SUM | MSTATUS_MXR)
 
 enum {
     CSR_SSTATUS = 0x100,
@@ -78,6 +102,7 @@ enum {
     CSR_SCAUSE = 0x142,
     CSR_STVAL = 0x143,
     CSR_SIP = 0x144,
+    CSR_SATP = 0x180,
 
     CSR_MSTATUS = 0x300,
     CSR_MEDELEG = 0x302,
@@ -93,6 +118,8 @@ enum {
     CSR_CYCLE = 0xC00,
     CSR_TIME = 0xC01,
     CSR_INSTRET = 0xC02,
+    CSR_TLBHIT = 0xC03,
+    CSR_TLBMISS = 0xC04,
 };
 
 static inline void write_reg(Cpu *c, uint32_t rd, uint64_t val) {
@@ -100,95 +127,365 @@ static inline void write_reg(Cpu *c, uint32_t rd, uint64_t val) {
     c->regs[rd] = val;
 }
 
-static inline void uart_write(uint64_t val, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        uint8_t ch = (uint8_t)((val >> (8 * i)) & 0xFF);
-        fputc((int)ch, stdout);
+// Translate a virtual address for the current mode (identity in M-mode or
+// with satp.MODE=bare). On a fault the page or access fault for `access`
+// is taken with tval = va and false is returned.
+static inline bool cpu_translate(Cpu *c, Mem *m, uint64_t va, uint32_t access, uint64_t *pa) {
+    if (!c->mmu.sv39 || c->mode == MODE_M) { *pa = va; return true; }
+    MmuResult r = mmu_translate(&c->mmu, m, va, access, (unsigned)c->mode, pa);
+    if (r == MMU_OK) return true;
+    uint64_t cause;
+    if (access & MMU_X) cause = (r == MMU_PAGE_FAULT) ? 12 : 1;
+    else if (access & MMU_W) cause = (r == MMU_PAGE_FAULT) ? 15 : 7;
+    else cause = (r == MMU_PAGE_FAULT) ? 13 : 5;
+    trap_entry(c, cause, va, false);
+    return false;
+}
+
+// Host I/O needs one host range, so under translation a syscall buffer
+// must also be physically contiguous; a split buffer takes `fault`.
+static bool syscall_xlate(Cpu *c, Mem *m, uint64_t addr, uint64_t len, uint16_t need, uint64_t fault, uint64_t *out) {
+    uint32_t access = (need & 0x2) ? MMU_W : MMU_R;
+    uint64_t pa;
+    if (!cpu_translate(c, m, addr, access, &pa)) return false;
+    if (len > UINT64_MAX - addr) { trap_entry(c, fault, addr, false); return false; }
+    uint64_t page = 1ull << MEM_PAGE_SHIFT;
+    for (uint64_t va = (addr | (page - 1)) + 1; va - addr < len; va += page) {
+        uint64_t next;
+        if (!cpu_translate(c, m, va, access, &next)) return false;
+        if (next != pa + (va - addr)) { trap_entry(c, fault, va, false); return false; }
+    }
+    *out = pa;
+    return true;
+}
+
+// DDC check for a range the host touches on the guest's behalf.
+static bool syscall_cap(Cpu *c, uint64_t addr, uint64_t len, uint16_t need) {
+    if ((c->mstatus & MSTATUS_CAP) && c->mode != MODE_M) {
+        uint64_t sub = 0;
+        if (!cap_check(c->caps[0], addr, len, need, &sub)) { trap_entry(c, 11, sub, false); return false; }
     }
-    fflush(stdout);
+    return true;
 }
 
-static void uart_rx_fill(Cpu *c) {
-    if (c->uart_rx_count >= UART_RX_SIZE) return;
-    fd_set rfds;
-    struct timeval tv;
-    FD_ZERO(&rfds);
-    FD_SET(STDIN_FILENO, &rfds);
-    tv.tv_sec = 0;
-    tv.tv_usec = 0;
-    int r = select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv);
-    if (r <= 0 || !FD_ISSET(STDIN_FILENO, &rfds)) return;
+// Validate a guest syscall buffer with one capability check and return its
+// host address, so the host I/O call works on guest memory directly.
+// Buffers the host only reads (need 0x1) come from mem_cptr and so stay
+// clean; they are handed out non-const only because iovec wants that.
+static bool syscall_buf(Cpu *c, Mem *m, uint64_t addr, uint64_t len, uint16_t need, uint64_t fault, uint8_t **out) {
+    if (!syscall_cap(c, addr, len, need)) return false;
+    uint64_t pa = addr;
+    if (c->mmu.sv39 && c->mode != MODE_M && !syscall_xlate(c, m, addr, len, need, fault, &pa)) return false;
+    uint8_t *p = (need & 0x2) ? mem_ptr(m, pa, (size_t)len) : (uint8_t *)mem_cptr(m, pa, (size_t)len);
+    if (!p) { trap_entry(c, fault, addr, false); return false; }
+    *out = p;
+    return true;
+}
 
-    uint8_t tmp[64];
-    ssize_t n = read(STDIN_FILENO, tmp, sizeof(tmp));
-    if (n <= 0) return;
-    for (ssize_t i = 0; i < n; i++) {
-        if (c->uart_rx_count >= UART_RX_SIZE) break;
-        c->uart_rx[c->uart_rx_head] = tmp[i];
-        c->uart_rx_head = (c->uart_rx_head + 1) % UART_RX_SIZE;
-        c->uart_rx_count++;
+// Gather a guest iovec array ({u64 base, u64 len} entries) into host iovecs.
+static bool syscall_iov(Cpu *c, Mem *m, uint64_t iov_addr, uint64_t iovcnt, uint16_t need, uint64_t fault,
+                        struct iovec *iov, uint64_t *total) {
+    uint8_t *raw = NULL;
+    if (!syscall_buf(c, m, iov_addr, iovcnt * 16, 0x1, 5, &raw)) return false;
+    *total = 0;
+    for (uint64_t i = 0; i < iovcnt; i++) {
+        uint64_t base, len;
+        memcpy(&base, raw + i * 16, 8);
+        memcpy(&len, raw + i * 16 + 8, 8);
+        uint8_t *p = NULL;
+        if (len && !syscall_buf(c, m, base, len, need, fault, &p)) return false;
+        iov[i].iov_base = p;
+        iov[i].iov_len = (size_t)len;
+        *total += len;
     }
+    return true;
 }
 
-static bool uart_rx_pop(Cpu *c, uint8_t *out) {
-    uart_rx_fill(c);
-    if (c->uart_rx_count == 0) return false;
-    *out = c->uart_rx[c->uart_rx_tail];
-    c->uart_rx_tail = (c->uart_rx_tail + 1) % UART_RX_SIZE;
-    c->uart_rx_count--;
+// Validate a NUL-terminated guest path (at most 4095 bytes).
+static bool syscall_path(Cpu *c, Mem *m, uint64_t addr, const char **out) {
+    uint64_t pa;
+    if (!cpu_translate(c, m, addr, MMU_R, &pa)) return false;
+    if (pa >= m->size) { trap_entry(c, 5, addr, false); return false; }
+    size_t avail = m->size - (size_t)pa;
+    if (avail > 4096) avail = 4096;
+    const uint8_t *nul = memchr(&m->data[pa], 0, avail);
+    if (!nul) { trap_entry(c, 5, addr, false); return false; }
+    uint8_t *p = NULL;
+    if (!syscall_buf(c, m, addr, (uint64_t)(nul - &m->data[pa]) + 1, 0x1, 5, &p)) return false;
+    *out = (const char *)p;
+    return true;
+}
+
+// The memory syscalls (memcpy, memset, memcmp, strlen) work on guest
+// ranges of any length, so unlike syscall_buf they walk them a page at a
+// time under translation and need not be physically contiguous. The whole
+// range is checked against the capability first, so a cap fault leaves
+// memory untouched; a page fault part way takes the trap with the bytes
+// before it already done, as the equivalent loop would.
+static bool memcall_span(Cpu *c, Mem *m, uint64_t addr, uint64_t len, uint16_t need, uint64_t fault,
+                         uint8_t **out, uint64_t *span) {
+    if (c->mmu.sv39 && c->mode != MODE_M) {
+        uint64_t page = 1ull << MEM_PAGE_SHIFT;
+        uint64_t room = page - (addr & (page - 1));
+        if (len > room) len = room;
+    }
+    if (!syscall_buf(c, m, addr, len, need, fault, out)) return false;
+    *span = len;
     return true;
 }
 
-static uint8_t uart_rx_status(Cpu *c) {
-    uart_rx_fill(c);
-    return (c->uart_rx_count > 0) ? 1 : 0;
+// Bulk work runs at host speed but is charged to the cycle counter (and so
+// to time and mtime) at memcall_cycles per 8-byte word.
+static void memcall_charge(Cpu *c, unsigned kind, uint64_t bytes) {
+    c->cycle += (bytes + 7) / 8 * c->memcall_cycles;
+    c->time = c->cycle;
+    if (c->stats) {
+        c->stats->memcalls[kind]++;
+        c->stats->memcall_bytes[kind] += bytes;
+    }
+}
+
+static Trap memcall(Cpu *c, Mem *m, uint64_t a7, uint64_t a0, uint64_t a1, uint64_t a2) {
+    unsigned kind = (unsigned)(a7 - SYS_MEMCPY);
+    uint64_t done = 0;
+    if (a7 == SYS_STRLEN) {
+        // The length is unknown up front: scan page by page and check the
+        // capability over the bytes read, terminator included.
+        uint64_t page = 1ull << MEM_PAGE_SHIFT;
+        for (;;) {
+            uint64_t va = a0 + done, pa;
+            if (!cpu_translate(c, m, va, MMU_R, &pa)) return SYSCALL_TRAPPED;
+            if (pa >= m->size) { trap_entry(c, 5, va, false); return SYSCALL_TRAPPED; }
+            uint64_t room = page - (va & (page - 1));
+            if (room > m->size - pa) room = m->size - pa;
+            const uint8_t *nul = memchr(&m->data[pa], 0, (size_t)room);
+            uint64_t n = nul ? (uint64_t)(nul - &m->data[pa]) + 1 : room;
+            if (!syscall_cap(c, va, n, 0x1)) return SYSCALL_TRAPPED;
+            done += n;
+            if (nul) break;
+        }
+        memcall_charge(c, kind, done);
+        c->regs[10] = done - 1;
+        return TRAP_NONE;
+    }
+    if (a2 == 0) {
+        c->regs[10] = (a7 == SYS_MEMCMP) ? 0 : a0;
+        return TRAP_NONE;
+    }
+    if (a7 == SYS_MEMSET) {
+        if (!syscall_cap(c, a0, a2, 0x2)) return SYSCALL_TRAPPED;
+        while (done < a2) {
+            uint8_t *d = NULL;
+            uint64_t n = 0;
+            if (!memcall_span(c, m, a0 + done, a2 - done, 0x2, 7, &d, &n)) return SYSCALL_TRAPPED;
+            memset(d, (int)(a1 & 0xFF), (size_t)n);
+            done += n;
+        }
+        memcall_charge(c, kind, done);
+        c->regs[10] = a0;
+        return TRAP_NONE;
+    }
+    // memcpy(a0 = dst, a1 = src) and memcmp(a0, a1): two ranges, walked
+    // in pieces that end at whichever page boundary comes first.
+    bool cmp = (a7 == SYS_MEMCMP);
+    if (!syscall_cap(c, a0, a2, cmp ? 0x1 : 0x2) || !syscall_cap(c, a1, a2, 0x1)) return SYSCALL_TRAPPED;
+    int64_t diff = 0;
+    while (done < a2) {
+        uint8_t *p0 = NULL, *p1 = NULL;
+        uint64_t n0 = 0, n1 = 0;
+        if (!memcall_span(c, m, a0 + done, a2 - done, cmp ? 0x1 : 0x2, cmp ? 5 : 7, &p0, &n0) ||
+            !memcall_span(c, m, a1 + done, a2 - done, 0x1, 5, &p1, &n1)) {
+            return SYSCALL_TRAPPED;
+        }
+        uint64_t n = n0 < n1 ? n0 : n1;
+        if (!cmp) {
+            memmove(p0, p1, (size_t)n);
+            done += n;
+            continue;
+        }
+        if (memcmp(p0, p1, (size_t)n) == 0) {
+            done += n;
+            continue;
+        }
+        uint64_t k = 0;
+        while (p0[k] == p1[k]) k++;
+        diff = (int64_t)p0[k] - (int64_t)p1[k];
+        done += k + 1;
+        break;
+    }
+    memcall_charge(c, kind, done);
+    c->regs[10] = cmp ? (uint64_t)diff : a0;
+    return TRAP_NONE;
+}
+
+static uint64_t file_writev(int64_t fd, const struct iovec *iov, int cnt) {
+    uint64_t done = 0;
+    for (int i = 0; i < cnt; i++) {
+        int64_t n = hostfs_write(fd, iov[i].iov_base, iov[i].iov_len);
+        if (n < 0) return done ? done : (uint64_t)n;
+        done += (uint64_t)n;
+        if ((size_t)n < iov[i].iov_len) break;
+    }
+    return done;
+}
+
+static uint64_t file_readv(int64_t fd, const struct iovec *iov, int cnt) {
+    uint64_t done = 0;
+    for (int i = 0; i < cnt; i++) {
+        int64_t n = hostfs_read(fd, iov[i].iov_base, iov[i].iov_len);
+        if (n < 0) return done ? done : (uint64_t)n;
+        done += (uint64_t)n;
+        if ((size_t)n < iov[i].iov_len) break;
+    }
+    return done;
+}
+
+static uint64_t host_writev(Cpu *c, int fd, struct iovec *iov, int cnt) {
+    uint64_t done = 0;
+    if (c->host.console_write) {
+        for (int i = 0; i < cnt; i++) {
+            c->host.console_write(c->host.ctx, fd, (const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+            done += iov[i].iov_len;
+        }
+        return done;
+    }
+    FILE *out = (fd == 2) ? stderr : stdout;
+    fflush(out);
+    while (cnt > 0) {
+        ssize_t n = writev(fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (uint64_t)n;
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return done;
+}
+
+static uint64_t host_readv(Cpu *c, struct iovec *iov, int cnt) {
+    uint64_t done = 0;
+    for (int i = 0; i < cnt; i++) {
+        if (iov[i].iov_len == 0) continue;
+        // Block only for the first byte, like read(2) on a pipe.
+        if (done > 0 && !uart_rx_ready(c)) break;
+        size_t n = uart_rx_read(c, (uint8_t *)iov[i].iov_base, iov[i].iov_len);
+        done += n;
+        if (n < iov[i].iov_len) break;
+    }
+    return done;
 }
 
 static Trap syscall_handle(Cpu *c, Mem *m) {
     uint64_t a0 = c->regs[10];
     uint64_t a1 = c->regs[11];
     uint64_t a2 = c->regs[12];
+    uint64_t a3 = c->regs[13];
     uint64_t a7 = c->regs[17];
 
+    if (c->host.syscall) {
+        HostSyscallResult r = c->host.syscall(c->host.ctx, c, m);
+        if (r == HOST_SYSCALL_HALT) return TRAP_EBREAK;
+        if (r == HOST_SYSCALL_DONE) return TRAP_NONE;
+    }
+
     if (a7 == SYS_EXIT) {
+        c->exit_code = a0;
         return TRAP_EBREAK;
     }
 
-    if (a7 == SYS_WRITE) {
-        if (a0 != 1 && a0 != 2) { c->regs[10] = 0; return TRAP_NONE; }
+    if (a7 == SYS_WRITE || a7 == SYS_WRITEV) {
+        bool file = hostfs_is_file((int64_t)a0);
+        if (a0 != 1 && a0 != 2 && !file) { c->regs[10] = 0; return TRAP_NONE; }
         if (a2 == 0) { c->regs[10] = 0; return TRAP_NONE; }
-        if (a2 > 4096) a2 = 4096;
-        if ((c->mstatus & MSTATUS_CAP) && c->mode != MODE_M) {
-            uint64_t sub = 0;
-            if (!cap_check(c->caps[0], a1, a2, 0x1, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
+        struct iovec iov[SYS_IOV_MAX];
+        int cnt = 1;
+        if (a7 == SYS_WRITE) {
+            uint8_t *p = NULL;
+            if (!syscall_buf(c, m, a1, a2, 0x1, 5, &p)) return SYSCALL_TRAPPED;
+            iov[0].iov_base = p;
+            iov[0].iov_len = (size_t)a2;
+        } else {
+            uint64_t total = 0;
+            if (a2 > SYS_IOV_MAX) { c->regs[10] = (uint64_t)-EINVAL; return TRAP_NONE; }
+            if (!syscall_iov(c, m, a1, a2, 0x1, 5, iov, &total)) return SYSCALL_TRAPPED;
+            cnt = (int)a2;
         }
-        uint8_t buf[4096];
-        if (!mem_read(m, a1, buf, (size_t)a2)) { trap_entry(c, 5, a1, false); return TRAP_NONE; }
-        FILE *out = (a0 == 2) ? stderr : stdout;
-        size_t n = fwrite(buf, 1, (size_t)a2, out);
-        fflush(out);
-        c->regs[10] = (uint64_t)n;
+        c->regs[10] = file ? file_writev((int64_t)a0, iov, cnt) : host_writev(c, (int)a0, iov, cnt);
         return TRAP_NONE;
     }
 
-    if (a7 == SYS_READ) {
-        if (a0 != 0) { c->regs[10] = 0; return TRAP_NONE; }
+    if (a7 == SYS_READ || a7 == SYS_READV) {
+        bool file = hostfs_is_file((int64_t)a0);
+        if (a0 != 0 && !file) { c->regs[10] = 0; return TRAP_NONE; }
         if (a2 == 0) { c->regs[10] = 0; return TRAP_NONE; }
-        if (a2 > 4096) a2 = 4096;
-        if ((c->mstatus & MSTATUS_CAP) && c->mode != MODE_M) {
-            uint64_t sub = 0;
-            if (!cap_check(c->caps[0], a1, a2, 0x2, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
-        }
-        uint8_t buf[4096];
-        ssize_t n = read(STDIN_FILENO, buf, (size_t)a2);
-        if (n < 0) n = 0;
-        if (n > 0) {
-            if (!mem_write(m, a1, buf, (size_t)n)) { trap_entry(c, 7, a1, false); return TRAP_NONE; }
+        struct iovec iov[SYS_IOV_MAX];
+        int cnt = 1;
+        if (a7 == SYS_READ) {
+            uint8_t *p = NULL;
+            if (!syscall_buf(c, m, a1, a2, 0x2, 7, &p)) return SYSCALL_TRAPPED;
+            iov[0].iov_base = p;
+            iov[0].iov_len = (size_t)a2;
+        } else {
+            uint64_t total = 0;
+            if (a2 > SYS_IOV_MAX) { c->regs[10] = (uint64_t)-EINVAL; return TRAP_NONE; }
+            if (!syscall_iov(c, m, a1, a2, 0x2, 7, iov, &total)) return SYSCALL_TRAPPED;
+            cnt = (int)a2;
         }
+        c->regs[10] = file ? file_readv((int64_t)a0, iov, cnt) : host_readv(c, iov, cnt);
+        return TRAP_NONE;
+    }
+
+    if (a7 == SYS_OPEN) {
+        const char *path = NULL;
+        if (!syscall_path(c, m, a0, &path)) return SYSCALL_TRAPPED;
+        c->regs[10] = (uint64_t)hostfs_open(path, a1, a2);
+        return TRAP_NONE;
+    }
+
+    if (a7 == SYS_CLOSE) {
+        c->regs[10] = (uint64_t)hostfs_close((int64_t)a0);
+        return TRAP_NONE;
+    }
+
+    if (a7 == SYS_LSEEK) {
+        c->regs[10] = (uint64_t)hostfs_lseek((int64_t)a0, (int64_t)a1, a2);
+        return TRAP_NONE;
+    }
+
+    if (a7 == SYS_PREAD || a7 == SYS_PWRITE) {
+        if (!hostfs_is_file((int64_t)a0)) { c->regs[10] = (uint64_t)-EBADF; return TRAP_NONE; }
+        if (a2 == 0) { c->regs[10] = 0; return TRAP_NONE; }
+        bool wr = (a7 == SYS_PWRITE);
+        uint8_t *p = NULL;
+        if (!syscall_buf(c, m, a1, a2, wr ? 0x1 : 0x2, wr ? 5 : 7, &p)) return SYSCALL_TRAPPED;
+        int64_t n = wr ? hostfs_pwrite((int64_t)a0, p, (size_t)a2, a3) : hostfs_pread((int64_t)a0, p, (size_t)a2, a3);
         c->regs[10] = (uint64_t)n;
         return TRAP_NONE;
     }
 
+    if (a7 == SYS_FSTAT) {
+        HostfsStat st;
+        int64_t r = hostfs_fstat((int64_t)a0, &st);
+        if (r == 0) {
+            uint8_t *p = NULL;
+            if (!syscall_buf(c, m, a1, sizeof(st), 0x2, 7, &p)) return SYSCALL_TRAPPED;
+            memcpy(p, &st, sizeof(st));
+        }
+        c->regs[10] = (uint64_t)r;
+        return TRAP_NONE;
+    }
+
+    if (a7 >= SYS_MEMCPY && a7 <= SYS_STRLEN) return memcall(c, m, a7, a0, a1, a2);
+
     return TRAP_UNIMPLEMENTED;
 }
 
@@ -396,27 +693,32 @@ static bool csr_read(Cpu *c, uint32_t csr, uint64_t *out) {
         case CSR_SEPC: *out = c->sepc; return true;
         case CSR_SCAUSE: *out = c->scause; return true;
         case CSR_STVAL: *out = c->stval; return true;
+        case CSR_SATP: *out = c->mmu.satp; return true;
         case CSR_CYCLE: *out = c->cycle; return true;
         case CSR_TIME: *out = c->time; return true;
         case CSR_INSTRET: *out = c->instret; return true;
+        case CSR_TLBHIT: *out = c->mmu.tlb_hits; return true;
+        case CSR_TLBMISS: *out = c->mmu.tlb_misses; return true;
         default: return false;
     }
 }
 
 static bool csr_write(Cpu *c, uint32_t csr, uint64_t val) {
     switch (csr) {
-        case CSR_MSTATUS: c->mstatus = val; return true;
-        case CSR_MIE: c->mie = val; return true;
+        case CSR_MSTATUS: c->mstatus = val; mmu_set_status(&c->mmu, val); cpu_irq_update(c); return true;
+        case CSR_MIE: c->mie = val; cpu_irq_update(c); return true;
         case CSR_MEDELEG: c->medeleg = val; return true;
-        case CSR_MIDELEG: c->mideleg = val; return true;
+        case CSR_MIDELEG: c->mideleg = val; cpu_irq_update(c); return true;
         case CSR_MTVEC: c->mtvec = val & ~0x3ull; return true;
-        case CSR_MIP: c->mip = val; return true;
+        case CSR_MIP: c->mip = val; cpu_irq_update(c); return true;
         case CSR_MSCRATCH: c->mscratch = val; return true;
         case CSR_MEPC: c->mepc = val; return true;
         case CSR_MCAUSE: c->mcause = val; return true;
         case CSR_MTVAL: c->mtval = val; return true;
         case CSR_SSTATUS:
             c->mstatus = (c->mstatus & ~SSTATUS_MASK) | (val & SSTATUS_MASK);
+            mmu_set_status(&c->mmu, c->mstatus);
+            cpu_irq_update(c);
             return true;
         case CSR_SIE: c->sie = val; return true;
         case CSR_STVEC: c->stvec = val & ~0x3ull; return true;
@@ -425,6 +727,7 @@ static bool csr_write(Cpu *c, uint32_t csr, uint64_t val) {
         case CSR_SEPC: c->sepc = val; return true;
         case CSR_SCAUSE: c->scause = val; return true;
         case CSR_STVAL: c->stval = val; return true;
+        case CSR_SATP: mmu_set_satp(&c->mmu, val); return true;
         default: return false;
     }
 }
@@ -438,6 +741,7 @@ static bool csr_access_ok(Cpu *c, uint32_t csr) {
 
 static void trap_entry(Cpu *c, uint64_t cause, uint64_t tval, bool is_interrupt) {
     bool to_s = false;
+    c->resv_valid = false;
     if (c->mode != MODE_M) {
         uint64_t deleg = is_interrupt ? c->mideleg : c->medeleg;
         if (cause < 64 && (deleg & (1ull << cause))) to_s = true;
@@ -463,13 +767,22 @@ static void trap_entry(Cpu *c, uint64_t cause, uint64_t tval, bool is_interrupt)
         c->mode = MODE_M;
         c->pc = c->mtvec;
     }
+    if (!is_interrupt && c->pc == 0 && (cause < 8 || cause > 11)) c->fault_unhandled = true;
+    if (c->coverage) cov_block(c->coverage, c->pc);
+    if (c->stats && cause < STATS_CAUSES) {
+        if (is_interrupt) c->stats->interrupts[cause]++;
+        else c->stats->exceptions[cause]++;
+    }
+    cpu_irq_update(c);
 }
 
 void cpu_init(Cpu *c, uint64_t entry) {
     memset(c, 0, sizeof(*c));
     c->pc = entry;
     c->mode = MODE_M;
-    c->mstatus = MSTATUS_CAP;
+    // TS starts Initial rather than Off so code that never manages tensor
+    // state can use the unit; a kernel clears it for lazy switching.
+    c->mstatus = MSTATUS_CAP | MSTATUS_TS_INITIAL;
     for (int i = 0; i < 32; i++) {
         c->caps[i].base = 0;
         c->caps[i].len = 0xFFFFFFFFu;
@@ -479,6 +792,10 @@ void cpu_init(Cpu *c, uint64_t entry) {
         c->caps[i].sealed = false;
     }
     for (int t = 0; t < 8; t++) c->tregs[t].fmt = TFMT_FP32;
+    c->rx_peek = -1;
+    c->memcall_cycles = CPU_MEMCALL_CYCLES;
+    event_queue_init(&c->events);
+    clint_init(c);
 }
 
 void cpu_dump_regs(const Cpu *c) {
@@ -487,7 +804,18 @@ void cpu_dump_regs(const Cpu *c) {
     }
 }
 
-static Trap tensor_tld(Cpu *c, Mem *m, uint32_t trd, uint64_t base, int64_t stride) {
+// Tiles are translated element by element; on a page fault *fault holds
+// the element address.
+static inline Trap tensor_xlate(Cpu *c, Mem *m, uint64_t va, uint32_t access, uint64_t *pa, uint64_t *fault) {
+    if (!c->mmu.sv39 || c->mode == MODE_M) { *pa = va; return TRAP_NONE; }
+    MmuResult r = mmu_translate(&c->mmu, m, va, access, (unsigned)c->mode, pa);
+    if (r == MMU_OK) return TRAP_NONE;
+    *fault = va;
+    if (r == MMU_ACCESS_FAULT) return (access & MMU_W) ? TRAP_STORE_FAULT : TRAP_LOAD_FAULT;
+    return (access & MMU_W) ? TRAP_STORE_PAGE_FAULT : TRAP_LOAD_PAGE_FAULT;
+}
+
+static Trap tensor_tld(Cpu *c, Mem *m, uint32_t trd, uint64_t base, int64_t stride, uint64_t *fault) {
     TensorReg *d = &c->tregs[trd];
     if (!fmt_supported(d->fmt)) return TRAP_UNIMPLEMENTED;
     int elem = fmt_bytes(d->fmt);
@@ -495,8 +823,10 @@ static Trap tensor_tld(Cpu *c, Mem *m, uint32_t trd, uint64_t base, int64_t stri
     for (int y = 0; y < 16; y++) {
         uint64_t row = base + (uint64_t)(y * stride);
         for (int x = 0; x < 16; x++) {
-            uint64_t addr = row + (uint64_t)(x * elem);
+            uint64_t addr = (d->fmt == TFMT_FP4_E2M1) ? row + (uint64_t)(x / 2) : row + (uint64_t)(x * elem);
             float v = 0.0f;
+            Trap t = tensor_xlate(c, m, addr, MMU_R, &addr, fault);
+            if (t != TRAP_NONE) return t;
             if (d->fmt == TFMT_FP32) {
                 uint32_t u; if (!mem_read_u32(m, addr, &u)) return TRAP_LOAD_FAULT; v = bits_to_f32(u);
             } else if (d->fmt == TFMT_FP16) {
@@ -508,7 +838,7 @@ static Trap tensor_tld(Cpu *c, Mem *m, uint32_t trd, uint64_t base, int64_t stri
             } else if (d->fmt == TFMT_FP8_E5M2) {
                 uint8_t u; if (!mem_read_u8(m, addr, &u)) return TRAP_LOAD_FAULT; v = f32_from_fp8_e5m2(u);
             } else if (d->fmt == TFMT_FP4_E2M1) {
-                uint8_t b; if (!mem_read_u8(m, row + (uint64_t)(x / 2), &b)) return TRAP_LOAD_FAULT;
+                uint8_t b; if (!mem_read_u8(m, addr, &b)) return TRAP_LOAD_FAULT;
                 uint8_t nib = (x & 1) ? (b >> 4) : (b & 0xF);
                 v = f32_from_fp4_e2m1(nib & 0xFu);
             } else if (d->fmt == TFMT_INT8) {
@@ -520,7 +850,7 @@ static Trap tensor_tld(Cpu *c, Mem *m, uint32_t trd, uint64_t base, int64_t stri
     return TRAP_NONE;
 }
 
-static Trap tensor_tst(Cpu *c, Mem *m, uint32_t trs, uint64_t base, int64_t stride) {
+static Trap tensor_tst(Cpu *c, Mem *m, uint32_t trs, uint64_t base, int64_t stride, uint64_t *fault) {
     TensorReg *s = &c->tregs[trs];
     if (!fmt_supported(s->fmt)) return TRAP_UNIMPLEMENTED;
     int elem = fmt_bytes(s->fmt);
@@ -528,8 +858,10 @@ static Trap tensor_tst(Cpu *c, Mem *m, uint32_t trs, uint64_t base, int64_t stri
     for (int y = 0; y < 16; y++) {
         uint64_t row = base + (uint64_t)(y * stride);
         for (int x = 0; x < 16; x++) {
-            uint64_t addr = row + (uint64_t)(x * elem);
+            uint64_t addr = (s->fmt == TFMT_FP4_E2M1) ? row + (uint64_t)(x / 2) : row + (uint64_t)(x * elem);
             float v = s->v[y * 16 + x];
+            Trap t = tensor_xlate(c, m, addr, MMU_W, &addr, fault);
+            if (t != TRAP_NONE) return t;
             if (s->fmt == TFMT_FP32) {
                 uint32_t u = f32_to_bits(v); if (!mem_write_u32(m, addr, u)) return TRAP_STORE_FAULT;
             } else if (s->fmt == TFMT_FP16) {
@@ -542,11 +874,10 @@ static Trap tensor_tst(Cpu *c, Mem *m, uint32_t trs, uint64_t base, int64_t stri
                 uint8_t u = fp8_e5m2_from_f32(v); if (!mem_write_u8(m, addr, u)) return TRAP_STORE_FAULT;
             } else if (s->fmt == TFMT_FP4_E2M1) {
                 uint8_t u = fp4_e2m1_from_f32(v) & 0xFu;
-                uint64_t baddr = row + (uint64_t)(x / 2);
-                uint8_t b; if (!mem_read_u8(m, baddr, &b)) return TRAP_STORE_FAULT;
+                uint8_t b; if (!mem_read_u8(m, addr, &b)) return TRAP_STORE_FAULT;
                 if (x & 1) b = (uint8_t)((b & 0x0Fu) | (u << 4));
                 else b = (uint8_t)((b & 0xF0u) | u);
-                if (!mem_write_u8(m, baddr, b)) return TRAP_STORE_FAULT;
+                if (!mem_write_u8(m, addr, b)) return TRAP_STORE_FAULT;
             } else if (s->fmt == TFMT_INT8) {
                 int8_t u = sat_int8((int32_t)lrintf(v)); if (!mem_write_u8(m, addr, (uint8_t)u)) return TRAP_STORE_FAULT;
             }
@@ -555,6 +886,81 @@ static Trap tensor_tst(Cpu *c, Mem *m, uint32_t trs, uint64_t base, int64_t stri
     return TRAP_NONE;
 }
 
+// tsave/trestore area: tr0..tr7 as 256 FP32 values each (row-major, 1 KiB
+// per register), then the eight format tags, one byte each.
+#define TSAVE_SIZE (8u * 1024u + 8u)
+#define TSAVE_PIECES 4
+
+// Host pieces of a tsave/trestore area, translated page by page before any
+// byte moves so that a fault leaves memory and registers as they were.
+static Trap tensor_area(Cpu *c, Mem *m, uint64_t base, uint32_t access, uint64_t *pa, uint32_t *len,
+                        int *count, uint64_t *fault) {
+    uint64_t page = 1ull << MEM_PAGE_SHIFT;
+    bool xlate = c->mmu.sv39 && c->mode != MODE_M;
+    int n = 0;
+    for (uint32_t off = 0; off < TSAVE_SIZE; n++) {
+        uint64_t va = base + off;
+        uint64_t chunk = TSAVE_SIZE - off;
+        if (xlate && chunk > page - (va & (page - 1))) chunk = page - (va & (page - 1));
+        Trap t = tensor_xlate(c, m, va, access, &pa[n], fault);
+        if (t != TRAP_NONE) return t;
+        if (pa[n] >= m->size || chunk > m->size - pa[n] || ((access & MMU_W) && !mem_writable(m, pa[n], chunk))) {
+            *fault = va;
+            return (access & MMU_W) ? TRAP_STORE_FAULT : TRAP_LOAD_FAULT;
+        }
+        len[n] = (uint32_t)chunk;
+        off += (uint32_t)chunk;
+    }
+    *count = n;
+    return TRAP_NONE;
+}
+
+// The register file is kept as FP32, so a save is a straight copy of it.
+// Both are out of line so the staging buffer does not grow cpu_step's frame.
+static __attribute__((noinline)) Trap tensor_tsave(Cpu *c, Mem *m, uint64_t base, uint64_t *fault) {
+    uint64_t pa[TSAVE_PIECES];
+    uint32_t len[TSAVE_PIECES];
+    int count = 0;
+    if (base & 0x3) return TRAP_STORE_MISALIGNED;
+    Trap t = tensor_area(c, m, base, MMU_W, pa, len, &count, fault);
+    if (t != TRAP_NONE) return t;
+    uint8_t buf[TSAVE_SIZE];
+    for (int r = 0; r < 8; r++) {
+        memcpy(buf + r * 1024, c->tregs[r].v, 1024);
+        buf[8 * 1024 + r] = (uint8_t)c->tregs[r].fmt;
+    }
+    uint32_t off = 0;
+    for (int i = 0; i < count; i++) {
+        mem_write(m, pa[i], buf + off, len[i]);
+        off += len[i];
+    }
+    return TRAP_NONE;
+}
+
+// An unknown format tag makes the whole restore illegal.
+static __attribute__((noinline)) Trap tensor_trestore(Cpu *c, Mem *m, uint64_t base, uint64_t *fault) {
+    uint64_t pa[TSAVE_PIECES];
+    uint32_t len[TSAVE_PIECES];
+    int count = 0;
+    if (base & 0x3) return TRAP_LOAD_MISALIGNED;
+    Trap t = tensor_area(c, m, base, MMU_R, pa, len, &count, fault);
+    if (t != TRAP_NONE) return t;
+    uint8_t buf[TSAVE_SIZE];
+    uint32_t off = 0;
+    for (int i = 0; i < count; i++) {
+        mem_read(m, pa[i], buf + off, len[i]);
+        off += len[i];
+    }
+    for (int r = 0; r < 8; r++) {
+        if (!fmt_supported((TensorFmt)buf[8 * 1024 + r])) return TRAP_UNIMPLEMENTED;
+    }
+    for (int r = 0; r < 8; r++) {
+        memcpy(c->tregs[r].v, buf + r * 1024, 1024);
+        c->tregs[r].fmt = (TensorFmt)buf[8 * 1024 + r];
+    }
+    return TRAP_NONE;
+}
+
 static Trap tensor_tadd(Cpu *c, uint32_t d, uint32_t a, uint32_t b) {
     TensorReg *td = &c->tregs[d];
     TensorReg *ta = &c->tregs[a];
@@ -685,7 +1091,286 @@ static int lowest_set_bit(uint64_t v) {
     return -1;
 }
 
-Trap cpu_step(Cpu *c, Mem *m) {
+// Returns the interrupt cause that would be taken now, or -1.
+static int irq_select(const Cpu *c) {
+    uint64_t pending = c->mip & c->mie;
+    if (!pending) return -1;
+    int cause = lowest_set_bit(pending);
+    bool delegated = (c->mode != MODE_M) && (c->mideleg & (1ull << cause));
+    if (delegated) return (c->mstatus & MSTATUS_SIE) ? cause : -1;
+    return (c->mstatus & MSTATUS_MIE) ? cause : -1;
+}
+
+void cpu_irq_update(Cpu *c) {
+    c->irq_pending = irq_select(c) >= 0;
+}
+
+bool cpu_map_devices(Cpu *c, Mem *m) {
+    c->dma = dma_create(m);
+    return c->dma && mem_map_mmio(m, "clint", CLINT_BASE, CLINT_SIZE, clint_load, clint_store, c) &&
+           mem_map_mmio(m, "uart", UART_BASE, UART_SIZE, uart_load, uart_store, c) &&
+           mem_map_mmio(m, "blk", BLK_BASE, BLK_SIZE, blk_load, blk_store, c) &&
+           mem_map_mmio(m, "dma", DMA_BASE, DMA_SIZE, dma_load, dma_store, c);
+}
+
+bool cpu_reset(Cpu *c, Mem *m, uint64_t entry) {
+    dma_destroy(c->dma);
+    cpu_init(c, entry);
+    c->dma = dma_create(m);
+    return c->dma != NULL;
+}
+
+void cpu_free(Cpu *c) {
+    dma_destroy(c->dma);
+    c->dma = NULL;
+}
+
+void cpu_set_mip(Cpu *c, uint64_t bits) {
+    c->mip |= bits;
+    cpu_irq_update(c);
+}
+
+void cpu_clear_mip(Cpu *c, uint64_t bits) {
+    c->mip &= ~bits;
+    cpu_irq_update(c);
+}
+
+void cpu_set_irq_line(Cpu *c, uint32_t line, bool level) {
+    if (level) c->seip_lines |= line;
+    else c->seip_lines &= ~line;
+    if (c->seip_lines) cpu_set_mip(c, MIP_SEIP);
+    else cpu_clear_mip(c, MIP_SEIP);
+}
+
+bool cpu_cap_allows(const Cpu *c, uint64_t addr, uint64_t len, uint16_t need) {
+    if (!(c->mstatus & MSTATUS_CAP) || c->mode == MODE_M) return true;
+    uint64_t sub = 0;
+    return cap_check(c->caps[0], addr, len, need, &sub);
+}
+
+// wfi: skip idle cycles by jumping straight to the next device event until
+// an interrupt is pending (wake-up ignores the global MIE/SIE enables).
+static void cpu_wfi(Cpu *c) {
+    c->in_wfi = true;
+    while (!(c->mip & c->mie) && c->events.count) {
+        if (c->events.next > c->cycle) c->cycle = c->events.next;
+        event_run_due(&c->events, c->cycle);
+    }
+    c->in_wfi = false;
+}
+
+static inline void cov_edge(Cpu *c, uint64_t target) {
+    uint32_t h = (uint32_t)(target >> 2);
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    uint32_t cur = h & (COV_MAP_SIZE - 1);
+    c->cov_map[cur ^ c->cov_prev]++;
+    c->cov_prev = cur >> 1;
+}
+
+// AMO funct5 values (funct7[6:2]).
+enum {
+    AMO_ADD = 0x00,
+    AMO_SWAP = 0x01,
+    AMO_LR = 0x02,
+    AMO_SC = 0x03,
+    AMO_XOR = 0x04,
+    AMO_OR = 0x08,
+    AMO_AND = 0x0C,
+    AMO_MIN = 0x10,
+    AMO_MAX = 0x14,
+    AMO_MINU = 0x18,
+    AMO_MAXU = 0x1C,
+};
+
+static inline bool amo_valid(uint32_t op) {
+    switch (op) {
+        case AMO_ADD: case AMO_SWAP: case AMO_LR: case AMO_SC: case AMO_XOR:
+        case AMO_OR: case AMO_AND: case AMO_MIN: case AMO_MAX: case AMO_MINU: case AMO_MAXU:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Guest atomics are host atomics on guest RAM, so they stay atomic when
+// several harts (or host threads) share one Mem. `p` is naturally aligned.
+static inline uint64_t amo_load(uint8_t *p, size_t size) {
+    if (size == 4) return __atomic_load_n((uint32_t *)p, __ATOMIC_SEQ_CST);
+    return __atomic_load_n((uint64_t *)p, __ATOMIC_SEQ_CST);
+}
+
+// sc succeeds only if memory still holds the value lr observed.
+static inline bool amo_cas(uint8_t *p, size_t size, uint64_t expect, uint64_t val) {
+    if (size == 4) {
+        uint32_t e = (uint32_t)expect;
+        return __atomic_compare_exchange_n((uint32_t *)p, &e, (uint32_t)val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+    return __atomic_compare_exchange_n((uint64_t *)p, &expect, val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool amo_replace(uint32_t op, uint64_t old, uint64_t val, size_t size) {
+    if (size == 4) {
+        int32_t so = (int32_t)(uint32_t)old, sv = (int32_t)(uint32_t)val;
+        uint32_t uo = (uint32_t)old, uv = (uint32_t)val;
+        switch (op) {
+            case AMO_MIN: return sv < so;
+            case AMO_MAX: return sv > so;
+            case AMO_MINU: return uv < uo;
+            default: return uv > uo;
+        }
+    }
+    switch (op) {
+        case AMO_MIN: return (int64_t)val < (int64_t)old;
+        case AMO_MAX: return (int64_t)val > (int64_t)old;
+        case AMO_MINU: return val < old;
+        default: return val > old;
+    }
+}
+
+// Read-modify-write; returns the old value (zero-extended).
+static uint64_t amo_rmw(uint8_t *p, size_t size, uint32_t op, uint64_t val) {
+    if (size == 4) {
+        uint32_t *w = (uint32_t *)p;
+        uint32_t v = (uint32_t)val;
+        switch (op) {
+            case AMO_SWAP: return __atomic_exchange_n(w, v, __ATOMIC_SEQ_CST);
+            case AMO_ADD: return __atomic_fetch_add(w, v, __ATOMIC_SEQ_CST);
+            case AMO_XOR: return __atomic_fetch_xor(w, v, __ATOMIC_SEQ_CST);
+            case AMO_OR: return __atomic_fetch_or(w, v, __ATOMIC_SEQ_CST);
+            case AMO_AND: return __atomic_fetch_and(w, v, __ATOMIC_SEQ_CST);
+            default: {
+                uint32_t old = __atomic_load_n(w, __ATOMIC_SEQ_CST);
+                while (amo_replace(op, old, v, 4) &&
+                       !__atomic_compare_exchange_n(w, &old, v, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                }
+                return old;
+            }
+        }
+    }
+    uint64_t *d = (uint64_t *)p;
+    switch (op) {
+        case AMO_SWAP: return __atomic_exchange_n(d, val, __ATOMIC_SEQ_CST);
+        case AMO_ADD: return __atomic_fetch_add(d, val, __ATOMIC_SEQ_CST);
+        case AMO_XOR: return __atomic_fetch_xor(d, val, __ATOMIC_SEQ_CST);
+        case AMO_OR: return __atomic_fetch_or(d, val, __ATOMIC_SEQ_CST);
+        case AMO_AND: return __atomic_fetch_and(d, val, __ATOMIC_SEQ_CST);
+        default: {
+            uint64_t old = __atomic_load_n(d, __ATOMIC_SEQ_CST);
+            while (amo_replace(op, old, val, 8) &&
+                   !__atomic_compare_exchange_n(d, &old, val, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            }
+            return old;
+        }
+    }
+}
+
+static inline uint64_t load_extend(uint32_t f3, uint64_t v) {
+    switch (f3) {
+        case 0x0: return (uint64_t)sign_extend(v & 0xFFu, 8);
+        case 0x1: return (uint64_t)sign_extend(v & 0xFFFFu, 16);
+        case 0x2: return (uint64_t)sign_extend(v & 0xFFFFFFFFu, 32);
+        case 0x4: return v & 0xFFu;
+        case 0x5: return v & 0xFFFFu;
+        case 0x6: return v & 0xFFFFFFFFu;
+        default: return v;
+    }
+}
+
+static inline void cpu_retire(Cpu *c, uint64_t pc_next) {
+    c->pc = pc_next;
+    c->steps++;
+    c->cycle++;
+    c->instret++;
+    c->time = c->cycle;
+}
+
+// Superinstructions. Right after `head` retires, a tail that completes one
+// of the FUSE_* pairs runs in the same dispatch: no second fetch or
+// translation, event, interrupt or breakpoint check. That is only safe
+// when nothing could have happened between the two, so fusion is off
+// while an event is due, an interrupt is pending or any per-instruction
+// hook (trace, watch, coverage) is active, and when the tail is on another
+// page. Capability checks are still made for the tail.
+static inline int fuse_kind(uint32_t opcode, uint32_t f3, uint32_t f7, uint32_t rd, uint32_t rs1) {
+    if (rd == 0) return -1;
+    switch (opcode) {
+        case OP_MOVHI: return FUSE_LI;
+        case OP_OP: return (f7 == 0 && (f3 == 0x2 || f3 == 0x3)) ? FUSE_CMP_BRANCH : -1;
+        case OP_LOAD: return f3 == 0x3 ? FUSE_LD_ADDI : -1;
+        case OP_OPIMM: return (f3 == 0x0 && rd == 30 && rs1 == 30) ? FUSE_PROLOGUE : -1;
+        default: return -1;
+    }
+}
+
+// Runs the tail of a `kind` pair if the next word completes it. Returns
+// with *fused set once the tail has executed (or trapped, like any other
+// step). Out of line so the main dispatch path stays small.
+static __attribute__((noinline)) Trap cpu_fuse(Cpu *c, Mem *m, int kind, uint32_t hrd, uint64_t head_pa, unsigned *fused) {
+    if (c->irq_pending || c->cycle >= c->events.next) return TRAP_NONE;
+    if (c->trace || c->dump_regs || c->watch || c->coverage || c->cov_map) return TRAP_NONE;
+    if (((head_pa + 4) & ((1ull << MEM_PAGE_SHIFT) - 1)) == 0) return TRAP_NONE;
+    uint64_t sub = 0;
+    bool cap = (c->mstatus & MSTATUS_CAP) != 0;
+    if (cap && !cap_check(c->caps[31], c->pc, 4, 0x4, &sub)) return TRAP_NONE;
+
+    uint32_t insn;
+    if (!mem_read_u32(m, head_pa + 4, &insn)) return TRAP_NONE;
+    uint32_t opcode = get_bits(insn, 6, 0);
+    uint32_t rd = rd_field(insn);
+    uint32_t rs1 = rs1_field(insn);
+    uint32_t rs2 = rs2_field(insn);
+    uint32_t f3 = funct3(insn);
+    uint64_t pc_next = c->pc + 4;
+
+    switch (kind) {
+        case FUSE_LI:
+            if (opcode != OP_OPIMM || f3 != 0x0 || rd != hrd || rs1 != hrd) return TRAP_NONE;
+            c->regs[rd] += (uint64_t)imm_i(insn);
+            break;
+        case FUSE_CMP_BRANCH: {
+            if (opcode != OP_BRANCH || f3 > 0x1 || (rs1 != hrd && rs2 != hrd)) return TRAP_NONE;
+            bool take = (c->regs[rs1] == c->regs[rs2]) != (f3 == 0x1);
+            if (take) pc_next = c->pc + (uint64_t)imm_b(insn);
+            if (c->stats) c->stats->branch_taken[take]++;
+            break;
+        }
+        case FUSE_LD_ADDI:
+            if (opcode != OP_OPIMM || f3 != 0x0) return TRAP_NONE;
+            write_reg(c, rd, c->regs[rs1] + (uint64_t)imm_i(insn));
+            break;
+        default: { // FUSE_PROLOGUE
+            if (opcode != OP_STORE || f3 != 0x3 || rs1 != 30 || rs2 != 31) return TRAP_NONE;
+            uint64_t addr = c->regs[30] + (uint64_t)imm_s(insn);
+            if (addr & 0x7) return TRAP_NONE;
+            // Committed from here: a fault is the tail's own trap, at its pc.
+            if (c->stats) { c->stats->ops[opcode]++; c->stats->fused[kind]++; }
+            *fused = 1;
+            if (cap && !cap_check(c->caps[0], addr, 1, 0x2, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
+            uint64_t pa;
+            if (!cpu_translate(c, m, addr, MMU_W, &pa)) return TRAP_NONE;
+            bool ok;
+            if (mem_is_ram(m, pa)) {
+                ok = mem_write_u64(m, pa, c->regs[31]);
+            } else {
+                const Region *r = mem_region(m, pa);
+                if (r && r->kind == REGION_RAM) ok = mem_write_u64(m, pa, c->regs[31]);
+                else ok = r && r->kind == REGION_MMIO && r->store(r->ctx, pa, 8, c->regs[31]);
+            }
+            if (!ok) trap_entry(c, 7, addr, false);
+            else cpu_retire(c, pc_next);
+            return TRAP_NONE;
+        }
+    }
+    if (c->stats) { c->stats->ops[opcode]++; c->stats->fused[kind]++; }
+    cpu_retire(c, pc_next);
+    *fused = 1;
+    return TRAP_NONE;
+}
+
+// One step; with `fused` non-NULL the step may also run a fused tail.
+static Trap cpu_exec(Cpu *c, Mem *m, unsigned *fused) {
     c->regs[0] = 0;
     if (c->pc & 0x3) {
         trap_entry(c, 0, c->pc, false);
@@ -700,29 +1385,24 @@ Trap cpu_step(Cpu *c, Mem *m) {
         }
     }
 
-    uint64_t pending = c->mip & c->mie;
-    if (pending) {
-        int cause = lowest_set_bit(pending);
-        bool delegated = (c->mode != MODE_M) && (c->mideleg & (1ull << cause));
-        if (delegated) {
-            if (c->mstatus & MSTATUS_SIE) {
-                c->mip &= ~(1ull << cause);
-                c->sip &= ~(1ull << cause);
-                trap_entry(c, (uint64_t)cause, 0, true);
-                return TRAP_NONE;
-            }
-        } else {
-            if (c->mstatus & MSTATUS_MIE) {
-                c->mip &= ~(1ull << cause);
-                c->sip &= ~(1ull << cause);
-                trap_entry(c, (uint64_t)cause, 0, true);
-                return TRAP_NONE;
-            }
+    if (c->cycle >= c->events.next) event_run_due(&c->events, c->cycle);
+
+    if (c->irq_pending) {
+        int cause = irq_select(c);
+        if (cause >= 0) {
+            c->mip &= ~(1ull << cause);
+            c->sip &= ~(1ull << cause);
+            trap_entry(c, (uint64_t)cause, 0, true);
+            return TRAP_NONE;
         }
     }
 
+    if (c->watch && c->watch->break_count && watch_break(c)) return TRAP_WATCH;
+
     uint32_t insn = 0;
-    if (!mem_read_u32(m, c->pc, &insn)) {
+    uint64_t fetch_pa;
+    if (!cpu_translate(c, m, c->pc, MMU_X, &fetch_pa)) return TRAP_NONE;
+    if (!mem_read_u32(m, fetch_pa, &insn)) {
         trap_entry(c, 1, c->pc, false);
         return TRAP_NONE;
     }
@@ -733,6 +1413,7 @@ Trap cpu_step(Cpu *c, Mem *m) {
     uint32_t rs2 = rs2_field(insn);
     uint32_t f3 = funct3(insn);
     uint32_t f7 = funct7(insn);
+    if (c->stats) c->stats->ops[opcode]++;
 
     uint64_t pc_next = c->pc + 4;
 
@@ -822,14 +1503,17 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 case 0x4: res = a ^ (uint64_t)imm; break;
                 case 0x6: res = a | (uint64_t)imm; break;
                 case 0x7: res = a & (uint64_t)imm; break;
+                // imm[5:0] is the shift amount, so bit 25 belongs to it
+                // rather than to funct7.
                 case 0x1:
-                    if (f7 != 0x00) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                    if ((f7 & ~0x1u) != 0x00) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
                     res = a << (get_bits(insn, 25, 20) & 0x3F);
                     break;
                 case 0x5: {
                     uint32_t shamt = get_bits(insn, 25, 20) & 0x3F;
-                    if (f7 != 0x00 && f7 != 0x20) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
-                    res = (f7 == 0x20) ? ((int64_t)a >> shamt) : (a >> shamt);
+                    uint32_t hi = f7 & ~0x1u;
+                    if (hi != 0x00 && hi != 0x20) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                    res = (hi == 0x20) ? ((int64_t)a >> shamt) : (a >> shamt);
                     break;
                 }
                 default: trap_entry(c, 2, insn, false); return TRAP_NONE;
@@ -839,64 +1523,60 @@ Trap cpu_step(Cpu *c, Mem *m) {
         }
         case OP_LOAD: {
             uint64_t addr = c->regs[rs1] + (uint64_t)imm_i(insn);
-            if (addr == UART_RX_ADDR || addr == UART_STATUS_ADDR) {
-                uint8_t b = 0;
-                if (addr == UART_RX_ADDR) {
-                    if (!uart_rx_pop(c, &b)) b = 0;
-                } else {
-                    b = uart_rx_status(c);
-                }
-                uint64_t val = 0;
-                switch (f3) {
-                    case 0x0: val = (int64_t)sign_extend(b, 8); break; // ldb
-                    case 0x4: val = b; break; // ldbu
-                    case 0x1: val = (int64_t)sign_extend(b, 8); break; // ldh
-                    case 0x5: val = b; break; // ldhu
-                    case 0x2: val = b; break; // ldw
-                    case 0x6: val = b; break; // ldwu
-                    case 0x3: val = b; break; // ld
-                    default: trap_entry(c, 2, insn, false); return TRAP_NONE;
-                }
-                write_reg(c, rd, val);
-                break;
-            }
             if (c->mstatus & MSTATUS_CAP) {
                 uint64_t sub = 0;
                 if (!cap_check(c->caps[0], addr, 1, 0x1, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
             }
+            uint64_t pa;
+            if (!cpu_translate(c, m, addr, MMU_R, &pa)) return TRAP_NONE;
+            if (!mem_is_ram(m, pa)) {
+                const Region *r = mem_region(m, pa);
+                if (!r) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                if (r->kind == REGION_RAM && c->watch &&
+                    watch_access(c, m, pa, (size_t)1 << (f3 & 0x3), MMU_R, 0)) return TRAP_WATCH;
+                if (r->kind == REGION_MMIO) {
+                    if (f3 == 0x7) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                    size_t size = (size_t)1 << (f3 & 0x3);
+                    if (addr & (size - 1)) { trap_entry(c, 4, addr, false); return TRAP_NONE; }
+                    uint64_t v = 0;
+                    if (!r->load(r->ctx, pa, size, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    write_reg(c, rd, load_extend(f3, v));
+                    break;
+                }
+            }
             uint64_t val = 0;
             switch (f3) {
                 case 0x0: { // ldb
-                    uint8_t v; if (!mem_read_u8(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint8_t v; if (!mem_read_u8(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = (int64_t)sign_extend(v, 8); break;
                 }
                 case 0x4: { // ldbu
-                    uint8_t v; if (!mem_read_u8(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint8_t v; if (!mem_read_u8(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = v; break;
                 }
                 case 0x1: { // ldh
                     if (addr & 0x1) { trap_entry(c, 4, addr, false); return TRAP_NONE; }
-                    uint16_t v; if (!mem_read_u16(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint16_t v; if (!mem_read_u16(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = (int64_t)sign_extend(v, 16); break;
                 }
                 case 0x5: { // ldhu
                     if (addr & 0x1) { trap_entry(c, 4, addr, false); return TRAP_NONE; }
-                    uint16_t v; if (!mem_read_u16(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint16_t v; if (!mem_read_u16(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = v; break;
                 }
                 case 0x2: { // ldw
                     if (addr & 0x3) { trap_entry(c, 4, addr, false); return TRAP_NONE; }
-                    uint32_t v; if (!mem_read_u32(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint32_t v; if (!mem_read_u32(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = (int64_t)sign_extend(v, 32); break;
                 }
                 case 0x6: { // ldwu
                     if (addr & 0x3) { trap_entry(c, 4, addr, false); return TRAP_NONE; }
-                    uint32_t v; if (!mem_read_u32(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint32_t v; if (!mem_read_u32(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = v; break;
                 }
                 case 0x3: { // ld
                     if (addr & 0x7) { trap_entry(c, 4, addr, false); return TRAP_NONE; }
-                    uint64_t v; if (!mem_read_u64(m, addr, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                    uint64_t v; if (!mem_read_u64(m, pa, &v)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                     val = v; break;
                 }
                 default: trap_entry(c, 2, insn, false); return TRAP_NONE;
@@ -910,22 +1590,27 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 uint64_t sub = 0;
                 if (!cap_check(c->caps[0], addr, 1, 0x2, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
             }
+            uint64_t pa;
+            if (!cpu_translate(c, m, addr, MMU_W, &pa)) return TRAP_NONE;
             uint64_t val = c->regs[rs2];
-            if (addr == UART_TX_ADDR) {
-                switch (f3) {
-                    case 0x0: uart_write(val, 1); break; // stb
-                    case 0x1: uart_write(val, 2); break; // sth
-                    case 0x2: uart_write(val, 4); break; // stw
-                    case 0x3: uart_write(val, 8); break; // st
-                    default: trap_entry(c, 2, insn, false); return TRAP_NONE;
+            if (!mem_is_ram(m, pa)) {
+                const Region *r = mem_region(m, pa);
+                if (!r || r->kind == REGION_ROM) { trap_entry(c, 7, addr, false); return TRAP_NONE; }
+                if (r->kind == REGION_RAM) {
+                    if (c->watch && watch_access(c, m, pa, (size_t)1 << (f3 & 0x3), MMU_W, val)) return TRAP_WATCH;
+                } else {
+                    if (f3 > 0x3) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                    size_t size = (size_t)1 << f3;
+                    if (addr & (size - 1)) { trap_entry(c, 6, addr, false); return TRAP_NONE; }
+                    if (!r->store(r->ctx, pa, size, val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; }
+                    break;
                 }
-                break;
             }
             switch (f3) {
-                case 0x0: if (!mem_write_u8(m, addr, (uint8_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // stb
-                case 0x1: if (addr & 0x1) { trap_entry(c, 6, addr, false); return TRAP_NONE; } if (!mem_write_u16(m, addr, (uint16_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // sth
-                case 0x2: if (addr & 0x3) { trap_entry(c, 6, addr, false); return TRAP_NONE; } if (!mem_write_u32(m, addr, (uint32_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // stw
-                case 0x3: if (addr & 0x7) { trap_entry(c, 6, addr, false); return TRAP_NONE; } if (!mem_write_u64(m, addr, (uint64_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // st
+                case 0x0: if (!mem_write_u8(m, pa, (uint8_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // stb
+                case 0x1: if (addr & 0x1) { trap_entry(c, 6, addr, false); return TRAP_NONE; } if (!mem_write_u16(m, pa, (uint16_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // sth
+                case 0x2: if (addr & 0x3) { trap_entry(c, 6, addr, false); return TRAP_NONE; } if (!mem_write_u32(m, pa, (uint32_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // stw
+                case 0x3: if (addr & 0x7) { trap_entry(c, 6, addr, false); return TRAP_NONE; } if (!mem_write_u64(m, pa, (uint64_t)val)) { trap_entry(c, 7, addr, false); return TRAP_NONE; } break; // st
                 default: trap_entry(c, 2, insn, false); return TRAP_NONE;
             }
             break;
@@ -944,16 +1629,23 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 default: trap_entry(c, 2, insn, false); return TRAP_NONE;
             }
             if (take) pc_next = c->pc + (uint64_t)imm_b(insn);
+            if (c->cov_map) cov_edge(c, pc_next);
+            if (c->coverage) cov_branch(c->coverage, c->pc, take, pc_next);
+            if (c->stats) c->stats->branch_taken[take]++;
             break;
         }
         case OP_JAL: {
             write_reg(c, rd, c->pc + 4);
             pc_next = c->pc + (uint64_t)imm_j(insn);
+            if (c->cov_map) cov_edge(c, pc_next);
+            if (c->coverage) cov_block(c->coverage, pc_next);
             break;
         }
         case OP_JALR: {
             write_reg(c, rd, c->pc + 4);
             pc_next = (c->regs[rs1] + (uint64_t)imm_i(insn)) & ~0x3ull;
+            if (c->cov_map) cov_edge(c, pc_next);
+            if (c->coverage) cov_block(c->coverage, pc_next);
             break;
         }
         case OP_MOVHI: {
@@ -968,10 +1660,17 @@ Trap cpu_step(Cpu *c, Mem *m) {
             break;
         case OP_SYSTEM: {
             uint32_t imm = get_bits(insn, 31, 20);
+            if (f3 == 0 && rd == 0 && f7 == 0x09) { // sfence.vma
+                if (c->mode == MODE_U) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                if (rs1 == 0) mmu_flush(&c->mmu);
+                else mmu_flush_va(&c->mmu, c->regs[rs1]);
+                break;
+            }
             if (f3 == 0 && rd == 0 && rs1 == 0) {
                 if (imm == 0x000) {
                     Trap t = syscall_handle(c, m);
                     if (t == TRAP_NONE) break;
+                    if (t == SYSCALL_TRAPPED) return TRAP_NONE;
                     if (t == TRAP_EBREAK) return TRAP_EBREAK;
                     uint64_t cause = (c->mode == MODE_U) ? 8 : (c->mode == MODE_S ? 9 : 10);
                     trap_entry(c, cause, 0, false);
@@ -980,6 +1679,10 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 if (imm == 0x001) {
                     return TRAP_EBREAK;
                 }
+                if (imm == 0x105) { // wfi
+                    cpu_wfi(c);
+                    break;
+                }
                 if (imm == 0x302) { // mret
                     uint64_t mpp = (c->mstatus & MSTATUS_MPP_MASK) >> MSTATUS_MPP_SHIFT;
                     c->mode = (PrivMode)mpp;
@@ -987,8 +1690,10 @@ Trap cpu_step(Cpu *c, Mem *m) {
                     uint64_t mie = (c->mstatus & MSTATUS_MPIE) ? 1 : 0;
                     if (mie) c->mstatus |= MSTATUS_MIE; else c->mstatus &= ~MSTATUS_MIE;
                     c->mstatus |= MSTATUS_MPIE;
+                    cpu_irq_update(c);
                     c->pc = c->mepc;
                     pc_next = c->pc;
+                    if (c->coverage) cov_block(c->coverage, c->pc);
                     break;
                 }
                 if (imm == 0x102) { // sret
@@ -998,8 +1703,10 @@ Trap cpu_step(Cpu *c, Mem *m) {
                     uint64_t sie = (c->mstatus & MSTATUS_SPIE) ? 1 : 0;
                     if (sie) c->mstatus |= MSTATUS_SIE; else c->mstatus &= ~MSTATUS_SIE;
                     c->mstatus |= MSTATUS_SPIE;
+                    cpu_irq_update(c);
                     c->pc = c->sepc;
                     pc_next = c->pc;
+                    if (c->coverage) cov_block(c->coverage, c->pc);
                     break;
                 }
             }
@@ -1090,8 +1797,10 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 uint64_t addr = c->regs[rs1] + (uint64_t)imm_i(insn);
                 uint64_t sub = 0;
                 if (!cap_check(c->caps[0], addr, 16, 0x1, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
+                uint64_t pa;
+                if (!cpu_translate(c, m, addr, MMU_R, &pa)) return TRAP_NONE;
                 uint8_t buf[16]; bool tag;
-                if (!mem_read_cap(m, addr, buf, &tag)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
+                if (!mem_read_cap(m, pa, buf, &tag)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
                 cap_decode(&c->caps[rd], buf, tag);
                 break;
             }
@@ -1099,28 +1808,42 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 uint64_t addr = c->regs[rs1] + (uint64_t)imm_i(insn);
                 uint64_t sub = 0;
                 if (!cap_check(c->caps[0], addr, 16, 0x2, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
+                uint64_t pa;
+                if (!cpu_translate(c, m, addr, MMU_W, &pa)) return TRAP_NONE;
                 uint8_t buf[16];
                 cap_encode(&c->caps[rd], buf);
-                if (!mem_write_cap(m, addr, buf, c->caps[rd].tag)) { trap_entry(c, 7, addr, false); return TRAP_NONE; }
+                if (!mem_write_cap(m, pa, buf, c->caps[rd].tag)) { trap_entry(c, 7, addr, false); return TRAP_NONE; }
                 break;
             }
             trap_entry(c, 2, insn, false);
             return TRAP_NONE;
         }
         case OP_TENSOR: {
+            if (c->stats) c->stats->tensor[f3]++;
             uint32_t trd = rd & 0x7;
             uint32_t trs1 = rs1 & 0x7;
             uint32_t trs2 = rs2 & 0x7;
 
             bool rtype = (rs1 < 8) && (rs2 < 8);
+            // mstatus.TS (mina-t.md 4.1): with the state Off every tensor
+            // instruction is illegal, so a kernel can leave a thread's
+            // tensor state in place until the thread first uses it. A
+            // write marks the state Dirty once it has executed; illegal
+            // encodings trap first and leave TS alone. The tensor_* helpers
+            // reject bad formats before touching a register, so testing
+            // their result is enough. A tld that faults part way has already
+            // written the rows before the fault and marks Dirty as well.
+            if (!(c->mstatus & MSTATUS_TS_MASK)) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
             if (rtype && f3 == 0x0 && f7 == 0x00) { // tadd
                 Trap t = tensor_tadd(c, trd, trs1, trs2);
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                c->mstatus |= MSTATUS_TS_DIRTY;
                 break;
             }
             if (rtype && f3 == 0x1 && f7 == 0x01) { // tmma
                 Trap t = tensor_tmma(c, trd, trs1, trs2);
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                c->mstatus |= MSTATUS_TS_DIRTY;
                 break;
             }
 
@@ -1131,7 +1854,10 @@ Trap cpu_step(Cpu *c, Mem *m) {
                     uint64_t sub = 0;
                     if (!cap_check(c->caps[0], base, 16, 0x1, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
                 }
-                Trap t = tensor_tld(c, m, trd, base, stride);
+                uint64_t fault = base;
+                Trap t = tensor_tld(c, m, trd, base, stride, &fault);
+                if (t == TRAP_NONE || t == TRAP_LOAD_PAGE_FAULT || t == TRAP_LOAD_FAULT) c->mstatus |= MSTATUS_TS_DIRTY;
+                if (t == TRAP_LOAD_PAGE_FAULT) { trap_entry(c, 13, fault, false); return TRAP_NONE; }
                 if (t == TRAP_LOAD_MISALIGNED) { trap_entry(c, 4, base, false); return TRAP_NONE; }
                 if (t == TRAP_LOAD_FAULT) { trap_entry(c, 5, base, false); return TRAP_NONE; }
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
@@ -1144,7 +1870,9 @@ Trap cpu_step(Cpu *c, Mem *m) {
                     uint64_t sub = 0;
                     if (!cap_check(c->caps[0], base, 16, 0x2, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
                 }
-                Trap t = tensor_tst(c, m, trd, base, stride);
+                uint64_t fault = base;
+                Trap t = tensor_tst(c, m, trd, base, stride, &fault);
+                if (t == TRAP_STORE_PAGE_FAULT) { trap_entry(c, 15, fault, false); return TRAP_NONE; }
                 if (t == TRAP_STORE_MISALIGNED) { trap_entry(c, 6, base, false); return TRAP_NONE; }
                 if (t == TRAP_STORE_FAULT) { trap_entry(c, 7, base, false); return TRAP_NONE; }
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
@@ -1155,16 +1883,19 @@ Trap cpu_step(Cpu *c, Mem *m) {
                 uint32_t imm = (uint32_t)imm_i(insn) & 0x7;
                 Trap t = tensor_tact(c, trd, imm);
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                c->mstatus |= MSTATUS_TS_DIRTY;
                 break;
             }
             if (f3 == 0x3) { // tcvt
                 uint32_t imm = (uint32_t)imm_i(insn) & 0xF;
                 Trap t = tensor_tcvt(c, trd, trs1, imm);
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                c->mstatus |= MSTATUS_TS_DIRTY;
                 break;
             }
             if (f3 == 0x4) { // tzero
                 if (rs1 != rd) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                c->mstatus |= MSTATUS_TS_DIRTY;
                 for (int i = 0; i < 256; i++) c->tregs[trd].v[i] = 0.0f;
                 break;
             }
@@ -1177,56 +1908,110 @@ Trap cpu_step(Cpu *c, Mem *m) {
             if (f3 == 0x6) { // tscale
                 Trap t = tensor_tscale(c, trd, c->regs[rs1]);
                 if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                c->mstatus |= MSTATUS_TS_DIRTY;
+                break;
+            }
+            if (f3 == 0x7 && rd == 0 && (imm_i(insn) == 0 || imm_i(insn) == 1)) { // tsave / trestore
+                bool save = imm_i(insn) == 0;
+                uint64_t base = c->regs[rs1];
+                if (c->mstatus & MSTATUS_CAP) {
+                    uint64_t sub = 0;
+                    if (!cap_check(c->caps[0], base, TSAVE_SIZE, save ? 0x2 : 0x1, &sub)) {
+                        trap_entry(c, 11, sub, false);
+                        return TRAP_NONE;
+                    }
+                }
+                uint64_t fault = base;
+                Trap t = save ? tensor_tsave(c, m, base, &fault) : tensor_trestore(c, m, base, &fault);
+                if (t == TRAP_STORE_PAGE_FAULT) { trap_entry(c, 15, fault, false); return TRAP_NONE; }
+                if (t == TRAP_LOAD_PAGE_FAULT) { trap_entry(c, 13, fault, false); return TRAP_NONE; }
+                if (t == TRAP_STORE_MISALIGNED) { trap_entry(c, 6, base, false); return TRAP_NONE; }
+                if (t == TRAP_LOAD_MISALIGNED) { trap_entry(c, 4, base, false); return TRAP_NONE; }
+                if (t == TRAP_STORE_FAULT) { trap_entry(c, 7, fault, false); return TRAP_NONE; }
+                if (t == TRAP_LOAD_FAULT) { trap_entry(c, 5, fault, false); return TRAP_NONE; }
+                if (t != TRAP_NONE) { trap_entry(c, 2, insn, false); return TRAP_NONE; }
+                if (!save) c->mstatus |= MSTATUS_TS_DIRTY;
                 break;
             }
             trap_entry(c, 2, insn, false);
             return TRAP_NONE;
         }
         case OP_AMO: {
+            // funct7 = funct5 << 2 | aq << 1 | rl; aq/rl are reserved (0).
             uint64_t addr = c->regs[rs1];
-            if (f7 == 0x04) { // amoswap
-                if (f3 == 0x2) { // amoswap.w
-                    if (addr & 0x3) { trap_entry(c, 6, addr, false); return TRAP_NONE; }
-                    if (c->mstatus & MSTATUS_CAP) {
-                        uint64_t sub = 0;
-                        if (!cap_check(c->caps[0], addr, 4, 0x3, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
-                    }
-                    uint32_t oldv = 0;
-                    if (!mem_read_u32(m, addr, &oldv)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
-                    uint32_t newv = (uint32_t)c->regs[rs2];
-                    if (!mem_write_u32(m, addr, newv)) { trap_entry(c, 7, addr, false); return TRAP_NONE; }
-                    write_reg(c, rd, (uint64_t)sign_extend(oldv, 32));
-                    break;
-                }
-                if (f3 == 0x3) { // amoswap.d
-                    if (addr & 0x7) { trap_entry(c, 6, addr, false); return TRAP_NONE; }
-                    if (c->mstatus & MSTATUS_CAP) {
-                        uint64_t sub = 0;
-                        if (!cap_check(c->caps[0], addr, 8, 0x3, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
-                    }
-                    uint64_t oldv = 0;
-                    if (!mem_read_u64(m, addr, &oldv)) { trap_entry(c, 5, addr, false); return TRAP_NONE; }
-                    uint64_t newv = c->regs[rs2];
-                    if (!mem_write_u64(m, addr, newv)) { trap_entry(c, 7, addr, false); return TRAP_NONE; }
-                    write_reg(c, rd, oldv);
-                    break;
-                }
+            uint32_t op = f7 >> 2;
+            if ((f3 != 0x2 && f3 != 0x3) || (f7 & 0x3) || !amo_valid(op) || (op == AMO_LR && rs2 != 0)) {
+                trap_entry(c, 2, insn, false);
+                return TRAP_NONE;
             }
-            trap_entry(c, 2, insn, false);
-            return TRAP_NONE;
+            size_t size = (f3 == 0x2) ? 4 : 8;
+            bool lr = (op == AMO_LR);
+            bool sc = (op == AMO_SC);
+            uint16_t need = lr ? 0x1 : (sc ? 0x2 : 0x3);
+            if (addr & (size - 1)) { trap_entry(c, lr ? 4 : 6, addr, false); return TRAP_NONE; }
+            if (c->mstatus & MSTATUS_CAP) {
+                uint64_t sub = 0;
+                if (!cap_check(c->caps[0], addr, size, need, &sub)) { trap_entry(c, 11, sub, false); return TRAP_NONE; }
+            }
+            uint64_t pa;
+            if (!cpu_translate(c, m, addr, lr ? MMU_R : (sc ? MMU_W : MMU_R | MMU_W), &pa)) return TRAP_NONE;
+            // Atomics operate on RAM only, through host atomics on guest memory.
+            uint8_t *p = NULL;
+            if (mem_is_ram(m, pa)) {
+                p = mem_ptr(m, pa, size);
+            } else if (mem_is_watched(m, pa)) {
+                if (c->watch && watch_access(c, m, pa, size, lr ? MMU_R : (sc ? MMU_W : MMU_R | MMU_W), c->regs[rs2])) return TRAP_WATCH;
+                p = mem_ptr(m, pa, size);
+            }
+            if (!p) { trap_entry(c, lr ? 5 : 7, addr, false); return TRAP_NONE; }
+            uint64_t res;
+            if (lr) {
+                res = amo_load(p, size);
+                c->resv_valid = true;
+                c->resv_addr = pa;
+                c->resv_size = (uint8_t)size;
+                c->resv_val = res;
+            } else if (sc) {
+                bool ok = c->resv_valid && c->resv_addr == pa && c->resv_size == size &&
+                          amo_cas(p, size, c->resv_val, c->regs[rs2]);
+                c->resv_valid = false;
+                res = ok ? 0 : 1;
+            } else {
+                res = amo_rmw(p, size, op, c->regs[rs2]);
+            }
+            if (size == 4 && !sc) res = (uint64_t)sign_extend(res & 0xFFFFFFFFu, 32);
+            write_reg(c, rd, res);
+            break;
         }
         default:
             trap_entry(c, 2, insn, false);
             return TRAP_NONE;
     }
 
-    c->pc = pc_next;
-    c->steps++;
-    c->cycle++;
-    c->instret++;
-    c->time = c->cycle;
+    cpu_retire(c, pc_next);
 
     if (c->dump_regs) cpu_dump_regs(c);
 
+    if (fused) {
+        int kind = fuse_kind(opcode, f3, f7, rd, rs1);
+        if (kind >= 0) return cpu_fuse(c, m, kind, rd, fetch_pa, fused);
+    }
     return TRAP_NONE;
 }
+
+Trap cpu_step(Cpu *c, Mem *m) {
+    return cpu_exec(c, m, NULL);
+}
+
+Trap cpu_run(Cpu *c, Mem *m, uint64_t max_steps, uint64_t *done) {
+    uint64_t n = 0;
+    Trap t = TRAP_NONE;
+    while (n < max_steps) {
+        unsigned fused = 0;
+        t = cpu_exec(c, m, max_steps - n > 1 ? &fused : NULL);
+        if (t != TRAP_NONE) break;
+        n += 1 + fused;
+    }
+    *done = n;
+    return t;
+}
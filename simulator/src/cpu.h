@@ -2,8 +2,11 @@
 #define MINA_CPU_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "event.h"
 #include "mem.h"
+#include "mmu.h"
 
 typedef enum {
     TRAP_NONE = 0,
@@ -18,6 +21,9 @@ typedef enum {
     TRAP_EBREAK,
     TRAP_UNIMPLEMENTED,
     TRAP_CAP_FAULT,
+    TRAP_LOAD_PAGE_FAULT,
+    TRAP_STORE_PAGE_FAULT,
+    TRAP_WATCH, // stopped by a --watch/--break point before the instruction
 } Trap;
 
 typedef enum {
@@ -50,7 +56,28 @@ typedef struct {
     float v[256];
 } TensorReg;
 
+struct Cpu;
+struct Dma;
+
+typedef enum {
+    HOST_SYSCALL_DEFAULT = 0, // not handled: run the built-in syscall
+    HOST_SYSCALL_DONE,        // handled: continue after the ecall
+    HOST_SYSCALL_HALT,        // handled: stop like SYS_exit
+} HostSyscallResult;
+
+// Host hooks for embedders (see minasim.h). A NULL console callback means
+// the process's stdin/stdout/stderr; a NULL syscall callback sends every
+// ecall to the built-in handler.
 typedef struct {
+    void *ctx;
+    // fd is 1 or 2; UART TX writes to 1.
+    void (*console_write)(void *ctx, int fd, const uint8_t *buf, size_t len);
+    // Must not block: returns the bytes available now, 0 if none.
+    size_t (*console_read)(void *ctx, uint8_t *buf, size_t len);
+    HostSyscallResult (*syscall)(void *ctx, struct Cpu *c, Mem *m);
+} CpuHost;
+
+typedef struct Cpu {
     uint64_t regs[32];
     uint64_t pc;
     uint64_t steps;
@@ -63,17 +90,88 @@ typedef struct {
     uint64_t sstatus, sie, stvec, sip, sscratch, sepc, scause, stval;
     uint64_t cycle, time, instret;
 
+    // satp, the software TLB and its hit/miss counters.
+    Mmu mmu;
+
+    // Set when mip & mie holds an interrupt that is enabled in the current
+    // mode; recomputed by cpu_irq_update on CSR writes, trap entry/return
+    // and device events rather than on every step.
+    bool irq_pending;
+    EventQueue events;
+
+    // CLINT timer state (mtime = cycle + mtime_offset)
+    uint64_t mtimecmp, stimecmp;
+    uint64_t mtime_offset;
+
+    // lr/sc reservation: physical address, size and the value lr saw.
+    bool resv_valid;
+    uint8_t resv_size;
+    uint64_t resv_addr;
+    uint64_t resv_val;
+
     CapReg caps[32];
     TensorReg tregs[8];
 
-    uint8_t uart_rx[256];
-    uint32_t uart_rx_head;
-    uint32_t uart_rx_tail;
-    uint32_t uart_rx_count;
+    uint32_t uart_ctrl;
+    uint32_t seip_lines;
+    bool in_wfi;
+
+    // a0 of SYS_exit; set when an exception (other than ecall) was taken
+    // into a zero trap vector, i.e. with no handler installed.
+    uint64_t exit_code;
+    bool fault_unhandled;
+
+    // Edge coverage at branch and jump targets: map[prev ^ cur]++ with
+    // cur a hash of the target PC (AFL layout). NULL when off.
+    uint8_t *cov_map;
+    uint32_t cov_prev;
+    // PC-keyed block/branch bitmaps for --coverage. NULL when off.
+    struct Coverage *coverage;
+    // --watch/--break points (watch.h). NULL when none are set.
+    struct Watch *watch;
+    // --stats counters (stats.h). NULL when off.
+    struct CpuStats *stats;
+    // --record/--replay input log (replay.h). NULL when off.
+    struct Replay *replay;
+
+    // Cycles charged per 8-byte word by the memory syscalls (SYS_memcpy
+    // ... SYS_strlen), which otherwise retire as one instruction.
+    uint32_t memcall_cycles;
+
+    CpuHost host;
+    int rx_peek; // console_read lookahead byte for UART STATUS, -1 if none
+    struct Dma *dma;
 } Cpu;
 
+#define COV_MAP_SIZE 65536u
+#define CPU_MEMCALL_CYCLES 1u
+
+// Device interrupt lines ORed into mip.SEIP.
+#define MIP_SEIP (1ull << 9)
+#define IRQ_LINE_BLK 0x1u
+#define IRQ_LINE_DMA 0x2u
+
 void cpu_init(Cpu *c, uint64_t entry);
+// Map the CLINT, UART, block device and DMA engine into the physical
+// address map.
+bool cpu_map_devices(Cpu *c, Mem *m);
+// Back to power-on state at entry, keeping the mappings made by
+// cpu_map_devices (the device callbacks still point at c).
+bool cpu_reset(Cpu *c, Mem *m, uint64_t entry);
+// Release per-hart device state (stops the DMA worker).
+void cpu_free(Cpu *c);
 Trap cpu_step(Cpu *c, Mem *m);
+// Up to max_steps steps, stopping at the first trap returned; *done is the
+// number taken. Unlike a cpu_step loop this may execute some instruction
+// pairs as one fused step (see cpu_fuse), which counts as two.
+Trap cpu_run(Cpu *c, Mem *m, uint64_t max_steps, uint64_t *done);
 void cpu_dump_regs(const Cpu *c);
+void cpu_irq_update(Cpu *c);
+void cpu_set_mip(Cpu *c, uint64_t bits);
+void cpu_clear_mip(Cpu *c, uint64_t bits);
+void cpu_set_irq_line(Cpu *c, uint32_t line, bool level);
+// Capability check for a device/host access on behalf of the guest
+// (DDC, when mstatus.CAP=1 outside M-mode).
+bool cpu_cap_allows(const Cpu *c, uint64_t addr, uint64_t len, uint16_t need);
 
 #endif
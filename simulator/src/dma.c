@@ -0,0 +1,267 @@
+#include "dma.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const uint8_t *src;
+    uint8_t *dst;
+    uint64_t len;
+    uint64_t rows;
+    uint64_t src_stride;
+    uint64_t dst_stride;
+    uint8_t fill;
+    bool is_fill;
+} DmaJob;
+
+// One transfer in flight at a time. `started`/`finished` count transfers;
+// the worker only ever writes `finished`, the hart everything else.
+struct Dma {
+    Mem *mem;
+    uint64_t src, dst, len, rows, src_stride, dst_stride, fill;
+    uint32_t ctrl;
+    uint32_t status;
+    DmaJob job;
+    atomic_uint started;
+    atomic_uint finished;
+    uint32_t seen;
+
+    bool threaded;
+    bool thread_tried;
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+};
+
+Dma *dma_create(Mem *m) {
+    Dma *d = (Dma *)calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->mem = m;
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->work, NULL);
+    pthread_cond_init(&d->done, NULL);
+    return d;
+}
+
+static void dma_run(const DmaJob *j) {
+    const uint8_t *s = j->src;
+    uint8_t *d = j->dst;
+    for (uint64_t r = 0; r < j->rows; r++) {
+        if (j->is_fill) memset(d, j->fill, (size_t)j->len);
+        else memmove(d, s, (size_t)j->len);
+        s += j->src_stride;
+        d += j->dst_stride;
+    }
+}
+
+static void *dma_worker(void *arg) {
+    Dma *d = (Dma *)arg;
+    uint32_t done = atomic_load(&d->finished);
+    for (;;) {
+        pthread_mutex_lock(&d->lock);
+        while (!d->stop && done == atomic_load(&d->started)) pthread_cond_wait(&d->work, &d->lock);
+        if (done == atomic_load(&d->started)) {
+            pthread_mutex_unlock(&d->lock);
+            return NULL;
+        }
+        DmaJob job = d->job;
+        pthread_mutex_unlock(&d->lock);
+
+        dma_run(&job);
+        done++;
+        pthread_mutex_lock(&d->lock);
+        atomic_store_explicit(&d->finished, done, memory_order_release);
+        pthread_cond_broadcast(&d->done);
+        pthread_mutex_unlock(&d->lock);
+    }
+}
+
+// The worker drains the in-flight transfer before it sees `stop`.
+static void dma_stop_worker(Dma *d) {
+    if (!d->threaded) return;
+    pthread_mutex_lock(&d->lock);
+    d->stop = true;
+    pthread_cond_broadcast(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->thread, NULL);
+    d->threaded = false;
+}
+
+void dma_quiesce(Dma *d) {
+    dma_stop_worker(d);
+    d->stop = false;
+    d->thread_tried = false;
+}
+
+void dma_destroy(Dma *d) {
+    if (!d) return;
+    dma_stop_worker(d);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->work);
+    pthread_cond_destroy(&d->done);
+    free(d);
+}
+
+static inline bool dma_busy(Dma *d) {
+    return atomic_load_explicit(&d->finished, memory_order_acquire) != atomic_load(&d->started);
+}
+
+static void dma_poll(void *ctx, uint64_t now);
+
+static void dma_sync(Cpu *c) {
+    Dma *d = c->dma;
+    event_cancel(&c->events, dma_poll, c);
+    uint32_t fin = atomic_load_explicit(&d->finished, memory_order_acquire);
+    if (fin != d->seen) {
+        d->seen = fin;
+        d->status |= DMA_STATUS_DONE;
+    }
+    cpu_set_irq_line(c, IRQ_LINE_DMA, (d->status & DMA_STATUS_DONE) && (d->ctrl & DMA_CTRL_IE));
+    if (dma_busy(d)) event_schedule(&c->events, c->cycle + DMA_POLL_CYCLES, dma_poll, c);
+}
+
+static void dma_poll(void *ctx, uint64_t now) {
+    Cpu *c = (Cpu *)ctx;
+    Dma *d = c->dma;
+    (void)now;
+    if (c->in_wfi && dma_busy(d)) {
+        if (c->events.count > 0) {
+            event_schedule(&c->events, c->events.next, dma_poll, c);
+            return;
+        }
+        pthread_mutex_lock(&d->lock);
+        while (dma_busy(d)) pthread_cond_wait(&d->done, &d->lock);
+        pthread_mutex_unlock(&d->lock);
+    }
+    dma_sync(c);
+}
+
+// Bytes spanned by a strided guest range, after checking it against the
+// DDC; 0 if it overflows or the capability refuses it.
+static uint64_t dma_extent(Cpu *c, uint64_t base, uint64_t len, uint64_t rows, uint64_t stride, uint16_t need) {
+    if (stride != 0 && rows - 1 > (UINT64_MAX - len) / stride) return 0;
+    uint64_t extent = (rows - 1) * stride + len;
+    if (!cpu_cap_allows(c, base, extent, need)) return 0;
+    return extent;
+}
+
+static void dma_start(Cpu *c) {
+    Dma *d = c->dma;
+    if (dma_busy(d)) return;
+    d->status &= ~(DMA_STATUS_DONE | DMA_STATUS_ERR);
+    DmaJob j;
+    j.len = d->len;
+    j.rows = d->rows ? d->rows : 1;
+    j.src_stride = d->src_stride;
+    j.dst_stride = d->dst_stride;
+    j.fill = (uint8_t)d->fill;
+    j.is_fill = (d->ctrl & DMA_CTRL_FILL) != 0;
+    j.src = NULL;
+    // Only the destination is written, so only it is marked dirty.
+    uint64_t extent = dma_extent(c, d->dst, j.len, j.rows, j.dst_stride, 0x2);
+    j.dst = extent ? mem_ptr(d->mem, d->dst, (size_t)extent) : NULL;
+    if (!j.is_fill) {
+        extent = dma_extent(c, d->src, j.len, j.rows, j.src_stride, 0x1);
+        j.src = extent ? mem_cptr(d->mem, d->src, (size_t)extent) : NULL;
+    }
+    if (j.len == 0 || !j.dst || (!j.is_fill && !j.src)) {
+        if (j.len != 0) d->status |= DMA_STATUS_ERR;
+        d->status |= DMA_STATUS_DONE;
+        dma_sync(c);
+        return;
+    }
+
+    // A recorded or replayed run must not see host timing in STATUS.
+    if (!d->thread_tried && !c->replay) {
+        d->thread_tried = true;
+        d->threaded = pthread_create(&d->thread, NULL, dma_worker, d) == 0;
+    }
+    if (!d->threaded) {
+        // No worker thread available: complete synchronously.
+        dma_run(&j);
+        d->status |= DMA_STATUS_DONE;
+        dma_sync(c);
+        return;
+    }
+    pthread_mutex_lock(&d->lock);
+    d->job = j;
+    atomic_fetch_add(&d->started, 1);
+    pthread_cond_signal(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    dma_sync(c);
+}
+
+static uint64_t *dma_reg(Dma *d, uint64_t base) {
+    switch (base) {
+        case DMA_SRC: return &d->src;
+        case DMA_DST: return &d->dst;
+        case DMA_LEN: return &d->len;
+        case DMA_ROWS: return &d->rows;
+        case DMA_SRC_STRIDE: return &d->src_stride;
+        case DMA_DST_STRIDE: return &d->dst_stride;
+        case DMA_FILL: return &d->fill;
+        default: return NULL;
+    }
+}
+
+bool dma_load(void *ctx, uint64_t addr, size_t size, uint64_t *out) {
+    Cpu *c = (Cpu *)ctx;
+    Dma *d = c->dma;
+    if (size != 4 && size != 8) return false;
+    uint64_t off = addr & 0x7;
+    if (off + size > 8) return false;
+    uint64_t base = addr & ~0x7ull;
+    uint64_t v;
+    uint64_t *reg = dma_reg(d, base);
+    if (reg) {
+        v = *reg;
+    } else if (base == DMA_CTRL) {
+        v = d->ctrl;
+    } else if (base == DMA_STATUS) {
+        dma_sync(c);
+        v = d->status | (dma_busy(d) ? DMA_STATUS_BUSY : 0);
+    } else if (base == DMA_START) {
+        v = 0;
+    } else {
+        return false;
+    }
+    v >>= off * 8;
+    *out = (size == 8) ? v : (v & 0xFFFFFFFFull);
+    return true;
+}
+
+bool dma_store(void *ctx, uint64_t addr, size_t size, uint64_t val) {
+    Cpu *c = (Cpu *)ctx;
+    Dma *d = c->dma;
+    if (size != 4 && size != 8) return false;
+    uint64_t off = addr & 0x7;
+    if (off + size > 8) return false;
+    uint64_t base = addr & ~0x7ull;
+    uint64_t mask = (size == 8) ? UINT64_MAX : (0xFFFFFFFFull << (off * 8));
+    uint64_t bits = (val << (off * 8)) & mask;
+    uint64_t *reg = dma_reg(d, base);
+    if (reg) {
+        // Descriptor registers are latched at START; writes while busy
+        // only affect the next transfer.
+        *reg = (*reg & ~mask) | bits;
+        return true;
+    }
+    switch (base) {
+        case DMA_CTRL:
+            d->ctrl = (uint32_t)(((d->ctrl & ~mask) | bits) & (DMA_CTRL_IE | DMA_CTRL_FILL));
+            dma_sync(c);
+            return true;
+        case DMA_START:
+            dma_start(c);
+            return true;
+        case DMA_STATUS:
+            d->status &= ~(uint32_t)(bits & (DMA_STATUS_DONE | DMA_STATUS_ERR));
+            dma_sync(c);
+            return true;
+        default:
+            return false;
+    }
+}
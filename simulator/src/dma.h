@@ -0,0 +1,54 @@
+#ifndef MINA_DMA_H
+#define MINA_DMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+
+// DMA copy engine MMIO. The guest programs one 2D descriptor in registers
+// (ROWS rows of LEN bytes, advancing by SRC_STRIDE/DST_STRIDE) and writes
+// START. The transfer is checked against RAM and the DDC capability up
+// front, then runs on a worker thread with host memmove/memset while the
+// hart keeps executing. Completion sets STATUS.DONE and, with CTRL.IE,
+// raises mip.SEIP.
+
+#define DMA_BASE 0x10002000ull
+#define DMA_SIZE 0x1000ull
+
+#define DMA_SRC        (DMA_BASE + 0x00)
+#define DMA_DST        (DMA_BASE + 0x08)
+#define DMA_LEN        (DMA_BASE + 0x10) // bytes per row
+#define DMA_ROWS       (DMA_BASE + 0x18) // 0 is treated as 1
+#define DMA_SRC_STRIDE (DMA_BASE + 0x20)
+#define DMA_DST_STRIDE (DMA_BASE + 0x28)
+#define DMA_FILL       (DMA_BASE + 0x30) // fill byte (low 8 bits)
+#define DMA_CTRL       (DMA_BASE + 0x38)
+#define DMA_START      (DMA_BASE + 0x40) // WO, any value starts
+#define DMA_STATUS     (DMA_BASE + 0x48)
+
+#define DMA_CTRL_IE   0x1u
+#define DMA_CTRL_FILL 0x2u
+
+#define DMA_STATUS_BUSY 0x1u // RO
+#define DMA_STATUS_DONE 0x2u // W1C
+#define DMA_STATUS_ERR  0x4u // W1C
+
+#define DMA_POLL_CYCLES 256u
+
+typedef struct Dma Dma;
+
+// Per-hart engine state; destroy joins the worker thread if one was
+// started.
+Dma *dma_create(Mem *m);
+void dma_destroy(Dma *d);
+// Finish any transfer and join the worker; the next START starts a new
+// one. Used before fork(), which does not copy threads.
+void dma_quiesce(Dma *d);
+
+// MMIO callbacks (ctx is the Cpu).
+bool dma_load(void *ctx, uint64_t addr, size_t size, uint64_t *out);
+bool dma_store(void *ctx, uint64_t addr, size_t size, uint64_t val);
+
+#endif
@@ -0,0 +1,84 @@
+#include "event.h"
+
+// Binary min-heap ordered by deadline.
+
+static void heap_swap(EventQueue *q, uint32_t a, uint32_t b) {
+    Event t = q->heap[a];
+    q->heap[a] = q->heap[b];
+    q->heap[b] = t;
+}
+
+static void sift_up(EventQueue *q, uint32_t i) {
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (q->heap[parent].when <= q->heap[i].when) break;
+        heap_swap(q, parent, i);
+        i = parent;
+    }
+}
+
+static void sift_down(EventQueue *q, uint32_t i) {
+    for (;;) {
+        uint32_t l = 2 * i + 1;
+        uint32_t r = l + 1;
+        uint32_t min = i;
+        if (l < q->count && q->heap[l].when < q->heap[min].when) min = l;
+        if (r < q->count && q->heap[r].when < q->heap[min].when) min = r;
+        if (min == i) break;
+        heap_swap(q, min, i);
+        i = min;
+    }
+}
+
+static void update_next(EventQueue *q) {
+    q->next = q->count ? q->heap[0].when : UINT64_MAX;
+}
+
+static void remove_at(EventQueue *q, uint32_t i) {
+    q->count--;
+    if (i != q->count) {
+        q->heap[i] = q->heap[q->count];
+        sift_down(q, i);
+        sift_up(q, i);
+    }
+}
+
+void event_queue_init(EventQueue *q) {
+    q->count = 0;
+    q->next = UINT64_MAX;
+}
+
+bool event_schedule(EventQueue *q, uint64_t when, EventFn fn, void *ctx) {
+    if (q->count >= EVENT_QUEUE_MAX) return false;
+    q->heap[q->count].when = when;
+    q->heap[q->count].fn = fn;
+    q->heap[q->count].ctx = ctx;
+    sift_up(q, q->count);
+    q->count++;
+    update_next(q);
+    return true;
+}
+
+void event_cancel(EventQueue *q, EventFn fn, void *ctx) {
+    uint32_t i = 0;
+    while (i < q->count) {
+        if (q->heap[i].fn == fn && q->heap[i].ctx == ctx) {
+            remove_at(q, i);
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    update_next(q);
+}
+
+void event_run_due(EventQueue *q, uint64_t now) {
+    while (q->count && q->heap[0].when <= now) {
+        Event e = q->heap[0];
+        remove_at(q, 0);
+        update_next(q);
+        // The callback may reschedule itself.
+        e.fn(e.ctx, now);
+    }
+    update_next(q);
+}
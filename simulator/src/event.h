@@ -0,0 +1,33 @@
+#ifndef MINA_EVENT_H
+#define MINA_EVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Device event queue keyed on the simulator cycle counter.
+// Devices schedule a callback for a future cycle instead of being polled
+// on every instruction; cpu_step only compares the cycle counter against
+// `next` (the earliest deadline, UINT64_MAX when the queue is empty).
+
+#define EVENT_QUEUE_MAX 32
+
+typedef void (*EventFn)(void *ctx, uint64_t now);
+
+typedef struct {
+    uint64_t when;
+    EventFn fn;
+    void *ctx;
+} Event;
+
+typedef struct {
+    Event heap[EVENT_QUEUE_MAX];
+    uint32_t count;
+    uint64_t next;
+} EventQueue;
+
+void event_queue_init(EventQueue *q);
+bool event_schedule(EventQueue *q, uint64_t when, EventFn fn, void *ctx);
+void event_cancel(EventQueue *q, EventFn fn, void *ctx);
+void event_run_due(EventQueue *q, uint64_t now);
+
+#endif
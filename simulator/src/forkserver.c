@@ -0,0 +1,115 @@
+#define _XOPEN_SOURCE 700
+#include "forkserver.h"
+
+#ifdef __EMSCRIPTEN__
+#include <stdio.h>
+
+// No fork() or SysV shared memory in the browser build.
+int forkserver_run(Cpu *c, Mem *m, uint64_t max_steps, bool has_fork_pc, uint64_t fork_pc) {
+    (void)c; (void)m; (void)max_steps; (void)has_fork_pc; (void)fork_pc;
+    fprintf(stderr, "--forkserver is not supported in this build\n");
+    return 1;
+}
+
+#else
+#include "dma.h"
+#include "uart.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static bool write_u32(int fd, uint32_t v) {
+    return write(fd, &v, sizeof(v)) == (ssize_t)sizeof(v);
+}
+
+static bool read_u32(int fd, uint32_t *v) {
+    for (;;) {
+        ssize_t n = read(fd, v, sizeof(*v));
+        if (n == (ssize_t)sizeof(*v)) return true;
+        if (n < 0 && errno == EINTR) continue;
+        return false;
+    }
+}
+
+static uint8_t *cov_attach(void) {
+    const char *id = getenv("__AFL_SHM_ID");
+    if (!id) return NULL;
+    void *p = shmat(atoi(id), NULL, 0);
+    return (p == (void *)-1) ? NULL : (uint8_t *)p;
+}
+
+static void child_run(Cpu *c, Mem *m, uint64_t max_steps) {
+    close(FORKSRV_FD);
+    close(FORKSRV_FD + 1);
+    c->cov_prev = 0;
+    c->fault_unhandled = false;
+    Trap trap = TRAP_NONE;
+    for (uint64_t i = 0; i < max_steps && !c->fault_unhandled; i++) {
+        trap = cpu_step(c, m);
+        if (trap != TRAP_NONE) break;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    if (c->fault_unhandled || (trap != TRAP_NONE && trap != TRAP_EBREAK)) {
+        signal(SIGABRT, SIG_DFL);
+        abort();
+    }
+    _exit((int)(c->exit_code & 0xFF));
+}
+
+int forkserver_run(Cpu *c, Mem *m, uint64_t max_steps, bool has_fork_pc, uint64_t fork_pc) {
+    // Run the common prefix once, in the server.
+    if (has_fork_pc) {
+        uint64_t i = 0;
+        while (c->pc != fork_pc && i < max_steps) {
+            Trap t = cpu_step(c, m);
+            if (t != TRAP_NONE) {
+                fprintf(stderr, "forkserver: guest stopped (%d) before reaching pc=0x%llx\n",
+                        (int)t, (unsigned long long)fork_pc);
+                return 1;
+            }
+            i++;
+        }
+        if (c->pc != fork_pc) {
+            fprintf(stderr, "forkserver: pc=0x%llx not reached within the step limit\n",
+                    (unsigned long long)fork_pc);
+            return 1;
+        }
+    }
+    // fork() copies only the calling thread: the stdin reader would be
+    // lost in the child and keep consuming input in the server.
+    if (uart_rx_started()) {
+        fprintf(stderr, "forkserver: guest read console input before the fork point\n");
+        return 1;
+    }
+    dma_quiesce(c->dma);
+
+    c->cov_map = cov_attach();
+    if (!write_u32(FORKSRV_FD + 1, 0)) {
+        fprintf(stderr, "forkserver: status pipe (fd %d) is not open\n", FORKSRV_FD + 1);
+        return 1;
+    }
+    fflush(stdout);
+    fflush(stderr);
+
+    for (;;) {
+        uint32_t was_killed;
+        if (!read_u32(FORKSRV_FD, &was_killed)) return 0;
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+        if (pid == 0) child_run(c, m, max_steps);
+        int status = 0;
+        if (!write_u32(FORKSRV_FD + 1, (uint32_t)pid)) return 1;
+        while (waitpid(pid, &status, 0) < 0) {
+            if (errno != EINTR) return 1;
+        }
+        if (!write_u32(FORKSRV_FD + 1, (uint32_t)status)) return 1;
+    }
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef MINA_FORKSERVER_H
+#define MINA_FORKSERVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+
+// Fork server for coverage-guided fuzzers, speaking the AFL protocol on
+// file descriptors 198 (control, from the fuzzer) and 199 (status, to the
+// fuzzer). The program is loaded once and run up to the fork point (the
+// entry, or the first time the PC reaches `fork_pc`); then, per input, the
+// server fork()s a copy-on-write child that resumes from there with the
+// fuzzer's stdin, and reports its pid and wait status. Edge coverage goes
+// to the SysV shared memory map named by __AFL_SHM_ID (COV_MAP_SIZE bytes).
+//
+// A child exits with the SYS_exit code (0 for ebreak or the step limit).
+// An exception taken with no trap handler installed (mtvec/stvec 0, ecall
+// excepted) aborts it with SIGABRT so fuzzers record a crash.
+
+#define FORKSRV_FD 198
+
+// Returns the process exit code once the fuzzer closes the control pipe.
+int forkserver_run(Cpu *c, Mem *m, uint64_t max_steps, bool has_fork_pc, uint64_t fork_pc);
+
+#endif
@@ -0,0 +1,178 @@
+#define _XOPEN_SOURCE 700
+#include "hostfs.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+static char fs_root[PATH_MAX];
+static bool fs_root_set;
+static int files[HOSTFS_MAX_FILES];
+static bool files_init;
+
+static void files_setup(void) {
+    if (files_init) return;
+    for (int i = 0; i < HOSTFS_MAX_FILES; i++) files[i] = -1;
+    files_init = true;
+}
+
+bool hostfs_set_root(const char *path) {
+    files_setup();
+    if (!realpath(path, fs_root)) return false;
+    struct stat st;
+    if (stat(fs_root, &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    fs_root_set = true;
+    return true;
+}
+
+static int host_fd(int64_t fd) {
+    files_setup();
+    if (fd < HOSTFS_FD_BASE || fd >= HOSTFS_FD_BASE + HOSTFS_MAX_FILES) return -1;
+    return files[fd - HOSTFS_FD_BASE];
+}
+
+bool hostfs_is_file(int64_t fd) {
+    return host_fd(fd) >= 0;
+}
+
+static bool path_has_dotdot(const char *p) {
+    while (*p) {
+        const char *end = strchr(p, '/');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n == 2 && p[0] == '.' && p[1] == '.') return true;
+        if (!end) break;
+        p = end + 1;
+    }
+    return false;
+}
+
+static bool under_root(const char *real) {
+    size_t n = strlen(fs_root);
+    if (strncmp(real, fs_root, n) != 0) return false;
+    return real[n] == '\0' || real[n] == '/' || (n == 1 && fs_root[0] == '/');
+}
+
+// Build the host path for a guest path and check that its parent
+// directory resolves inside the sandbox root.
+static int64_t resolve(const char *path, char *out, size_t out_cap) {
+    while (*path == '/') path++;
+    if (path_has_dotdot(path)) return -EACCES;
+    int n = snprintf(out, out_cap, "%s/%s", fs_root, *path ? path : ".");
+    if (n < 0 || (size_t)n >= out_cap) return -ENAMETOOLONG;
+
+    char parent[PATH_MAX];
+    memcpy(parent, out, (size_t)n + 1);
+    char *slash = strrchr(parent, '/');
+    if (slash) *slash = '\0';
+    char real[PATH_MAX];
+    if (!realpath(parent[0] ? parent : "/", real)) return -errno;
+    if (!under_root(real)) return -EACCES;
+    return 0;
+}
+
+static int host_flags(uint64_t flags) {
+    int f = 0;
+    switch (flags & 0x3) {
+        case MINA_O_RDONLY: f = O_RDONLY; break;
+        case MINA_O_WRONLY: f = O_WRONLY; break;
+        case MINA_O_RDWR: f = O_RDWR; break;
+        default: return -1;
+    }
+    if (flags & MINA_O_CREAT) f |= O_CREAT;
+    if (flags & MINA_O_EXCL) f |= O_EXCL;
+    if (flags & MINA_O_TRUNC) f |= O_TRUNC;
+    if (flags & MINA_O_APPEND) f |= O_APPEND;
+    return f;
+}
+
+int64_t hostfs_open(const char *path, uint64_t flags, uint64_t mode) {
+    files_setup();
+    if (!fs_root_set) return -EACCES;
+    int hflags = host_flags(flags);
+    if (hflags < 0) return -EINVAL;
+    int slot = -1;
+    for (int i = 0; i < HOSTFS_MAX_FILES; i++) {
+        if (files[i] < 0) { slot = i; break; }
+    }
+    if (slot < 0) return -EMFILE;
+    char full[PATH_MAX];
+    int64_t r = resolve(path, full, sizeof(full));
+    if (r < 0) return r;
+    int fd = open(full, hflags | O_NOFOLLOW | O_CLOEXEC, (mode_t)(mode & 0777));
+    if (fd < 0) return -errno;
+    files[slot] = fd;
+    return HOSTFS_FD_BASE + slot;
+}
+
+int64_t hostfs_close(int64_t fd) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    files[fd - HOSTFS_FD_BASE] = -1;
+    return close(h) == 0 ? 0 : -errno;
+}
+
+int64_t hostfs_lseek(int64_t fd, int64_t off, uint64_t whence) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    int w;
+    switch (whence) {
+        case 0: w = SEEK_SET; break;
+        case 1: w = SEEK_CUR; break;
+        case 2: w = SEEK_END; break;
+        default: return -EINVAL;
+    }
+    off_t r = lseek(h, (off_t)off, w);
+    return r < 0 ? -errno : (int64_t)r;
+}
+
+int64_t hostfs_read(int64_t fd, void *buf, size_t len) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    ssize_t n;
+    do { n = read(h, buf, len); } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : (int64_t)n;
+}
+
+int64_t hostfs_write(int64_t fd, const void *buf, size_t len) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    ssize_t n;
+    do { n = write(h, buf, len); } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : (int64_t)n;
+}
+
+int64_t hostfs_pread(int64_t fd, void *buf, size_t len, uint64_t off) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    ssize_t n;
+    do { n = pread(h, buf, len, (off_t)off); } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : (int64_t)n;
+}
+
+int64_t hostfs_pwrite(int64_t fd, const void *buf, size_t len, uint64_t off) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    ssize_t n;
+    do { n = pwrite(h, buf, len, (off_t)off); } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : (int64_t)n;
+}
+
+int64_t hostfs_fstat(int64_t fd, HostfsStat *st) {
+    int h = host_fd(fd);
+    if (h < 0) return -EBADF;
+    struct stat s;
+    if (fstat(h, &s) != 0) return -errno;
+    st->size = (uint64_t)s.st_size;
+    st->mode = (uint64_t)s.st_mode;
+    st->mtime = (uint64_t)s.st_mtime;
+    st->ino = (uint64_t)s.st_ino;
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef MINA_HOSTFS_H
+#define MINA_HOSTFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sandboxed host file access for the semihosting file syscalls.
+// Guest paths are resolved below the directory given with --fs-root
+// ("/" is the root itself); ".." components and paths whose parent
+// resolves outside the root are rejected. Guest descriptors start at 3.
+// Functions return a non-negative result or a negative errno.
+
+#define HOSTFS_FD_BASE 3
+#define HOSTFS_MAX_FILES 64
+
+// Guest open(2) flags (Linux values, translated to the host's).
+#define MINA_O_RDONLY 0x0
+#define MINA_O_WRONLY 0x1
+#define MINA_O_RDWR   0x2
+#define MINA_O_CREAT  0x40
+#define MINA_O_EXCL   0x80
+#define MINA_O_TRUNC  0x200
+#define MINA_O_APPEND 0x400
+
+// Guest fstat layout: four little-endian u64 fields.
+typedef struct {
+    uint64_t size;
+    uint64_t mode;
+    uint64_t mtime;
+    uint64_t ino;
+} HostfsStat;
+
+bool hostfs_set_root(const char *path);
+bool hostfs_is_file(int64_t fd);
+
+int64_t hostfs_open(const char *path, uint64_t flags, uint64_t mode);
+int64_t hostfs_close(int64_t fd);
+int64_t hostfs_lseek(int64_t fd, int64_t off, uint64_t whence);
+int64_t hostfs_read(int64_t fd, void *buf, size_t len);
+int64_t hostfs_write(int64_t fd, const void *buf, size_t len);
+int64_t hostfs_pread(int64_t fd, void *buf, size_t len, uint64_t off);
+int64_t hostfs_pwrite(int64_t fd, const void *buf, size_t len, uint64_t off);
+int64_t hostfs_fstat(int64_t fd, HostfsStat *st);
+
+#endif
@@ -0,0 +1,173 @@
+#include "loader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    unsigned char e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} Elf64_Ehdr;
+
+typedef struct {
+    uint32_t p_type;
+    uint32_t p_flags;
+    uint64_t p_offset;
+    uint64_t p_vaddr;
+    uint64_t p_paddr;
+    uint64_t p_filesz;
+    uint64_t p_memsz;
+    uint64_t p_align;
+} Elf64_Phdr;
+
+typedef struct {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+} Elf64_Shdr;
+
+typedef struct {
+    uint32_t st_name;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+} Elf64_Sym;
+
+// [off, off + n) lies inside a buffer of len bytes.
+static inline bool in_buf(uint64_t off, uint64_t n, size_t len) {
+    return off <= len && n <= len - off;
+}
+
+static bool elf_header(const uint8_t *buf, size_t len, Elf64_Ehdr *eh) {
+    if (!in_buf(0, sizeof(*eh), len)) return false;
+    memcpy(eh, buf, sizeof(*eh));
+    if (eh->e_ident[0] != 0x7F || eh->e_ident[1] != 'E' || eh->e_ident[2] != 'L' || eh->e_ident[3] != 'F') return false;
+    if (eh->e_ident[4] != 2 || eh->e_ident[5] != 1) return false;
+    if (eh->e_phentsize != sizeof(Elf64_Phdr)) return false;
+    if (eh->e_phoff > len || (uint64_t)eh->e_phnum * sizeof(Elf64_Phdr) > len - eh->e_phoff) return false;
+    return true;
+}
+
+bool load_elf_image(Mem *m, const uint8_t *buf, size_t len, uint64_t *entry_out) {
+    Elf64_Ehdr eh;
+    if (!elf_header(buf, len, &eh)) return false;
+
+    for (uint16_t i = 0; i < eh.e_phnum; i++) {
+        Elf64_Phdr ph;
+        memcpy(&ph, buf + eh.e_phoff + (uint64_t)i * sizeof(Elf64_Phdr), sizeof(ph));
+        if (ph.p_type != 1) continue;
+        if (ph.p_filesz > ph.p_memsz) return false;
+        if (ph.p_vaddr > m->size || ph.p_memsz > m->size - ph.p_vaddr) return false;
+        if (ph.p_filesz > 0) {
+            if (!in_buf(ph.p_offset, ph.p_filesz, len)) return false;
+            if (!mem_write(m, ph.p_vaddr, buf + ph.p_offset, (size_t)ph.p_filesz)) return false;
+        }
+        if (ph.p_memsz > ph.p_filesz) {
+            uint64_t zero_start = ph.p_vaddr + ph.p_filesz;
+            size_t zero_len = (size_t)(ph.p_memsz - ph.p_filesz);
+            mem_mark_dirty(m, zero_start, zero_len);
+            memset(&m->data[zero_start], 0, zero_len);
+        }
+    }
+
+    *entry_out = eh.e_entry;
+    return true;
+}
+
+size_t load_image_code(const uint8_t *buf, size_t len, ImageSegment *out, size_t max) {
+    Elf64_Ehdr eh;
+    if (!elf_header(buf, len, &eh)) {
+        if (max == 0) return 0;
+        out[0].vaddr = 0;
+        out[0].data = buf;
+        out[0].size = len;
+        return 1;
+    }
+    size_t n = 0;
+    for (uint16_t i = 0; i < eh.e_phnum && n < max; i++) {
+        Elf64_Phdr ph;
+        memcpy(&ph, buf + eh.e_phoff + (uint64_t)i * sizeof(Elf64_Phdr), sizeof(ph));
+        if (ph.p_type != 1 || !(ph.p_flags & 1) || ph.p_filesz == 0) continue;
+        if (!in_buf(ph.p_offset, ph.p_filesz, len)) continue;
+        out[n].vaddr = ph.p_vaddr;
+        out[n].data = buf + ph.p_offset;
+        out[n].size = ph.p_filesz;
+        n++;
+    }
+    return n;
+}
+
+ImageSymbol *load_image_symbols(const uint8_t *buf, size_t len, size_t *count_out) {
+    *count_out = 0;
+    Elf64_Ehdr eh;
+    if (!elf_header(buf, len, &eh) || eh.e_shentsize != sizeof(Elf64_Shdr)) return NULL;
+    if (!in_buf(eh.e_shoff, (uint64_t)eh.e_shnum * sizeof(Elf64_Shdr), len)) return NULL;
+
+    for (uint16_t i = 0; i < eh.e_shnum; i++) {
+        Elf64_Shdr sh, strsh;
+        memcpy(&sh, buf + eh.e_shoff + (uint64_t)i * sizeof(Elf64_Shdr), sizeof(sh));
+        if (sh.sh_type != 2 || sh.sh_entsize != sizeof(Elf64_Sym) || sh.sh_link >= eh.e_shnum) continue;
+        memcpy(&strsh, buf + eh.e_shoff + (uint64_t)sh.sh_link * sizeof(Elf64_Shdr), sizeof(strsh));
+        if (!in_buf(sh.sh_offset, sh.sh_size, len) || !in_buf(strsh.sh_offset, strsh.sh_size, len)) return NULL;
+        // Names must be NUL-terminated inside the string table.
+        const char *strtab = (const char *)buf + strsh.sh_offset;
+        if (strsh.sh_size == 0 || strtab[strsh.sh_size - 1] != '\0') return NULL;
+
+        size_t nsym = (size_t)(sh.sh_size / sizeof(Elf64_Sym));
+        ImageSymbol *syms = (ImageSymbol *)calloc(nsym ? nsym : 1, sizeof(*syms));
+        if (!syms) return NULL;
+        size_t n = 0;
+        for (size_t k = 0; k < nsym; k++) {
+            Elf64_Sym st;
+            memcpy(&st, buf + sh.sh_offset + k * sizeof(Elf64_Sym), sizeof(st));
+            if (st.st_name == 0 || st.st_name >= strsh.sh_size || st.st_shndx == 0) continue;
+            syms[n].addr = st.st_value;
+            syms[n].name = strtab + st.st_name;
+            syms[n].func = (st.st_info & 0xF) == 2;
+            n++;
+        }
+        *count_out = n;
+        return syms;
+    }
+    return NULL;
+}
+
+bool load_raw_image(Mem *m, const uint8_t *buf, size_t len) {
+    if (len > m->size) return false;
+    return mem_write(m, 0, buf, len);
+}
+
+uint8_t *load_file(const char *path, size_t *len_out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0) { fclose(f); return NULL; }
+    uint8_t *buf = (uint8_t *)malloc(size ? (size_t)size : 1);
+    if (!buf) { fclose(f); return NULL; }
+    size_t n = fread(buf, 1, (size_t)size, f);
+    fclose(f);
+    if (n != (size_t)size) { free(buf); return NULL; }
+    *len_out = n;
+    return buf;
+}
@@ -0,0 +1,41 @@
+#ifndef MINA_LOADER_H
+#define MINA_LOADER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mem.h"
+
+// Program images for mina-sim and libminasim. ELF64 little-endian PT_LOAD
+// segments are copied into RAM at p_vaddr and their BSS tail zeroed; any
+// other image is a raw binary loaded at address 0. Images are in-memory
+// buffers, so embedders never need a temporary file.
+
+bool load_elf_image(Mem *m, const uint8_t *buf, size_t len, uint64_t *entry_out);
+bool load_raw_image(Mem *m, const uint8_t *buf, size_t len);
+
+// Executable bytes of an image as the program sees them: the PF_X PT_LOAD
+// segments of an ELF (file bytes only), or the whole buffer at address 0 for
+// a raw binary. Fills up to max entries pointing into buf; returns the count.
+typedef struct {
+    uint64_t vaddr;
+    const uint8_t *data;
+    uint64_t size;
+} ImageSegment;
+
+size_t load_image_code(const uint8_t *buf, size_t len, ImageSegment *out, size_t max);
+
+// Defined symbols from the ELF .symtab, names pointing into buf. Returns a
+// malloc'd array (NULL with *count_out 0 when there is no symbol table).
+typedef struct {
+    uint64_t addr;
+    const char *name;
+    bool func; // STT_FUNC
+} ImageSymbol;
+
+ImageSymbol *load_image_symbols(const uint8_t *buf, size_t len, size_t *count_out);
+
+// Whole file into a malloc'd buffer (NULL on error); the caller frees it.
+uint8_t *load_file(const char *path, size_t *len_out);
+
+#endif
@@ -1,37 +1,21 @@
+#include "blk.h"
+#include "cov.h"
 #include "cpu.h"
+#include "forkserver.h"
+#include "hostfs.h"
+#include "loader.h"
 #include "mem.h"
+#include "progress.h"
+#include "replay.h"
+#include "sample.h"
+#include "stats.h"
+#include "watch.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
-typedef struct {
-    unsigned char e_ident[16];
-    uint16_t e_type;
-    uint16_t e_machine;
-    uint32_t e_version;
-    uint64_t e_entry;
-    uint64_t e_phoff;
-    uint64_t e_shoff;
-    uint32_t e_flags;
-    uint16_t e_ehsize;
-    uint16_t e_phentsize;
-    uint16_t e_phnum;
-    uint16_t e_shentsize;
-    uint16_t e_shnum;
-    uint16_t e_shstrndx;
-} Elf64_Ehdr;
-
-typedef struct {
-    uint32_t p_type;
-    uint32_t p_flags;
-    uint64_t p_offset;
-    uint64_t p_vaddr;
-    uint64_t p_paddr;
-    uint64_t p_filesz;
-    uint64_t p_memsz;
-    uint64_t p_align;
-} Elf64_Phdr;
+#define RUN_SLICE (1u << 16)
 
 static void usage(const char *argv0) {
     printf("Usage: %s [options] program.bin\n", argv0);
@@ -41,55 +25,24 @@ static void usage(const char *argv0) {
     printf("  -s N      max steps (default 1000000)\n");
     printf("  -m N      memory size bytes (default 67108864)\n");
     printf("  -e HEX    entry PC (hex) (default 0)\n");
-}
-
-static bool load_binary(Mem *m, const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return false;
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    if (size < 0) { fclose(f); return false; }
-    fseek(f, 0, SEEK_SET);
-    if ((size_t)size > m->size) { fclose(f); return false; }
-    size_t n = fread(m->data, 1, (size_t)size, f);
-    fclose(f);
-    return n == (size_t)size;
-}
-
-static bool load_elf(Mem *m, const char *path, uint64_t *entry_out) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return false;
-    Elf64_Ehdr eh;
-    if (fread(&eh, 1, sizeof(eh), f) != sizeof(eh)) { fclose(f); return false; }
-    if (eh.e_ident[0] != 0x7F || eh.e_ident[1] != 'E' || eh.e_ident[2] != 'L' || eh.e_ident[3] != 'F') { fclose(f); return false; }
-    if (eh.e_ident[4] != 2 || eh.e_ident[5] != 1) { fclose(f); return false; }
-    if (eh.e_phentsize != sizeof(Elf64_Phdr)) { fclose(f); return false; }
-
-    for (uint16_t i = 0; i < eh.e_phnum; i++) {
-        if (fseek(f, (long)(eh.e_phoff + (uint64_t)i * sizeof(Elf64_Phdr)), SEEK_SET) != 0) { fclose(f); return false; }
-        Elf64_Phdr ph;
-        if (fread(&ph, 1, sizeof(ph), f) != sizeof(ph)) { fclose(f); return false; }
-        if (ph.p_type != 1) continue;
-        if (ph.p_vaddr + ph.p_memsz > m->size) { fclose(f); return false; }
-        if (ph.p_filesz > 0) {
-            uint8_t *buf = (uint8_t *)malloc((size_t)ph.p_filesz);
-            if (!buf) { fclose(f); return false; }
-            if (fseek(f, (long)ph.p_offset, SEEK_SET) != 0) { free(buf); fclose(f); return false; }
-            if (fread(buf, 1, (size_t)ph.p_filesz, f) != ph.p_filesz) { free(buf); fclose(f); return false; }
-            if (!mem_write(m, ph.p_vaddr, buf, (size_t)ph.p_filesz)) { free(buf); fclose(f); return false; }
-            free(buf);
-        }
-        if (ph.p_memsz > ph.p_filesz) {
-            uint64_t zero_start = ph.p_vaddr + ph.p_filesz;
-            uint64_t zero_len = ph.p_memsz - ph.p_filesz;
-            if (zero_start + zero_len > m->size) { fclose(f); return false; }
-            memset(&m->data[zero_start], 0, (size_t)zero_len);
-        }
-    }
-
-    *entry_out = eh.e_entry;
-    fclose(f);
-    return true;
+    printf("  --fs-root DIR  allow file syscalls below DIR (default: none)\n");
+    printf("  --blk IMAGE    attach IMAGE as the MMIO block device\n");
+    printf("  --rom ADDR:LEN make a page-aligned RAM range read-only after loading (hex)\n");
+    printf("  --forkserver   serve a fuzzer over fds 198/199 (AFL protocol)\n");
+    printf("  --fork-pc HEX  fork point for --forkserver (default: entry)\n");
+    printf("  --coverage FILE  write block/branch coverage to FILE and an lcov report to FILE.info\n");
+    printf("  --watch ADDR[:LEN][:rw][:log]  stop (or log) on access to a RAM range (hex ADDR)\n");
+    printf("  --break PC[:log]               stop (or log) before executing PC (hex)\n");
+    printf("  --sample N:W[:K|:all]  detailed model for the last W of every N instructions, K warming\n");
+    printf("  --bbv FILE     write per-interval basic-block vectors (SimPoint .bb)\n");
+    printf("  --simpoints K  cluster the BBVs and write FILE.simpoints/.weights\n");
+    printf("  --stats        print instruction mix, traps and host MIPS at exit\n");
+    printf("  --stats-json FILE  write the same statistics as JSON\n");
+    printf("  --heartbeat SECONDS  print a progress line every SECONDS (also on SIGUSR1)\n");
+    printf("  --hugepages MODE  back RAM with 2 MiB pages: off, auto (default, RAM >= 256 MiB), thp, hugetlb\n");
+    printf("  --record FILE  log console input with the instruction count that saw it\n");
+    printf("  --replay FILE  feed console input from a --record log instead of stdin\n");
+    printf("  --memcall-cycles N  cycles charged per 8 bytes by the memcpy/memset/memcmp/strlen syscalls (default 1)\n");
 }
 
 int main(int argc, char **argv) {
@@ -99,6 +52,21 @@ int main(int argc, char **argv) {
     bool trace = false;
     bool dump_regs = false;
     bool entry_override = false;
+    const char *blk_path = NULL;
+    uint64_t rom_base = 0, rom_len = 0;
+    bool forkserver = false;
+    bool has_fork_pc = false;
+    uint64_t fork_pc = 0;
+    const char *cov_path = NULL;
+    Watch watch = {0};
+    SampleConfig sample = {0};
+    bool stats = false;
+    const char *stats_json = NULL;
+    double heartbeat = 0;
+    MemHugeMode huge = MEM_HUGE_AUTO;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    uint32_t memcall_cycles = CPU_MEMCALL_CYCLES;
 
     int i = 1;
     while (i < argc && argv[i][0] == '-') {
@@ -116,6 +84,85 @@ int main(int argc, char **argv) {
             if (i + 1 >= argc) { usage(argv[0]); return 1; }
             entry = strtoull(argv[++i], NULL, 16);
             entry_override = true;
+        } else if (strcmp(argv[i], "--fs-root") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            if (!hostfs_set_root(argv[++i])) {
+                fprintf(stderr, "invalid --fs-root directory: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--blk") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            blk_path = argv[++i];
+        } else if (strcmp(argv[i], "--rom") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            char *end = NULL;
+            rom_base = strtoull(argv[++i], &end, 16);
+            if (*end == ':') rom_len = strtoull(end + 1, &end, 16);
+            if (*end || rom_len == 0) {
+                fprintf(stderr, "invalid --rom: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--forkserver") == 0) {
+            forkserver = true;
+        } else if (strcmp(argv[i], "--fork-pc") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            fork_pc = strtoull(argv[++i], NULL, 16);
+            has_fork_pc = true;
+        } else if (strcmp(argv[i], "--coverage") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            cov_path = argv[++i];
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            if (!watch_add(&watch, argv[++i])) {
+                fprintf(stderr, "invalid --watch: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            if (!sample_parse(&sample, argv[++i])) {
+                fprintf(stderr, "invalid --sample: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bbv") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            sample.bbv_path = argv[++i];
+        } else if (strcmp(argv[i], "--simpoints") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            sample.simpoints = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--stats-json") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            stats_json = argv[++i];
+        } else if (strcmp(argv[i], "--heartbeat") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            heartbeat = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--hugepages") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            const char *mode = argv[++i];
+            if (strcmp(mode, "off") == 0) huge = MEM_HUGE_OFF;
+            else if (strcmp(mode, "auto") == 0) huge = MEM_HUGE_AUTO;
+            else if (strcmp(mode, "thp") == 0) huge = MEM_HUGE_THP;
+            else if (strcmp(mode, "hugetlb") == 0) huge = MEM_HUGE_TLB;
+            else {
+                fprintf(stderr, "invalid --hugepages: %s\n", mode);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--memcall-cycles") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            memcall_cycles = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--break") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            if (!watch_add_break(&watch, argv[++i])) {
+                fprintf(stderr, "invalid --break: %s\n", argv[i]);
+                return 1;
+            }
         } else {
             usage(argv[0]);
             return 1;
@@ -124,41 +171,197 @@ int main(int argc, char **argv) {
     }
 
     if (i >= argc) { usage(argv[0]); return 1; }
+    if (forkserver && blk_path) {
+        fprintf(stderr, "--forkserver cannot be combined with --blk\n");
+        return 1;
+    }
+    if (forkserver && cov_path) {
+        fprintf(stderr, "--forkserver cannot be combined with --coverage\n");
+        return 1;
+    }
+    if (record_path && replay_path) {
+        fprintf(stderr, "--record cannot be combined with --replay\n");
+        return 1;
+    }
+    if (forkserver && (record_path || replay_path)) {
+        fprintf(stderr, "--forkserver cannot be combined with --record/--replay\n");
+        return 1;
+    }
     const char *bin_path = argv[i];
 
+    // Fork-server children copy-on-write RAM; with 2 MiB pages every first
+    // store would copy a whole huge page.
+    if (forkserver && huge == MEM_HUGE_AUTO) huge = MEM_HUGE_OFF;
+
     Mem mem;
-    if (!mem_init(&mem, mem_size)) {
+    if (!mem_init_huge(&mem, mem_size, huge)) {
         fprintf(stderr, "failed to allocate memory\n");
         return 1;
     }
 
+    if (blk_path && !blk_attach(blk_path, &mem)) {
+        fprintf(stderr, "failed to open block image: %s\n", blk_path);
+        mem_free(&mem);
+        return 1;
+    }
+
+    size_t image_len = 0;
+    uint8_t *image = load_file(bin_path, &image_len);
     uint64_t elf_entry = 0;
-    bool loaded = load_elf(&mem, bin_path, &elf_entry);
+    bool loaded = image && load_elf_image(&mem, image, image_len, &elf_entry);
     if (!loaded) {
-        if (!load_binary(&mem, bin_path)) {
+        if (!image || !load_raw_image(&mem, image, image_len)) {
             fprintf(stderr, "failed to load binary: %s\n", bin_path);
+            free(image);
+            blk_detach();
             mem_free(&mem);
             return 1;
         }
     } else if (!entry_override) {
         entry = elf_entry;
     }
+    // The coverage report reads code and symbols from the image.
+    if (!cov_path) {
+        free(image);
+        image = NULL;
+    }
 
     Cpu cpu;
     cpu_init(&cpu, entry);
+    if (!cpu_map_devices(&cpu, &mem)) {
+        fprintf(stderr, "failed to map devices\n");
+        free(image);
+        cpu_free(&cpu);
+        blk_detach();
+        mem_free(&mem);
+        return 1;
+    }
+    if (rom_len && !mem_map_rom(&mem, "rom", rom_base, rom_len)) {
+        fprintf(stderr, "--rom range must be page aligned and inside RAM\n");
+        free(image);
+        cpu_free(&cpu);
+        blk_detach();
+        mem_free(&mem);
+        return 1;
+    }
     cpu.trace = trace;
     cpu.dump_regs = dump_regs;
+    cpu.memcall_cycles = memcall_cycles;
     cpu.regs[30] = (uint64_t)mem.size & ~0xFULL;
 
+    if (watch.count || watch.break_count) {
+        if (!watch_arm(&watch, &mem)) {
+            fprintf(stderr, "--watch range outside RAM\n");
+            free(image);
+            cpu_free(&cpu);
+            blk_detach();
+            mem_free(&mem);
+            return 1;
+        }
+        cpu.watch = &watch;
+    }
+
+    if (cov_path) {
+        cpu.coverage = cov_create(mem.size);
+        if (!cpu.coverage) {
+            fprintf(stderr, "failed to allocate coverage maps\n");
+            free(image);
+            cpu_free(&cpu);
+            blk_detach();
+            mem_free(&mem);
+            return 1;
+        }
+        cov_block(cpu.coverage, cpu.pc);
+    }
+
+    if (forkserver) {
+        int rc = forkserver_run(&cpu, &mem, max_steps, has_fork_pc, fork_pc);
+        cpu_free(&cpu);
+        mem_free(&mem);
+        return rc;
+    }
+
+    CpuStats cpu_stats = {0};
+    if (stats || stats_json) cpu.stats = &cpu_stats;
+
+    Replay replay;
+    if (record_path || replay_path) {
+        const char *log_path = record_path ? record_path : replay_path;
+        if (!replay_open(&replay, log_path, record_path ? REPLAY_RECORD : REPLAY_PLAY)) {
+            fprintf(stderr, "failed to open %s log: %s\n", record_path ? "record" : "replay", log_path);
+            free(image);
+            cpu_free(&cpu);
+            blk_detach();
+            mem_free(&mem);
+            return 1;
+        }
+        cpu.replay = &replay;
+    }
+
     Trap trap = TRAP_NONE;
     uint64_t iterations = 0;
-    while (iterations < max_steps) {
-        trap = cpu_step(&cpu, &mem);
-        if (trap != TRAP_NONE) break;
-        iterations++;
+    double start_time = stats_now();
+    if (!progress_init(heartbeat)) fprintf(stderr, "failed to install progress reporting\n");
+    if (sample.interval || sample.bbv_path) {
+        trap = sample_run(&cpu, &mem, max_steps, &sample, &iterations);
+    } else {
+        // Slices keep --heartbeat/SIGUSR1 reports prompt without a flag
+        // test per instruction.
+        while (iterations < max_steps) {
+            uint64_t slice = max_steps - iterations, done = 0;
+            if (slice > RUN_SLICE) slice = RUN_SLICE;
+            trap = cpu_run(&cpu, &mem, slice, &done);
+            iterations += done;
+            if (trap != TRAP_NONE) break;
+            if (progress_pending) progress_report(&cpu);
+        }
+    }
+    progress_stop();
+    double run_time = stats_now() - start_time;
+    cpu_free(&cpu);
+    blk_detach();
+
+    if (cpu.replay && !replay_close(cpu.replay) && record_path) {
+        fprintf(stderr, "failed to write record log: %s\n", record_path);
+    }
+
+    if (cpu.coverage) {
+        char info_path[4096];
+        snprintf(info_path, sizeof(info_path), "%s.info", cov_path);
+        if (!cov_save(cpu.coverage, cov_path) || !cov_report(cpu.coverage, info_path, bin_path, image, image_len)) {
+            fprintf(stderr, "failed to write coverage: %s\n", cov_path);
+        }
+        cov_destroy(cpu.coverage);
+        free(image);
+    }
+
+    if (stats) stats_print(stderr, &cpu_stats, cpu.steps, run_time);
+    if (stats_json && !stats_write_json(stats_json, &cpu_stats, cpu.steps, run_time)) {
+        fprintf(stderr, "failed to write stats: %s\n", stats_json);
+    }
+
+    if (mem.backing != MEM_BACKING_HEAP) {
+        fprintf(stderr, "ram: %llu MiB %s, %llu MiB in huge pages",
+                (unsigned long long)(mem.size >> 20), mem_backing_name(mem.backing),
+                (unsigned long long)(mem_huge_bytes(&mem) >> 20));
+        if (mem.numa_node >= 0) fprintf(stderr, ", numa node %d", mem.numa_node);
+        fputc('\n', stderr);
+    }
+
+    if (cpu.mmu.tlb_misses) {
+        fprintf(stderr, "tlb: %llu hits, %llu misses\n",
+                (unsigned long long)cpu.mmu.tlb_hits,
+                (unsigned long long)cpu.mmu.tlb_misses);
     }
 
     if (trap != TRAP_NONE) {
+        if (trap == TRAP_WATCH) {
+            fprintf(stderr, "stopped by --watch/--break after %llu steps at pc=0x%llx\n",
+                    (unsigned long long)cpu.steps,
+                    (unsigned long long)cpu.pc);
+            mem_free(&mem);
+            return 0;
+        }
         if (trap == TRAP_EBREAK) {
             fprintf(stderr, "halted on ebreak after %llu steps at pc=0x%llx\n",
                     (unsigned long long)cpu.steps,
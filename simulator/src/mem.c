@@ -1,28 +1,205 @@
+#define _GNU_SOURCE
 #include "mem.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
-bool mem_init(Mem *m, size_t size) {
-    m->data = (uint8_t *)calloc(1, size);
-    if (!m->data) return false;
+// MPOL_PREFERRED from <numaif.h>, which needs libnuma's headers.
+#define MEM_MPOL_PREFERRED 1
+
+static bool map_grow(Mem *m, uint64_t pages) {
+    if (pages <= m->map_pages) return true;
+    if (pages > SIZE_MAX) return false;
+    uint8_t *map = (uint8_t *)realloc(m->page_map, (size_t)pages);
+    if (!map) return false;
+    memset(map + m->map_pages, MEM_REGION_NONE, (size_t)(pages - m->map_pages));
+    m->page_map = map;
+    m->map_pages = pages;
+    return true;
+}
+
+static bool map_add(Mem *m, Region r) {
+    if (m->region_count >= MEM_MAX_REGIONS || r.size == 0) return false;
+    if (r.base + r.size < r.base) return false;
+    uint64_t first = r.base >> MEM_PAGE_SHIFT;
+    uint64_t end = (r.base + r.size + (1ull << MEM_PAGE_SHIFT) - 1) >> MEM_PAGE_SHIFT;
+    if (!map_grow(m, end)) return false;
+    uint8_t idx = (uint8_t)m->region_count;
+    m->regions[m->region_count++] = r;
+    memset(m->page_map + first, idx, (size_t)(end - first));
+    return true;
+}
+
+static bool mem_setup(Mem *m, size_t size) {
     m->ctag_size = (size + 15) / 16;
     m->ctag = (uint8_t *)calloc(1, m->ctag_size);
-    if (!m->ctag) {
-        free(m->data);
-        m->data = NULL;
+    m->size = size;
+    Region ram = { .kind = REGION_RAM, .name = "ram", .base = 0, .size = size };
+    if (!m->ctag || !map_add(m, ram)) {
+        mem_free(m);
         return false;
     }
-    m->size = size;
     return true;
 }
 
+bool mem_init(Mem *m, size_t size) {
+    memset(m, 0, sizeof(*m));
+    m->numa_node = -1;
+    m->data = (uint8_t *)calloc(1, size);
+    if (!m->data) return false;
+    return mem_setup(m, size);
+}
+
+static uint8_t *map_hugetlb(size_t len) {
+#ifdef MAP_HUGETLB
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    return p == MAP_FAILED ? NULL : (uint8_t *)p;
+#else
+    (void)len;
+    return NULL;
+#endif
+}
+
+// Anonymous mapping aligned to MEM_HUGE_PAGE, so every 2 MiB of it can be
+// a transparent huge page.
+static uint8_t *map_aligned(size_t len) {
+    size_t span = len + MEM_HUGE_PAGE;
+    void *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    uint8_t *p = (uint8_t *)raw;
+    uint8_t *q = (uint8_t *)(((uintptr_t)p + MEM_HUGE_PAGE - 1) & ~(uintptr_t)(MEM_HUGE_PAGE - 1));
+    if (q > p) munmap(p, (size_t)(q - p));
+    if (p + span > q + len) munmap(q + len, (size_t)(p + span - (q + len)));
+    return q;
+}
+
+// Prefer the node of the CPU the caller is running on. Must happen before
+// the pages are first touched; single-node hosts skip the syscalls.
+static int numa_place(void *addr, size_t len) {
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+    if (access("/sys/devices/system/node/node1", F_OK) != 0) return -1;
+    unsigned cpu = 0, node = 0;
+    unsigned long mask;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= sizeof(mask) * 8) return -1;
+    mask = 1ul << node;
+    if (syscall(SYS_mbind, addr, len, MEM_MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0) != 0) return -1;
+    return (int)node;
+#else
+    (void)addr;
+    (void)len;
+    return -1;
+#endif
+}
+
+bool mem_init_huge(Mem *m, size_t size, MemHugeMode mode) {
+    if (mode == MEM_HUGE_AUTO && size < MEM_HUGE_AUTO_MIN) mode = MEM_HUGE_OFF;
+    if (mode == MEM_HUGE_OFF || size == 0) return mem_init(m, size);
+    memset(m, 0, sizeof(*m));
+    m->numa_node = -1;
+    size_t len = (size + MEM_HUGE_PAGE - 1) & ~(size_t)(MEM_HUGE_PAGE - 1);
+    if (mode != MEM_HUGE_THP) {
+        m->data = map_hugetlb(len);
+        if (m->data) m->backing = MEM_BACKING_HUGETLB;
+    }
+    if (!m->data) {
+        m->data = map_aligned(len);
+        if (!m->data) return mem_init(m, size);
+        m->backing = MEM_BACKING_MMAP;
+#ifdef MADV_HUGEPAGE
+        if (madvise(m->data, len, MADV_HUGEPAGE) == 0) m->backing = MEM_BACKING_THP;
+#endif
+    }
+    m->map_len = len;
+    m->numa_node = numa_place(m->data, len);
+    return mem_setup(m, size);
+}
+
+uint64_t mem_huge_bytes(const Mem *m) {
+    if (m->backing == MEM_BACKING_HUGETLB) return m->map_len;
+    if (m->backing != MEM_BACKING_THP) return 0;
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+    uintptr_t lo = (uintptr_t)m->data;
+    uintptr_t hi = lo + m->map_len;
+    char line[512];
+    bool in = false;
+    unsigned long long kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long a, b, v;
+        if (sscanf(line, "%llx-%llx ", &a, &b) == 2) {
+            in = a < hi && b > lo;
+        } else if (in && sscanf(line, "AnonHugePages: %llu kB", &v) == 1) {
+            kb += v;
+        }
+    }
+    fclose(f);
+    return (uint64_t)kb * 1024;
+}
+
+const char *mem_backing_name(MemBacking b) {
+    switch (b) {
+        case MEM_BACKING_MMAP: return "4k";
+        case MEM_BACKING_THP: return "thp";
+        case MEM_BACKING_HUGETLB: return "hugetlb";
+        default: return "heap";
+    }
+}
+
 void mem_free(Mem *m) {
-    free(m->data);
+    if (m->backing == MEM_BACKING_HEAP) free(m->data);
+    else if (m->data) munmap(m->data, m->map_len);
     free(m->ctag);
+    free(m->page_map);
+    free(m->snap_data);
+    free(m->snap_ctag);
+    free(m->dirty);
+    m->snap_data = NULL;
+    m->snap_ctag = NULL;
+    m->dirty = NULL;
+    m->dirty_words = 0;
     m->data = NULL;
     m->ctag = NULL;
+    m->page_map = NULL;
     m->size = 0;
     m->ctag_size = 0;
+    m->map_pages = 0;
+    m->region_count = 0;
+    m->has_rom = false;
+    m->backing = MEM_BACKING_HEAP;
+    m->map_len = 0;
+    m->numa_node = -1;
+}
+
+bool mem_map_mmio(Mem *m, const char *name, uint64_t base, uint64_t size,
+                  MmioLoadFn load, MmioStoreFn store, void *ctx) {
+    Region r = { .kind = REGION_MMIO, .name = name, .base = base, .size = size,
+                 .load = load, .store = store, .ctx = ctx };
+    return map_add(m, r);
+}
+
+// ROM is a read-only window onto RAM contents (e.g. a loaded boot image).
+bool mem_map_rom(Mem *m, const char *name, uint64_t base, uint64_t size) {
+    uint64_t mask = (1ull << MEM_PAGE_SHIFT) - 1;
+    if ((base | size) & mask) return false;
+    if (base + size < base || base + size > m->size) return false;
+    Region r = { .kind = REGION_ROM, .name = name, .base = base, .size = size };
+    if (!map_add(m, r)) return false;
+    m->has_rom = true;
+    return true;
+}
+
+const Region *mem_region(const Mem *m, uint64_t addr) {
+    uint64_t pg = addr >> MEM_PAGE_SHIFT;
+    if (pg >= m->map_pages) return NULL;
+    uint8_t idx = m->page_map[pg];
+    if (idx == MEM_REGION_NONE) return NULL;
+    if (idx == MEM_REGION_WATCHED) idx = MEM_REGION_RAM;
+    const Region *r = &m->regions[idx];
+    if (addr - r->base >= r->size) return NULL;
+    return r;
 }
 
 static bool in_bounds(Mem *m, uint64_t addr, size_t len) {
@@ -30,6 +207,83 @@ static bool in_bounds(Mem *m, uint64_t addr, size_t len) {
     return addr + len <= m->size;
 }
 
+static bool rom_overlap(const Mem *m, uint64_t addr, size_t len) {
+    if (len == 0) return false;
+    uint64_t last = (addr + len - 1) >> MEM_PAGE_SHIFT;
+    for (uint64_t pg = addr >> MEM_PAGE_SHIFT; pg <= last; pg++) {
+        uint8_t idx = m->page_map[pg];
+        if (idx < m->region_count && m->regions[idx].kind == REGION_ROM) return true;
+    }
+    return false;
+}
+
+// Every RAM write path goes through here, so ROM costs nothing until one
+// is mapped.
+static bool writable(const Mem *m, uint64_t addr, size_t len) {
+    if (addr + len < addr || addr + len > m->size) return false;
+    return !m->has_rom || !rom_overlap(m, addr, len);
+}
+
+bool mem_writable(const Mem *m, uint64_t addr, size_t len) {
+    return writable(m, addr, len);
+}
+
+uint8_t *mem_ptr(Mem *m, uint64_t addr, size_t len) {
+    if (!writable(m, addr, len)) return NULL;
+    mem_mark_dirty(m, addr, len);
+    return &m->data[addr];
+}
+
+const uint8_t *mem_cptr(const Mem *m, uint64_t addr, size_t len) {
+    if (addr + len < addr || addr + len > m->size) return NULL;
+    return &m->data[addr];
+}
+
+bool mem_snapshot(Mem *m) {
+    uint64_t pages = ((uint64_t)m->size + (1ull << MEM_PAGE_SHIFT) - 1) >> MEM_PAGE_SHIFT;
+    size_t words = (size_t)((pages + 63) / 64);
+    if (!m->dirty) {
+        m->snap_data = (uint8_t *)malloc(m->size);
+        m->snap_ctag = (uint8_t *)malloc(m->ctag_size);
+        m->dirty = (uint64_t *)calloc(words, sizeof(uint64_t));
+        if (!m->snap_data || !m->snap_ctag || !m->dirty) {
+            free(m->snap_data);
+            free(m->snap_ctag);
+            free(m->dirty);
+            m->snap_data = NULL;
+            m->snap_ctag = NULL;
+            m->dirty = NULL;
+            return false;
+        }
+        m->dirty_words = words;
+    }
+    memcpy(m->snap_data, m->data, m->size);
+    memcpy(m->snap_ctag, m->ctag, m->ctag_size);
+    memset(m->dirty, 0, words * sizeof(uint64_t));
+    return true;
+}
+
+void mem_reset_to_snapshot(Mem *m) {
+    if (!m->dirty) return;
+    const uint64_t page = 1ull << MEM_PAGE_SHIFT;
+    const uint64_t tags = page / 16;
+    for (size_t w = 0; w < m->dirty_words; w++) {
+        uint64_t bits = m->dirty[w];
+        if (!bits) continue;
+        m->dirty[w] = 0;
+        while (bits) {
+            uint64_t pg = (uint64_t)w * 64 + (uint64_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            uint64_t off = pg * page;
+            uint64_t len = (off + page <= m->size) ? page : m->size - off;
+            memcpy(&m->data[off], &m->snap_data[off], (size_t)len);
+            uint64_t t = pg * tags;
+            uint64_t tn = (t + tags <= m->ctag_size) ? tags : m->ctag_size - t;
+            memcpy(&m->ctag[t], &m->snap_ctag[t], (size_t)tn);
+        }
+    }
+}
+
 bool mem_read(Mem *m, uint64_t addr, void *out, size_t len) {
     if (!in_bounds(m, addr, len)) return false;
     memcpy(out, &m->data[addr], len);
@@ -37,7 +291,8 @@ bool mem_read(Mem *m, uint64_t addr, void *out, size_t len) {
 }
 
 bool mem_write(Mem *m, uint64_t addr, const void *in, size_t len) {
-    if (!in_bounds(m, addr, len)) return false;
+    if (!writable(m, addr, len)) return false;
+    mem_mark_dirty(m, addr, len);
     memcpy(&m->data[addr], in, len);
     return true;
 }
@@ -86,7 +341,8 @@ bool mem_read_cap(Mem *m, uint64_t addr, void *out16, bool *tag) {
 
 bool mem_write_cap(Mem *m, uint64_t addr, const void *in16, bool tag) {
     if (addr & 0xF) return false;
-    if (!in_bounds(m, addr, 16)) return false;
+    if (!writable(m, addr, 16)) return false;
+    mem_mark_dirty(m, addr, 16);
     memcpy(&m->data[addr], in16, 16);
     uint64_t idx = addr / 16;
     if (idx >= m->ctag_size) return false;
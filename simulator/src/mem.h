@@ -5,16 +5,139 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Physical address map. Every 4 KiB page maps to one region: RAM (region
+// 0, backed by `data`), ROM (RAM-backed, stores fault) or an MMIO device
+// with load/store callbacks. Lookup is one byte per page, and RAM pages
+// are recognised with a single compare so ordinary accesses pay no
+// per-device checks. Devices may cover pages inside the RAM range. RAM
+// pages under a watchpoint are tagged MEM_REGION_WATCHED instead, which
+// keeps them off that fast path without touching it.
+
+#define MEM_PAGE_SHIFT 12
+#define MEM_MAX_REGIONS 16
+#define MEM_REGION_RAM 0
+#define MEM_REGION_WATCHED 0xFE
+#define MEM_REGION_NONE 0xFF
+
+typedef bool (*MmioLoadFn)(void *ctx, uint64_t addr, size_t size, uint64_t *out);
+typedef bool (*MmioStoreFn)(void *ctx, uint64_t addr, size_t size, uint64_t val);
+
+typedef enum {
+    REGION_RAM,
+    REGION_ROM,
+    REGION_MMIO
+} RegionKind;
+
+typedef struct {
+    RegionKind kind;
+    const char *name;
+    uint64_t base;
+    uint64_t size;
+    MmioLoadFn load;
+    MmioStoreFn store;
+    void *ctx;
+} Region;
+
+// Host backing for guest RAM. Large guests stream through far more memory
+// than the host TLB covers with 4 KiB pages, so mem_init_huge can map RAM
+// with 2 MiB pages: a hugetlbfs mapping from the reserved pool, or an
+// anonymous mapping aligned to 2 MiB and advised MADV_HUGEPAGE for
+// transparent huge pages. Either way the pages are preferably placed on
+// the NUMA node of the calling (simulating) thread.
+typedef enum {
+    MEM_HUGE_OFF,     // heap allocation, as mem_init
+    MEM_HUGE_AUTO,    // TLB, else THP, for RAM of MEM_HUGE_AUTO_MIN or more
+    MEM_HUGE_THP,
+    MEM_HUGE_TLB      // falls back to THP when the pool is short
+} MemHugeMode;
+
+typedef enum {
+    MEM_BACKING_HEAP,
+    MEM_BACKING_MMAP,    // 4 KiB pages (THP advice refused)
+    MEM_BACKING_THP,
+    MEM_BACKING_HUGETLB
+} MemBacking;
+
+#define MEM_HUGE_PAGE (2ull << 20)
+#define MEM_HUGE_AUTO_MIN (256ull << 20)
+
 typedef struct {
     uint8_t *data;
     uint8_t *ctag;
     size_t size;
     size_t ctag_size;
+    Region regions[MEM_MAX_REGIONS];
+    size_t region_count;
+    bool has_rom;      // RAM writes must check for ROM pages
+    uint8_t *page_map;
+    uint64_t map_pages;
+
+    // Snapshot of RAM and tags, and one bit per RAM page written since it
+    // was taken (NULL until mem_snapshot).
+    uint8_t *snap_data;
+    uint8_t *snap_ctag;
+    uint64_t *dirty;
+    size_t dirty_words;
+
+    MemBacking backing;
+    size_t map_len;    // length of the RAM mapping (not heap-backed)
+    int numa_node;     // node RAM was placed on, -1 if not placed
 } Mem;
 
 bool mem_init(Mem *m, size_t size);
+bool mem_init_huge(Mem *m, size_t size, MemHugeMode mode);
 void mem_free(Mem *m);
+// Bytes of RAM currently backed by huge pages (for THP, what the kernel
+// has actually faulted in as 2 MiB pages so far).
+uint64_t mem_huge_bytes(const Mem *m);
+const char *mem_backing_name(MemBacking b);
+
+bool mem_map_mmio(Mem *m, const char *name, uint64_t base, uint64_t size,
+                  MmioLoadFn load, MmioStoreFn store, void *ctx);
+// base and size must be page aligned and inside RAM.
+bool mem_map_rom(Mem *m, const char *name, uint64_t base, uint64_t size);
+
+// Region covering addr, or NULL if nothing is mapped there.
+const Region *mem_region(const Mem *m, uint64_t addr);
+
+static inline bool mem_is_ram(const Mem *m, uint64_t addr) {
+    uint64_t pg = addr >> MEM_PAGE_SHIFT;
+    return pg < m->map_pages && m->page_map[pg] == MEM_REGION_RAM;
+}
+
+static inline bool mem_is_watched(const Mem *m, uint64_t addr) {
+    uint64_t pg = addr >> MEM_PAGE_SHIFT;
+    return pg < m->map_pages && m->page_map[pg] == MEM_REGION_WATCHED;
+}
+
+// Every path that writes RAM marks its pages. Setting a bit is an atomic
+// OR (device workers write RAM too), but only on a page's first write;
+// after that it is a load and a test, and nothing while tracking is off.
+static inline void mem_mark_dirty(Mem *m, uint64_t addr, size_t len) {
+    if (!m->dirty || len == 0) return;
+    uint64_t last = (addr + len - 1) >> MEM_PAGE_SHIFT;
+    for (uint64_t pg = addr >> MEM_PAGE_SHIFT; pg <= last; pg++) {
+        uint64_t *w = &m->dirty[pg >> 6];
+        uint64_t bit = 1ull << (pg & 63);
+        if (!(__atomic_load_n(w, __ATOMIC_RELAXED) & bit)) __atomic_fetch_or(w, bit, __ATOMIC_RELAXED);
+    }
+}
+
+// Copy RAM and capability tags aside and start dirty tracking; a later
+// reset restores only the pages written since. Taking a new snapshot
+// replaces the old one.
+bool mem_snapshot(Mem *m);
+void mem_reset_to_snapshot(Mem *m);
+
+// True if the range is RAM and touches no ROM page.
+bool mem_writable(const Mem *m, uint64_t addr, size_t len);
 
+// Writable host address of a guest range (marked dirty), or NULL if it is
+// out of bounds or overlaps ROM.
+uint8_t *mem_ptr(Mem *m, uint64_t addr, size_t len);
+// Host address of a guest range that will only be read: not marked dirty,
+// and valid over ROM. NULL if it is out of bounds.
+const uint8_t *mem_cptr(const Mem *m, uint64_t addr, size_t len);
 bool mem_read(Mem *m, uint64_t addr, void *out, size_t len);
 bool mem_write(Mem *m, uint64_t addr, const void *in, size_t len);
 
@@ -0,0 +1,228 @@
+#include "minasim.h"
+#include "cpu.h"
+#include "loader.h"
+#include "mem.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MINA_SIM_DEFAULT_MEM (64ull * 1024 * 1024)
+
+struct MinaSim {
+    Cpu cpu;
+    Mem mem;
+    size_t mem_size;
+    bool booted;
+    MinaSimStatus status;
+    Trap trap;
+
+    // Last loaded image, replayed by reset.
+    uint8_t *image;
+    size_t image_len;
+    bool image_elf;
+    uint64_t entry;
+    uint64_t load_entry;
+
+    MinaConsoleWriteFn console_write;
+    MinaConsoleReadFn console_read;
+    void *console_user;
+    MinaSyscallFn syscall;
+    void *syscall_user;
+
+    bool stats_on;
+    CpuStats stats;
+};
+
+static void sim_console_write(void *ctx, int fd, const uint8_t *buf, size_t len) {
+    MinaSim *s = (MinaSim *)ctx;
+    s->console_write(s->console_user, fd, buf, len);
+}
+
+static size_t sim_console_read(void *ctx, uint8_t *buf, size_t len) {
+    MinaSim *s = (MinaSim *)ctx;
+    return s->console_read(s->console_user, buf, len);
+}
+
+static HostSyscallResult sim_syscall(void *ctx, Cpu *c, Mem *m) {
+    MinaSim *s = (MinaSim *)ctx;
+    (void)m;
+    switch (s->syscall(s->syscall_user, s, c->regs[17])) {
+        case MINA_SYSCALL_DONE: return HOST_SYSCALL_DONE;
+        case MINA_SYSCALL_HALT: return HOST_SYSCALL_HALT;
+        default: return HOST_SYSCALL_DEFAULT;
+    }
+}
+
+static void sim_bind_host(MinaSim *s) {
+    CpuHost *h = &s->cpu.host;
+    h->ctx = s;
+    h->console_write = s->console_write ? sim_console_write : NULL;
+    h->console_read = s->console_read ? sim_console_read : NULL;
+    h->syscall = s->syscall ? sim_syscall : NULL;
+    s->cpu.stats = s->stats_on ? &s->stats : NULL;
+}
+
+static void sim_teardown(MinaSim *s) {
+    if (!s->booted) return;
+    cpu_free(&s->cpu);
+    mem_free(&s->mem);
+    s->booted = false;
+}
+
+static void sim_start(MinaSim *s) {
+    memset(&s->stats, 0, sizeof(s->stats));
+    sim_bind_host(s);
+    s->cpu.regs[30] = (uint64_t)s->mem.size & ~0xFULL;
+    s->status = MINA_SIM_BUDGET;
+    s->trap = TRAP_NONE;
+}
+
+// Fresh RAM, hart and devices with the current image loaded, then a
+// snapshot so that reset only has to copy back the pages the guest wrote.
+static bool sim_boot(MinaSim *s) {
+    sim_teardown(s);
+    s->status = MINA_SIM_ERROR;
+    s->trap = TRAP_NONE;
+    if (!mem_init(&s->mem, s->mem_size)) return false;
+    cpu_init(&s->cpu, 0);
+    if (!cpu_map_devices(&s->cpu, &s->mem)) {
+        cpu_free(&s->cpu);
+        mem_free(&s->mem);
+        return false;
+    }
+    s->booted = true;
+    sim_bind_host(s);
+    if (!s->image) return true;
+
+    uint64_t entry = s->entry;
+    bool ok = s->image_elf ? load_elf_image(&s->mem, s->image, s->image_len, &entry)
+                           : load_raw_image(&s->mem, s->image, s->image_len);
+    if (!ok) return false;
+    s->load_entry = entry;
+    s->cpu.pc = entry;
+    mem_snapshot(&s->mem);
+    sim_start(s);
+    return true;
+}
+
+MinaSim *mina_sim_create(size_t mem_size) {
+    MinaSim *s = (MinaSim *)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->mem_size = mem_size ? mem_size : MINA_SIM_DEFAULT_MEM;
+    if (!sim_boot(s)) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void mina_sim_destroy(MinaSim *s) {
+    if (!s) return;
+    sim_teardown(s);
+    free(s->image);
+    free(s);
+}
+
+static bool sim_load(MinaSim *s, const void *image, size_t len, bool elf, uint64_t entry) {
+    uint8_t *copy = (uint8_t *)malloc(len ? len : 1);
+    if (!copy) return false;
+    memcpy(copy, image, len);
+    free(s->image);
+    s->image = copy;
+    s->image_len = len;
+    s->image_elf = elf;
+    s->entry = entry;
+    if (sim_boot(s)) return true;
+    free(s->image);
+    s->image = NULL;
+    sim_boot(s);
+    return false;
+}
+
+bool mina_sim_load_elf(MinaSim *s, const void *image, size_t len) {
+    return sim_load(s, image, len, true, 0);
+}
+
+bool mina_sim_load_raw(MinaSim *s, const void *image, size_t len, uint64_t entry) {
+    return sim_load(s, image, len, false, entry);
+}
+
+void mina_sim_set_console(MinaSim *s, MinaConsoleWriteFn write, MinaConsoleReadFn read, void *user) {
+    s->console_write = write;
+    s->console_read = read;
+    s->console_user = user;
+    sim_bind_host(s);
+}
+
+void mina_sim_set_syscall(MinaSim *s, MinaSyscallFn fn, void *user) {
+    s->syscall = fn;
+    s->syscall_user = user;
+    sim_bind_host(s);
+}
+
+void mina_sim_set_stats(MinaSim *s, bool on) {
+    s->stats_on = on;
+    sim_bind_host(s);
+}
+
+bool mina_sim_write_stats(const MinaSim *s, FILE *f, bool json, double seconds) {
+    if (!json) {
+        stats_print(f, &s->stats, s->cpu.steps, seconds);
+        return !ferror(f);
+    }
+    return stats_json(f, &s->stats, s->cpu.steps, seconds);
+}
+
+MinaSimStatus mina_sim_run(MinaSim *s, uint64_t budget) {
+    if (s->status != MINA_SIM_BUDGET) return s->status;
+    uint64_t done = 0;
+    Trap t = cpu_run(&s->cpu, &s->mem, budget, &done);
+    if (t != TRAP_NONE) {
+        s->trap = t;
+        s->status = (t == TRAP_EBREAK) ? MINA_SIM_HALTED : MINA_SIM_TRAP;
+    }
+    return s->status;
+}
+
+bool mina_sim_reset(MinaSim *s) {
+    if (!s->booted || !s->image || !s->mem.dirty) return sim_boot(s);
+    mem_reset_to_snapshot(&s->mem);
+    if (!cpu_reset(&s->cpu, &s->mem, s->load_entry)) {
+        s->status = MINA_SIM_ERROR;
+        return false;
+    }
+    sim_start(s);
+    return true;
+}
+
+uint64_t mina_sim_get_reg(const MinaSim *s, unsigned idx) {
+    return idx < 32 ? s->cpu.regs[idx] : 0;
+}
+
+void mina_sim_set_reg(MinaSim *s, unsigned idx, uint64_t val) {
+    if (idx > 0 && idx < 32) s->cpu.regs[idx] = val;
+}
+
+uint64_t mina_sim_get_pc(const MinaSim *s) {
+    return s->cpu.pc;
+}
+
+void mina_sim_set_pc(MinaSim *s, uint64_t pc) {
+    s->cpu.pc = pc;
+}
+
+uint64_t mina_sim_steps(const MinaSim *s) {
+    return s->cpu.steps;
+}
+
+int mina_sim_trap(const MinaSim *s) {
+    return (int)s->trap;
+}
+
+bool mina_sim_read_mem(MinaSim *s, uint64_t addr, void *buf, size_t len) {
+    return mem_read(&s->mem, addr, buf, len);
+}
+
+bool mina_sim_write_mem(MinaSim *s, uint64_t addr, const void *buf, size_t len) {
+    return mem_write(&s->mem, addr, buf, len);
+}
@@ -0,0 +1,87 @@
+#ifndef MINASIM_H
+#define MINASIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// libminasim: the MINA simulator as a library. Each MinaSim owns its own
+// hart, RAM and devices, so any number of instances can run in one
+// process (one thread per instance at a time). Console I/O and syscalls
+// can be redirected to host callbacks; without them the console is the
+// process's stdin/stdout/stderr, as in mina-sim. Host file syscalls use
+// the process-wide sandbox root and are off by default; the block device
+// is not available to library instances.
+
+typedef struct MinaSim MinaSim;
+
+typedef enum {
+    MINA_SIM_BUDGET = 0, // budget used up; mina_sim_run can continue
+    MINA_SIM_HALTED,     // ebreak, SYS_exit, or a syscall callback halt
+    MINA_SIM_TRAP,       // fatal trap; mina_sim_trap() has the code
+    MINA_SIM_ERROR,      // nothing loaded
+} MinaSimStatus;
+
+typedef enum {
+    MINA_SYSCALL_DEFAULT = 0, // not handled: run the built-in syscall
+    MINA_SYSCALL_DONE,        // handled: continue after the ecall
+    MINA_SYSCALL_HALT,        // handled: stop with MINA_SIM_HALTED
+} MinaSyscallResult;
+
+// fd is 1 (stdout, UART TX) or 2 (stderr).
+typedef void (*MinaConsoleWriteFn)(void *user, int fd, const uint8_t *buf, size_t len);
+// Must not block; return the bytes available now, 0 for none.
+typedef size_t (*MinaConsoleReadFn)(void *user, uint8_t *buf, size_t len);
+// Called on every ecall with a7 as nr; arguments are in r10..r13 and the
+// result goes in r10 via mina_sim_set_reg.
+typedef MinaSyscallResult (*MinaSyscallFn)(void *user, MinaSim *sim, uint64_t nr);
+
+// mem_size 0 selects the mina-sim default (64 MiB).
+MinaSim *mina_sim_create(size_t mem_size);
+void mina_sim_destroy(MinaSim *sim);
+
+// Load an ELF64 image (entry from the header) or a raw binary at address
+// 0. The image is copied; mina_sim_reset restores this state.
+bool mina_sim_load_elf(MinaSim *sim, const void *image, size_t len);
+bool mina_sim_load_raw(MinaSim *sim, const void *image, size_t len, uint64_t entry);
+
+void mina_sim_set_console(MinaSim *sim, MinaConsoleWriteFn write, MinaConsoleReadFn read, void *user);
+void mina_sim_set_syscall(MinaSim *sim, MinaSyscallFn fn, void *user);
+
+// Execute at most budget instructions.
+MinaSimStatus mina_sim_run(MinaSim *sim, uint64_t budget);
+// Back to the state right after the last load: RAM, registers, CSRs and
+// devices. Only RAM pages written since the load are copied back, so the
+// cost follows what the guest touched, not the RAM size. Callbacks stay
+// registered.
+bool mina_sim_reset(MinaSim *sim);
+
+uint64_t mina_sim_get_reg(const MinaSim *sim, unsigned idx);
+void mina_sim_set_reg(MinaSim *sim, unsigned idx, uint64_t val);
+uint64_t mina_sim_get_pc(const MinaSim *sim);
+void mina_sim_set_pc(MinaSim *sim, uint64_t pc);
+uint64_t mina_sim_steps(const MinaSim *sim);
+// Trap code of the last MINA_SIM_TRAP (the value mina-sim prints).
+int mina_sim_trap(const MinaSim *sim);
+
+// Instruction-mix and trap counters (mina-sim --stats), off by default.
+// They count from the last load or reset. write_stats prints them in the
+// --stats text or the --stats-json format; `seconds` is the host time the
+// caller measured for the MIPS figure.
+void mina_sim_set_stats(MinaSim *sim, bool on);
+bool mina_sim_write_stats(const MinaSim *sim, FILE *f, bool json, double seconds);
+
+// Physical RAM access; false if the range leaves RAM.
+bool mina_sim_read_mem(MinaSim *sim, uint64_t addr, void *buf, size_t len);
+bool mina_sim_write_mem(MinaSim *sim, uint64_t addr, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
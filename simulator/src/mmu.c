@@ -0,0 +1,88 @@
+#include "mmu.h"
+#include <string.h>
+
+#define MMU_LEVELS 3
+#define MMU_VPN_BITS 9
+#define MMU_VA_BITS 39
+
+void mmu_flush(Mmu *u) {
+    memset(u->tlb, 0, sizeof(u->tlb));
+}
+
+void mmu_flush_va(Mmu *u, uint64_t va) {
+    u->tlb[(va >> MEM_PAGE_SHIFT) & (MMU_TLB_SIZE - 1)].tag = 0;
+}
+
+void mmu_set_satp(Mmu *u, uint64_t satp) {
+    uint64_t mode = satp >> SATP_MODE_SHIFT;
+    // Unsupported modes are WARL: the write is ignored.
+    if (mode != SATP_MODE_BARE && mode != SATP_MODE_SV39) return;
+    u->satp = satp;
+    u->sv39 = (mode == SATP_MODE_SV39);
+    mmu_flush(u);
+}
+
+void mmu_set_status(Mmu *u, uint64_t mstatus) {
+    uint64_t s = mstatus & (MSTATUS_SUM | MSTATUS_MXR);
+    if (s == u->status) return;
+    u->status = s;
+    mmu_flush(u);
+}
+
+// Accesses a leaf PTE grants to the given privilege mode. Write permission
+// is only cached once D is set, so the first store to a clean page walks
+// again and marks it dirty.
+static uint32_t leaf_perm(const Mmu *u, uint64_t pte, unsigned priv) {
+    if (pte & PTE_U) {
+        if (priv == 1 && !(u->status & MSTATUS_SUM)) return 0;
+    } else if (priv == 0) {
+        return 0;
+    }
+    uint32_t perm = 0;
+    if ((pte & PTE_R) || ((pte & PTE_X) && (u->status & MSTATUS_MXR))) perm |= MMU_R;
+    if (pte & PTE_W) perm |= MMU_W;
+    // S-mode never executes user pages, even with SUM.
+    if ((pte & PTE_X) && !((pte & PTE_U) && priv == 1)) perm |= MMU_X;
+    return perm;
+}
+
+MmuResult mmu_walk(Mmu *u, Mem *m, uint64_t va, uint32_t access, unsigned priv, uint64_t *pa) {
+    u->tlb_misses++;
+    // Bits 63:39 must all equal bit 38.
+    if ((uint64_t)((int64_t)(va << (64 - MMU_VA_BITS)) >> (64 - MMU_VA_BITS)) != va) return MMU_PAGE_FAULT;
+
+    uint64_t table = (u->satp & SATP_PPN_MASK) << MEM_PAGE_SHIFT;
+    for (int level = MMU_LEVELS - 1; level >= 0; level--) {
+        unsigned shift = MEM_PAGE_SHIFT + (unsigned)level * MMU_VPN_BITS;
+        uint64_t pte_addr = table + ((va >> shift) & ((1u << MMU_VPN_BITS) - 1)) * 8;
+        uint64_t pte;
+        if (!(mem_is_ram(m, pte_addr) || mem_is_watched(m, pte_addr)) || !mem_read_u64(m, pte_addr, &pte)) return MMU_ACCESS_FAULT;
+        if (!(pte & PTE_V) || ((pte & PTE_W) && !(pte & PTE_R))) return MMU_PAGE_FAULT;
+
+        uint64_t ppn = (pte >> PTE_PPN_SHIFT) & PTE_PPN_MASK;
+        if (!(pte & (PTE_R | PTE_X))) {
+            table = ppn << MEM_PAGE_SHIFT;
+            continue;
+        }
+
+        // Leaf. Superpages must be aligned to their size.
+        uint64_t span = 1ull << shift;
+        if ((ppn << MEM_PAGE_SHIFT) & (span - 1)) return MMU_PAGE_FAULT;
+        uint32_t perm = leaf_perm(u, pte, priv);
+        if ((perm & access) != access) return MMU_PAGE_FAULT;
+
+        uint64_t upd = pte | PTE_A | ((access & MMU_W) ? PTE_D : 0);
+        if (upd != pte) mem_write_u64(m, pte_addr, upd);
+        if (!(upd & PTE_D)) perm &= ~MMU_W;
+
+        uint64_t page = (ppn << MEM_PAGE_SHIFT) | (va & (span - 1) & ~((1ull << MEM_PAGE_SHIFT) - 1));
+        uint64_t vpn = va >> MEM_PAGE_SHIFT;
+        TlbEntry *e = &u->tlb[vpn & (MMU_TLB_SIZE - 1)];
+        e->tag = MMU_TLB_VALID | (vpn << 2) | priv;
+        e->page = page;
+        e->perm = perm;
+        *pa = page | (va & ((1ull << MEM_PAGE_SHIFT) - 1));
+        return MMU_OK;
+    }
+    return MMU_PAGE_FAULT;
+}
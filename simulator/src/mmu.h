@@ -0,0 +1,84 @@
+#ifndef MINA_MMU_H
+#define MINA_MMU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mem.h"
+
+// Sv39-style paged MMU. satp.MODE selects bare (0) or Sv39 (8); with Sv39,
+// S- and U-mode fetches, loads and stores go through a three-level page
+// table walk (4 KiB, 2 MiB and 1 GiB pages). M-mode always uses physical
+// addresses. Walk results are cached per 4 KiB page in a direct-mapped
+// software TLB whose tag also carries the privilege mode, so a hit costs
+// one compare and trap entry/return never needs a flush.
+
+#define SATP_MODE_SHIFT 60
+#define SATP_MODE_BARE 0ull
+#define SATP_MODE_SV39 8ull
+#define SATP_PPN_MASK ((1ull << 44) - 1)
+
+#define PTE_V (1ull << 0)
+#define PTE_R (1ull << 1)
+#define PTE_W (1ull << 2)
+#define PTE_X (1ull << 3)
+#define PTE_U (1ull << 4)
+#define PTE_G (1ull << 5)
+#define PTE_A (1ull << 6)
+#define PTE_D (1ull << 7)
+#define PTE_PPN_SHIFT 10
+#define PTE_PPN_MASK ((1ull << 44) - 1)
+
+// Access types, matching the capability permission bits.
+#define MMU_R 0x1u
+#define MMU_W 0x2u
+#define MMU_X 0x4u
+
+// mstatus bits that change what a walk allows.
+#define MSTATUS_SUM (1ull << 18) // S-mode may load/store U pages
+#define MSTATUS_MXR (1ull << 19) // loads may read execute-only pages
+
+#define MMU_TLB_SIZE 256u
+#define MMU_TLB_VALID (1ull << 63)
+
+typedef struct {
+    uint64_t tag;  // MMU_TLB_VALID | vpn << 2 | priv, 0 when empty
+    uint64_t page; // physical address of the 4 KiB page
+    uint32_t perm; // MMU_R/W/X allowed from this entry
+} TlbEntry;
+
+typedef struct {
+    uint64_t satp;
+    bool sv39;
+    // mstatus.SUM/MXR as seen by the last walk; a change flushes the TLB.
+    uint64_t status;
+    uint64_t tlb_hits;
+    uint64_t tlb_misses;
+    TlbEntry tlb[MMU_TLB_SIZE];
+} Mmu;
+
+typedef enum {
+    MMU_OK = 0,
+    MMU_PAGE_FAULT,
+    MMU_ACCESS_FAULT, // page table entry outside RAM
+} MmuResult;
+
+void mmu_set_satp(Mmu *u, uint64_t satp);
+void mmu_set_status(Mmu *u, uint64_t mstatus);
+// sfence.vma: all entries, or only the page holding va.
+void mmu_flush(Mmu *u);
+void mmu_flush_va(Mmu *u, uint64_t va);
+
+MmuResult mmu_walk(Mmu *u, Mem *m, uint64_t va, uint32_t access, unsigned priv, uint64_t *pa);
+
+static inline MmuResult mmu_translate(Mmu *u, Mem *m, uint64_t va, uint32_t access, unsigned priv, uint64_t *pa) {
+    uint64_t vpn = va >> MEM_PAGE_SHIFT;
+    TlbEntry *e = &u->tlb[vpn & (MMU_TLB_SIZE - 1)];
+    if (e->tag == (MMU_TLB_VALID | (vpn << 2) | priv) && (e->perm & access) == access) {
+        u->tlb_hits++;
+        *pa = e->page | (va & ((1ull << MEM_PAGE_SHIFT) - 1));
+        return MMU_OK;
+    }
+    return mmu_walk(u, m, va, access, priv, pa);
+}
+
+#endif
@@ -0,0 +1,57 @@
+#define _XOPEN_SOURCE 700
+#include "progress.h"
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+volatile sig_atomic_t progress_pending;
+
+static double start_time, last_time;
+static uint64_t last_steps;
+
+static void on_signal(int sig) {
+    (void)sig;
+    progress_pending = 1;
+}
+
+bool progress_init(double heartbeat_seconds) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    // Guest syscalls blocked on the host restart instead of failing.
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &sa, NULL) != 0) return false;
+    start_time = last_time = stats_now();
+    last_steps = 0;
+    if (heartbeat_seconds <= 0) return true;
+
+    if (sigaction(SIGALRM, &sa, NULL) != 0) return false;
+    struct itimerval it;
+    it.it_interval.tv_sec = (time_t)heartbeat_seconds;
+    it.it_interval.tv_usec = (suseconds_t)((heartbeat_seconds - (double)it.it_interval.tv_sec) * 1e6);
+    if (it.it_interval.tv_sec == 0 && it.it_interval.tv_usec == 0) it.it_interval.tv_usec = 1;
+    it.it_value = it.it_interval;
+    return setitimer(ITIMER_REAL, &it, NULL) == 0;
+}
+
+void progress_stop(void) {
+    struct itimerval it;
+    memset(&it, 0, sizeof(it));
+    setitimer(ITIMER_REAL, &it, NULL);
+}
+
+void progress_report(const Cpu *c) {
+    progress_pending = 0;
+    double now = stats_now();
+    double total = now - start_time;
+    double span = now - last_time;
+    fprintf(stderr, "progress: pc=0x%llx steps=%llu elapsed=%.1fs mips=%.1f recent=%.1f\n",
+            (unsigned long long)c->pc, (unsigned long long)c->steps, total,
+            total > 0 ? (double)c->steps / total / 1e6 : 0.0,
+            span > 0 ? (double)(c->steps - last_steps) / span / 1e6 : 0.0);
+    if (c->stats) stats_print(stderr, c->stats, c->steps, total);
+    last_time = now;
+    last_steps = c->steps;
+}
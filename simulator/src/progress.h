@@ -0,0 +1,24 @@
+#ifndef MINA_PROGRESS_H
+#define MINA_PROGRESS_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "cpu.h"
+
+// Progress lines for long runs. SIGUSR1, and with --heartbeat a periodic
+// SIGALRM, only set `progress_pending`; the run loop tests that one flag
+// between slices of instructions (and the sampling loop once per step) and
+// calls progress_report, so nothing unsafe runs in signal context.
+
+extern volatile sig_atomic_t progress_pending;
+
+// Install the SIGUSR1 handler and, when seconds > 0, an interval timer.
+bool progress_init(double heartbeat_seconds);
+void progress_stop(void);
+
+// PC, steps, overall and since-last-report MIPS, plus the --stats counters
+// when they are being collected. Clears progress_pending.
+void progress_report(const Cpu *c);
+
+#endif
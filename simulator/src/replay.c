@@ -0,0 +1,139 @@
+#include "replay.h"
+#include <string.h>
+
+static bool put_varint(FILE *f, uint64_t v) {
+    uint8_t buf[10];
+    size_t n = 0;
+    do {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        buf[n++] = b | (v ? 0x80 : 0);
+    } while (v);
+    return fwrite(buf, 1, n, f) == n;
+}
+
+static bool get_varint(FILE *f, uint64_t *out) {
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int b = fgetc(f);
+        if (b == EOF) return false;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool replay_open(Replay *r, const char *path, ReplayMode mode) {
+    memset(r, 0, sizeof(*r));
+    r->mode = mode;
+    r->f = fopen(path, mode == REPLAY_RECORD ? "wb" : "rb");
+    if (!r->f) return false;
+    uint8_t hdr[5];
+    if (mode == REPLAY_RECORD) {
+        memcpy(hdr, REPLAY_MAGIC, 4);
+        hdr[4] = REPLAY_VERSION;
+        if (fwrite(hdr, 1, sizeof(hdr), r->f) == sizeof(hdr) && fflush(r->f) == 0) return true;
+    } else if (fread(hdr, 1, sizeof(hdr), r->f) == sizeof(hdr) &&
+               memcmp(hdr, REPLAY_MAGIC, 4) == 0 && hdr[4] == REPLAY_VERSION) {
+        return true;
+    }
+    fclose(r->f);
+    r->f = NULL;
+    return false;
+}
+
+bool replay_close(Replay *r) {
+    if (!r->f) return false;
+    bool ok = !r->failed;
+    if (r->mode == REPLAY_PLAY && r->pending) {
+        fprintf(stderr, "replay: run ended before the event at step %llu\n", (unsigned long long)r->at_step);
+        ok = false;
+    }
+    if (fclose(r->f) != 0) ok = false;
+    r->f = NULL;
+    return ok;
+}
+
+uint32_t replay_query(Replay *r, uint64_t step) {
+    if (step != r->step) {
+        r->step = step;
+        r->query = 0;
+    }
+    return r->query++;
+}
+
+void replay_write(Replay *r, uint64_t step, uint32_t query, const uint8_t *data, size_t len, bool eof) {
+    if (r->failed) return;
+    bool ok = put_varint(r->f, step - r->last_step) &&
+              put_varint(r->f, query) &&
+              put_varint(r->f, (uint64_t)len << 1 | (eof ? 1 : 0)) &&
+              fwrite(data, 1, len, r->f) == len &&
+              fflush(r->f) == 0;
+    if (!ok) {
+        fprintf(stderr, "record: write failed after %llu events\n", (unsigned long long)r->events);
+        r->failed = true;
+        return;
+    }
+    r->last_step = step;
+    r->events++;
+}
+
+// Decodes the next event into the pending slot; a clean end of file or a
+// damaged tail ends the log.
+static void replay_read(Replay *r) {
+    uint64_t delta, query, len_eof;
+    if (!get_varint(r->f, &delta)) {
+        r->ended = true;
+        return;
+    }
+    if (!get_varint(r->f, &query) || !get_varint(r->f, &len_eof) ||
+        (len_eof >> 1) > REPLAY_MAX_BYTES || query > UINT32_MAX ||
+        fread(r->data, 1, (size_t)(len_eof >> 1), r->f) != (size_t)(len_eof >> 1)) {
+        fprintf(stderr, "replay: log truncated or corrupt after %llu events\n", (unsigned long long)r->events);
+        r->failed = true;
+        r->ended = true;
+        return;
+    }
+    r->last_step += delta;
+    r->at_step = r->last_step;
+    r->at_query = (uint32_t)query;
+    r->len = (uint32_t)(len_eof >> 1);
+    r->eof = len_eof & 1;
+    r->pending = true;
+}
+
+bool replay_take(Replay *r, uint64_t step, uint32_t query, const uint8_t **data, size_t *len, bool *eof) {
+    if (!r->pending && !r->ended) replay_read(r);
+    if (r->pending && (r->at_step < step || (r->at_step == step && r->at_query < query))) {
+        replay_diverged(r, step);
+    }
+    if (r->ended) {
+        *data = NULL;
+        *len = 0;
+        *eof = true;
+        return true;
+    }
+    if (r->at_step != step || r->at_query != query) return false;
+    r->pending = false;
+    r->events++;
+    *data = r->data;
+    *len = r->len;
+    *eof = r->eof;
+    return true;
+}
+
+void replay_diverged(Replay *r, uint64_t step) {
+    if (r->ended) return;
+    if (r->pending) {
+        fprintf(stderr, "replay: diverged at step %llu (next event at step %llu)\n",
+                (unsigned long long)step, (unsigned long long)r->at_step);
+    } else {
+        fprintf(stderr, "replay: diverged at step %llu\n", (unsigned long long)step);
+    }
+    r->failed = true;
+    r->pending = false;
+    r->ended = true;
+}
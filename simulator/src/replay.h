@@ -0,0 +1,75 @@
+#ifndef MINA_REPLAY_H
+#define MINA_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Input log for --record / --replay. The only nondeterministic input a
+// run sees is host console input: what the UART STATUS/RX registers and
+// the console read syscalls find in the stdin ring depends on when the
+// host delivered it. Every such guest query is numbered by the retired
+// instruction count (Cpu.steps) and its index among the queries made at
+// that count; whenever a query sees new bytes or EOF, recording appends an
+// event and replaying injects the same bytes at the same query instead of
+// reading stdin. Replay therefore never waits on the host. Device
+// completions (DMA, block) are made synchronous while either mode is on,
+// so their timing is the instruction count as well.
+//
+// The log is written as it goes (flushed per event, so a killed run keeps
+// everything up to its last input) and read one event at a time:
+//   char magic[4] = "MREC"; uint8 version = 1;
+//   then per event:
+//     varint step_delta;   // steps since the previous event
+//     varint query;        // index of the query within that step
+//     varint len_eof;      // bytes << 1 | (1 if stdin reached EOF)
+//     uint8 bytes[len];
+// with LEB128 varints.
+
+#define REPLAY_MAGIC "MREC"
+#define REPLAY_VERSION 1u
+#define REPLAY_MAX_BYTES 4096u
+
+typedef enum { REPLAY_RECORD, REPLAY_PLAY } ReplayMode;
+
+typedef struct Replay {
+    FILE *f;
+    ReplayMode mode;
+    bool failed;        // write error, or a corrupt log
+    uint64_t events;
+    // Current query position.
+    uint64_t step;
+    uint32_t query;
+    // Step of the last event written or read (deltas are relative to it).
+    uint64_t last_step;
+    // Play: the next event, decoded ahead of its step.
+    bool pending;
+    bool ended;
+    uint64_t at_step;
+    uint32_t at_query;
+    uint32_t len;
+    bool eof;
+    uint8_t data[REPLAY_MAX_BYTES];
+} Replay;
+
+bool replay_open(Replay *r, const char *path, ReplayMode mode);
+// Closes the log; false when writing failed or, on replay, when events
+// were left over (the run diverged from the recorded one).
+bool replay_close(Replay *r);
+
+// Numbers the next input query made at instruction `step`.
+uint32_t replay_query(Replay *r, uint64_t step);
+
+// Record: the query (step, query) saw `len` new bytes and/or EOF.
+void replay_write(Replay *r, uint64_t step, uint32_t query, const uint8_t *data, size_t len, bool eof);
+
+// Play: the event recorded for (step, query), if any. Once the log is
+// exhausted every query reports EOF with no data.
+bool replay_take(Replay *r, uint64_t step, uint32_t query, const uint8_t **data, size_t *len, bool *eof);
+
+// Play: a query that must have seen input (the recording blocked there)
+// found no event. Reports the divergence and ends the log.
+void replay_diverged(Replay *r, uint64_t step);
+
+#endif
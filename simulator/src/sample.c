@@ -0,0 +1,466 @@
+#include "sample.h"
+#include "isa.h"
+#include "progress.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    unsigned sets, ways;
+    uint64_t *tag;   // line + 1, 0 when empty
+    uint64_t *stamp; // last use, for LRU
+    uint64_t clock;
+    uint64_t accesses, misses;
+} CacheModel;
+
+typedef struct {
+    double cpi, imiss, dmiss;
+    bool has_d;
+} WindowStats;
+
+typedef struct {
+    uint32_t id;
+    uint64_t count;
+} BbvEntry;
+
+typedef struct {
+    BbvEntry *v;
+    size_t n;
+    uint64_t total;
+} BbvInterval;
+
+typedef struct {
+    const SampleConfig *cfg;
+    CacheModel l1i, l1d;
+    uint64_t cycles, instrs;
+    // Counters at the start of the open window.
+    uint64_t w_cycles, w_instrs, w_iacc, w_imiss, w_dacc, w_dmiss;
+    WindowStats *win;
+    size_t nwin, capwin;
+
+    // BBV state: PC -> dense block id (1-based) in an open-addressing table.
+    FILE *bbv;
+    uint64_t *keys;
+    uint32_t *ids;
+    size_t tcap, nblocks;
+    uint64_t *counts;   // by id
+    uint32_t *touched;  // ids with a count this interval
+    size_t ntouched, ccap;
+    uint32_t cur;
+    uint64_t run;
+    BbvInterval *ivs;
+    size_t niv, capiv;
+} Sampler;
+
+static bool cache_init(CacheModel *k, unsigned sets, unsigned ways) {
+    memset(k, 0, sizeof(*k));
+    k->sets = sets;
+    k->ways = ways;
+    k->tag = (uint64_t *)calloc((size_t)sets * ways, sizeof(uint64_t));
+    k->stamp = (uint64_t *)calloc((size_t)sets * ways, sizeof(uint64_t));
+    return k->tag && k->stamp;
+}
+
+static void cache_free(CacheModel *k) {
+    free(k->tag);
+    free(k->stamp);
+}
+
+// True on a hit. Misses fill the least recently used way.
+static bool cache_access(CacheModel *k, uint64_t addr) {
+    uint64_t line = addr >> SAMPLE_LINE_SHIFT;
+    size_t base = (size_t)(line % k->sets) * k->ways;
+    size_t victim = base;
+    k->accesses++;
+    k->clock++;
+    for (size_t w = base; w < base + k->ways; w++) {
+        if (k->tag[w] == line + 1) {
+            k->stamp[w] = k->clock;
+            return true;
+        }
+        if (k->stamp[w] < k->stamp[victim]) victim = w;
+    }
+    k->misses++;
+    k->tag[victim] = line + 1;
+    k->stamp[victim] = k->clock;
+    return false;
+}
+
+bool sample_parse(SampleConfig *cfg, const char *spec) {
+    char *end;
+    cfg->interval = strtoull(spec, &end, 0);
+    if (end == spec || *end != ':') return false;
+    const char *p = end + 1;
+    cfg->window = strtoull(p, &end, 0);
+    if (end == p) return false;
+    cfg->warm = 0;
+    cfg->warm_all = false;
+    if (*end == ':') {
+        p = end + 1;
+        if (strcmp(p, "all") == 0) {
+            cfg->warm_all = true;
+            end = (char *)p + 3;
+        } else {
+            cfg->warm = strtoull(p, &end, 0);
+            if (end == p) return false;
+        }
+    }
+    if (*end != '\0') return false;
+    return cfg->window > 0 && cfg->window <= cfg->interval && cfg->warm <= cfg->interval - cfg->window;
+}
+
+// One instruction under the model. `timing` charges cycles; otherwise the
+// caches are only warmed.
+static Trap model_step(Sampler *s, Cpu *c, Mem *m, bool timing) {
+    uint64_t pc = c->pc;
+    uint32_t insn = 0;
+    if (!mem_is_ram(m, pc) || !mem_read_u32(m, pc, &insn)) insn = 0;
+    uint32_t op = insn & 0x7F;
+    uint32_t f3 = get_bits(insn, 14, 12);
+    uint64_t base = c->regs[get_bits(insn, 19, 15)];
+    bool data = true;
+    uint64_t ea = 0;
+    if (op == OP_LOAD) ea = base + (uint64_t)sign_extend(get_bits(insn, 31, 20), 12);
+    else if (op == OP_STORE) ea = base + (uint64_t)sign_extend((get_bits(insn, 31, 25) << 5) | get_bits(insn, 11, 7), 12);
+    else if (op == OP_AMO) ea = base;
+    else data = false;
+
+    Trap t = cpu_step(c, m);
+
+    bool ihit = cache_access(&s->l1i, pc);
+    bool dhit = !data || cache_access(&s->l1d, ea);
+    if (!timing) return t;
+    uint64_t cyc = 1;
+    if (!ihit) cyc += SAMPLE_MISS_CYCLES;
+    if (!dhit) cyc += SAMPLE_MISS_CYCLES;
+    switch (op) {
+        case OP_BRANCH: case OP_JAL: case OP_JALR:
+            if (c->pc != pc + 4) cyc += SAMPLE_TAKEN_CYCLES;
+            break;
+        case OP_OP:
+            if (get_bits(insn, 31, 25) == 0x01) cyc += (f3 < 4) ? SAMPLE_MUL_CYCLES : SAMPLE_DIV_CYCLES;
+            break;
+        case OP_AMO: cyc += SAMPLE_AMO_CYCLES; break;
+        case OP_SYSTEM: cyc += SAMPLE_SYSTEM_CYCLES; break;
+        case OP_TENSOR: cyc += SAMPLE_TENSOR_CYCLES; break;
+        default: break;
+    }
+    s->cycles += cyc;
+    s->instrs++;
+    return t;
+}
+
+static void window_open(Sampler *s) {
+    s->w_cycles = s->cycles;
+    s->w_instrs = s->instrs;
+    s->w_iacc = s->l1i.accesses;
+    s->w_imiss = s->l1i.misses;
+    s->w_dacc = s->l1d.accesses;
+    s->w_dmiss = s->l1d.misses;
+}
+
+static void window_close(Sampler *s) {
+    uint64_t n = s->instrs - s->w_instrs;
+    if (n == 0) return;
+    if (s->nwin == s->capwin) {
+        size_t cap = s->capwin ? s->capwin * 2 : 64;
+        WindowStats *w = (WindowStats *)realloc(s->win, cap * sizeof(*w));
+        if (!w) return;
+        s->win = w;
+        s->capwin = cap;
+    }
+    WindowStats *w = &s->win[s->nwin++];
+    uint64_t iacc = s->l1i.accesses - s->w_iacc;
+    uint64_t dacc = s->l1d.accesses - s->w_dacc;
+    w->cpi = (double)(s->cycles - s->w_cycles) / (double)n;
+    w->imiss = iacc ? (double)(s->l1i.misses - s->w_imiss) / (double)iacc : 0.0;
+    w->has_d = dacc != 0;
+    w->dmiss = dacc ? (double)(s->l1d.misses - s->w_dmiss) / (double)dacc : 0.0;
+}
+
+static uint32_t bbv_id(Sampler *s, uint64_t pc) {
+    if (s->nblocks * 2 >= s->tcap) {
+        size_t cap = s->tcap ? s->tcap * 2 : 1024;
+        uint64_t *keys = (uint64_t *)calloc(cap, sizeof(uint64_t));
+        uint32_t *ids = (uint32_t *)calloc(cap, sizeof(uint32_t));
+        uint64_t *counts = (uint64_t *)calloc(cap / 2 + 1, sizeof(uint64_t));
+        uint32_t *touched = (uint32_t *)calloc(cap / 2 + 1, sizeof(uint32_t));
+        if (!keys || !ids || !counts || !touched) {
+            free(keys); free(ids); free(counts); free(touched);
+            return s->cur;
+        }
+        for (size_t i = 0; i < s->tcap; i++) {
+            if (!s->ids[i]) continue;
+            size_t h = (size_t)((s->keys[i] >> 2) * 0x9E3779B97F4A7C15ull) & (cap - 1);
+            while (ids[h]) h = (h + 1) & (cap - 1);
+            keys[h] = s->keys[i];
+            ids[h] = s->ids[i];
+        }
+        if (s->counts) memcpy(counts, s->counts, (s->nblocks + 1) * sizeof(uint64_t));
+        if (s->touched) memcpy(touched, s->touched, s->ntouched * sizeof(uint32_t));
+        free(s->keys); free(s->ids); free(s->counts); free(s->touched);
+        s->keys = keys;
+        s->ids = ids;
+        s->counts = counts;
+        s->touched = touched;
+        s->tcap = cap;
+    }
+    size_t h = (size_t)((pc >> 2) * 0x9E3779B97F4A7C15ull) & (s->tcap - 1);
+    while (s->ids[h]) {
+        if (s->keys[h] == pc) return s->ids[h];
+        h = (h + 1) & (s->tcap - 1);
+    }
+    s->keys[h] = pc;
+    s->ids[h] = (uint32_t)++s->nblocks;
+    return s->ids[h];
+}
+
+static void bbv_flush_run(Sampler *s) {
+    if (!s->run || !s->cur) return;
+    if (!s->counts[s->cur]) s->touched[s->ntouched++] = s->cur;
+    s->counts[s->cur] += s->run;
+    s->run = 0;
+}
+
+static void bbv_step(Sampler *s, uint64_t prev_pc, uint64_t pc) {
+    s->run++;
+    if (pc == prev_pc + 4) return;
+    bbv_flush_run(s);
+    s->cur = bbv_id(s, pc);
+}
+
+static void bbv_end_interval(Sampler *s) {
+    bbv_flush_run(s);
+    if (s->ntouched == 0) return;
+    BbvInterval iv = {0};
+    iv.v = (BbvEntry *)malloc(s->ntouched * sizeof(BbvEntry));
+    fputc('T', s->bbv);
+    for (size_t i = 0; i < s->ntouched; i++) {
+        uint32_t id = s->touched[i];
+        fprintf(s->bbv, ":%u:%llu ", id, (unsigned long long)s->counts[id]);
+        if (iv.v) iv.v[i] = (BbvEntry){ id, s->counts[id] };
+        iv.total += s->counts[id];
+        s->counts[id] = 0;
+    }
+    fputc('\n', s->bbv);
+    iv.n = iv.v ? s->ntouched : 0;
+    s->ntouched = 0;
+    if (s->niv == s->capiv) {
+        size_t cap = s->capiv ? s->capiv * 2 : 64;
+        BbvInterval *p = (BbvInterval *)realloc(s->ivs, cap * sizeof(*p));
+        if (!p) { free(iv.v); return; }
+        s->ivs = p;
+        s->capiv = cap;
+    }
+    s->ivs[s->niv++] = iv;
+}
+
+// Fixed pseudo-random projection coefficient in [-1, 1) for a block id.
+static double proj(uint32_t id, unsigned d) {
+    uint64_t z = ((uint64_t)id << 8 | d) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (double)(z >> 11) / (double)(1ull << 52) - 1.0;
+}
+
+static double dist2(const double *a, const double *b) {
+    double d = 0;
+    for (unsigned k = 0; k < SAMPLE_BBV_DIMS; k++) d += (a[k] - b[k]) * (a[k] - b[k]);
+    return d;
+}
+
+// k-means over projected, normalised BBVs. Initial centroids are chosen
+// farthest-first from interval 0, so results are reproducible.
+static bool simpoints_write(Sampler *s, const char *bbv_path) {
+    size_t n = s->niv;
+    size_t k = s->cfg->simpoints < n ? s->cfg->simpoints : n;
+    if (k == 0) return true;
+    double *x = (double *)calloc(n * SAMPLE_BBV_DIMS, sizeof(double));
+    double *cen = (double *)calloc(k * SAMPLE_BBV_DIMS, sizeof(double));
+    size_t *asg = (size_t *)calloc(n, sizeof(size_t));
+    size_t *size = (size_t *)calloc(k, sizeof(size_t));
+    double *best = (double *)calloc(n, sizeof(double));
+    bool ok = x && cen && asg && size && best;
+    for (size_t i = 0; ok && i < n; i++) {
+        const BbvInterval *iv = &s->ivs[i];
+        for (size_t j = 0; j < iv->n; j++) {
+            double w = (double)iv->v[j].count / (double)iv->total;
+            for (unsigned d = 0; d < SAMPLE_BBV_DIMS; d++) x[i * SAMPLE_BBV_DIMS + d] += w * proj(iv->v[j].id, d);
+        }
+    }
+    for (size_t c = 0; ok && c < k; c++) {
+        size_t pick = 0;
+        if (c > 0) {
+            for (size_t i = 0; i < n; i++) {
+                double d = dist2(&x[i * SAMPLE_BBV_DIMS], &cen[(c - 1) * SAMPLE_BBV_DIMS]);
+                if (c == 1 || d < best[i]) best[i] = d;
+                if (best[i] > best[pick]) pick = i;
+            }
+        }
+        memcpy(&cen[c * SAMPLE_BBV_DIMS], &x[pick * SAMPLE_BBV_DIMS], SAMPLE_BBV_DIMS * sizeof(double));
+    }
+    for (int iter = 0; ok && iter < 100; iter++) {
+        bool moved = false;
+        for (size_t i = 0; i < n; i++) {
+            size_t bc = 0;
+            for (size_t c = 1; c < k; c++) {
+                if (dist2(&x[i * SAMPLE_BBV_DIMS], &cen[c * SAMPLE_BBV_DIMS]) <
+                    dist2(&x[i * SAMPLE_BBV_DIMS], &cen[bc * SAMPLE_BBV_DIMS])) bc = c;
+            }
+            if (iter == 0 || asg[i] != bc) moved = true;
+            asg[i] = bc;
+        }
+        if (!moved) break;
+        memset(cen, 0, k * SAMPLE_BBV_DIMS * sizeof(double));
+        memset(size, 0, k * sizeof(size_t));
+        for (size_t i = 0; i < n; i++) {
+            size[asg[i]]++;
+            for (unsigned d = 0; d < SAMPLE_BBV_DIMS; d++) cen[asg[i] * SAMPLE_BBV_DIMS + d] += x[i * SAMPLE_BBV_DIMS + d];
+        }
+        for (size_t c = 0; c < k; c++) {
+            for (unsigned d = 0; size[c] && d < SAMPLE_BBV_DIMS; d++) cen[c * SAMPLE_BBV_DIMS + d] /= (double)size[c];
+        }
+    }
+
+    char path[4096];
+    FILE *fp = NULL, *fw = NULL;
+    if (ok) {
+        snprintf(path, sizeof(path), "%s.simpoints", bbv_path);
+        fp = fopen(path, "w");
+        snprintf(path, sizeof(path), "%s.weights", bbv_path);
+        fw = fopen(path, "w");
+        ok = fp && fw;
+    }
+    size_t used = 0;
+    for (size_t c = 0; ok && c < k; c++) {
+        if (!size[c]) continue;
+        size_t rep = n;
+        for (size_t i = 0; i < n; i++) {
+            if (asg[i] != c) continue;
+            if (rep == n || dist2(&x[i * SAMPLE_BBV_DIMS], &cen[c * SAMPLE_BBV_DIMS]) <
+                                dist2(&x[rep * SAMPLE_BBV_DIMS], &cen[c * SAMPLE_BBV_DIMS])) rep = i;
+        }
+        fprintf(fp, "%zu %zu\n", rep, used);
+        fprintf(fw, "%.6f %zu\n", (double)size[c] / (double)n, used);
+        used++;
+    }
+    if (fp && fclose(fp) != 0) ok = false;
+    if (fw && fclose(fw) != 0) ok = false;
+    if (ok) fprintf(stderr, "simpoints: %zu of %zu intervals -> %s.simpoints, %s.weights\n", used, n, bbv_path, bbv_path);
+    free(x); free(cen); free(asg); free(size); free(best);
+    return ok;
+}
+
+// Mean and 95% confidence half-width (normal approximation) of one
+// statistic across windows.
+static void estimate(const Sampler *s, size_t field, double *mean, double *half) {
+    double sum = 0, sq = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < s->nwin; i++) {
+        const WindowStats *w = &s->win[i];
+        if (field == 2 && !w->has_d) continue;
+        double v = field == 0 ? w->cpi : field == 1 ? w->imiss : w->dmiss;
+        sum += v;
+        sq += v * v;
+        n++;
+    }
+    *mean = n ? sum / (double)n : 0.0;
+    double var = n > 1 ? (sq - sum * sum / (double)n) / (double)(n - 1) : 0.0;
+    *half = n > 1 ? 1.96 * sqrt(var > 0 ? var : 0) / sqrt((double)n) : 0.0;
+}
+
+static void report(const Sampler *s, uint64_t steps) {
+    const SampleConfig *cfg = s->cfg;
+    if (!cfg->interval) return;
+    fprintf(stderr, "sample: %zu windows of %llu instructions every %llu (warm %s%llu)\n",
+            s->nwin, (unsigned long long)cfg->window, (unsigned long long)cfg->interval,
+            cfg->warm_all ? "all, " : "", (unsigned long long)cfg->warm);
+    if (!s->nwin) return;
+    double cpi, cpi_h, im, im_h, dm, dm_h;
+    estimate(s, 0, &cpi, &cpi_h);
+    estimate(s, 1, &im, &im_h);
+    estimate(s, 2, &dm, &dm_h);
+    fprintf(stderr, "sample: CPI %.3f +/- %.3f, L1I miss %.2f%% +/- %.2f%%, L1D miss %.2f%% +/- %.2f%% (95%% CI)\n",
+            cpi, cpi_h, im * 100, im_h * 100, dm * 100, dm_h * 100);
+    fprintf(stderr, "sample: estimated %.0f cycles for %llu instructions\n",
+            cpi * (double)steps, (unsigned long long)steps);
+}
+
+enum { RUN_FAST, RUN_WARM, RUN_DETAIL };
+
+Trap sample_run(Cpu *c, Mem *m, uint64_t max_steps, const SampleConfig *cfg, uint64_t *steps_out) {
+    Sampler s;
+    memset(&s, 0, sizeof(s));
+    s.cfg = cfg;
+    Trap t = TRAP_NONE;
+    uint64_t n = 0;
+    if (!cache_init(&s.l1i, SAMPLE_L1I_SETS, SAMPLE_L1I_WAYS) || !cache_init(&s.l1d, SAMPLE_L1D_SETS, SAMPLE_L1D_WAYS)) {
+        fprintf(stderr, "sample: out of memory\n");
+        goto done;
+    }
+    if (cfg->bbv_path) {
+        s.bbv = fopen(cfg->bbv_path, "w");
+        if (!s.bbv) {
+            fprintf(stderr, "sample: cannot write %s\n", cfg->bbv_path);
+            goto done;
+        }
+        s.cur = bbv_id(&s, c->pc);
+    }
+    uint64_t bbv_len = cfg->interval ? cfg->interval : SAMPLE_BBV_INTERVAL;
+
+    while (n < max_steps && t == TRAP_NONE) {
+        int mode = RUN_FAST;
+        uint64_t end = max_steps;
+        if (cfg->interval) {
+            uint64_t pos = n % cfg->interval;
+            uint64_t detail = cfg->interval - cfg->window;
+            uint64_t warm = detail - cfg->warm;
+            if (pos >= detail) {
+                mode = RUN_DETAIL;
+                end = n - pos + cfg->interval;
+                if (pos == detail) window_open(&s);
+            } else if (pos >= warm) {
+                mode = RUN_WARM;
+                end = n - pos + detail;
+            } else {
+                mode = cfg->warm_all ? RUN_WARM : RUN_FAST;
+                end = n - pos + warm;
+            }
+        }
+        if (s.bbv && n - n % bbv_len + bbv_len < end) end = n - n % bbv_len + bbv_len;
+        if (end > max_steps) end = max_steps;
+
+        while (n < end) {
+            uint64_t pc = c->pc;
+            if (mode == RUN_FAST) t = cpu_step(c, m);
+            else t = model_step(&s, c, m, mode == RUN_DETAIL);
+            if (t != TRAP_NONE) break;
+            if (s.bbv) bbv_step(&s, pc, c->pc);
+            n++;
+            if (progress_pending) progress_report(c);
+        }
+        if (mode == RUN_DETAIL && n == end && end % cfg->interval == 0) window_close(&s);
+        if (s.bbv && (n % bbv_len == 0 || t != TRAP_NONE || n >= max_steps)) bbv_end_interval(&s);
+    }
+
+    report(&s, n);
+    if (s.bbv) {
+        bool ok = fclose(s.bbv) == 0;
+        s.bbv = NULL;
+        fprintf(stderr, "bbv: %zu intervals, %zu blocks -> %s\n", s.niv, s.nblocks, cfg->bbv_path);
+        if (!ok || !simpoints_write(&s, cfg->bbv_path)) fprintf(stderr, "sample: failed to write %s\n", cfg->bbv_path);
+    }
+
+done:
+    if (s.bbv) fclose(s.bbv);
+    cache_free(&s.l1i);
+    cache_free(&s.l1d);
+    free(s.win);
+    free(s.keys); free(s.ids); free(s.counts); free(s.touched);
+    for (size_t i = 0; i < s.niv; i++) free(s.ivs[i].v);
+    free(s.ivs);
+    *steps_out = n;
+    return t;
+}
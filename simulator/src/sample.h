@@ -0,0 +1,62 @@
+#ifndef MINA_SAMPLE_H
+#define MINA_SAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+
+// Sampled simulation (--sample) and basic-block vectors (--bbv).
+//
+// The run is cut into intervals of `interval` instructions. Most of each
+// interval fast-forwards through plain cpu_step; the last `window`
+// instructions run under a detailed model (in-order pipeline cost plus
+// set-associative L1 instruction and data caches), preceded by `warm`
+// instructions that only update the caches. With `warm_all` the caches
+// are updated throughout the fast-forward instead. At exit the per-window
+// CPI and miss rates are extrapolated to the whole run with a 95%
+// confidence interval over the windows.
+//
+// BBVs count, per interval, the instructions executed in each basic block
+// (keyed by the block's entry PC) and are written in SimPoint's .bb
+// format. With `simpoints` > 0 the intervals are clustered (random
+// projection to SAMPLE_BBV_DIMS dimensions, k-means) and the interval
+// nearest each centroid is written to BBV_FILE.simpoints with its weight.
+//
+// The model decodes the instruction at the PC from RAM before each
+// detailed step, so it assumes code is identity-mapped when paging is on.
+
+#define SAMPLE_BBV_INTERVAL 10000000ull
+#define SAMPLE_BBV_DIMS 15
+
+// Model parameters (cycles).
+#define SAMPLE_LINE_SHIFT 6
+#define SAMPLE_L1I_SETS 64   // 16 KiB, 4-way
+#define SAMPLE_L1I_WAYS 4
+#define SAMPLE_L1D_SETS 64   // 32 KiB, 8-way
+#define SAMPLE_L1D_WAYS 8
+#define SAMPLE_MISS_CYCLES 30
+#define SAMPLE_TAKEN_CYCLES 2 // taken branch or jump (fetch redirect)
+#define SAMPLE_MUL_CYCLES 3
+#define SAMPLE_DIV_CYCLES 20
+#define SAMPLE_AMO_CYCLES 4
+#define SAMPLE_SYSTEM_CYCLES 4
+#define SAMPLE_TENSOR_CYCLES 8
+
+typedef struct {
+    uint64_t interval;    // 0: no detailed windows
+    uint64_t window;
+    uint64_t warm;
+    bool warm_all;
+    const char *bbv_path; // NULL: no BBVs
+    unsigned simpoints;
+} SampleConfig;
+
+// INTERVAL:WINDOW[:WARM], or INTERVAL:WINDOW:all for warm_all.
+bool sample_parse(SampleConfig *cfg, const char *spec);
+
+// Runs like the plain step loop in main (stops on a trap or after
+// max_steps instructions) and prints the estimates to stderr.
+Trap sample_run(Cpu *c, Mem *m, uint64_t max_steps, const SampleConfig *cfg, uint64_t *steps_out);
+
+#endif
@@ -0,0 +1,620 @@
+#define _XOPEN_SOURCE 700
+#include "loader.h"
+#include "minasim.h"
+#include "simd.h"
+#include "stats.h"
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Steps per mina_sim_run call: console output is flushed to the client
+// and a vanished client noticed between slices.
+#define SIMD_SLICE (1u << 20)
+#define SIMD_OUT_BUF 4096u
+#define SIMD_DEFAULT_POOL 2u
+
+static void usage(const char *argv0) {
+    printf("Usage: %s [options]                      serve jobs\n", argv0);
+    printf("       %s run [options] program.bin      run a job on a server\n", argv0);
+    printf("Server options:\n");
+    printf("  -S PATH   socket (default $MINA_SIMD_SOCKET or %s)\n", SIMD_DEFAULT_SOCKET);
+    printf("  -j N      simulator instances in the pool (default %u)\n", SIMD_DEFAULT_POOL);
+    printf("  -m N      memory size bytes per instance (default 67108864)\n");
+    printf("Run options:\n");
+    printf("  -S PATH   socket of the server\n");
+    printf("  -s N      max steps (default %llu)\n", (unsigned long long)SIMD_DEFAULT_STEPS);
+    printf("  -n        send no stdin (stdin is sent unless it is a terminal)\n");
+    printf("  -v        report whether the image was cached and the job time\n");
+    printf("  --path    let the server read the image itself instead of sending it\n");
+    printf("  --stats   print instruction mix and traps at exit\n");
+    printf("  --stats-json FILE  write the same statistics as JSON\n");
+}
+
+static const char *socket_path(const char *opt) {
+    if (opt) return opt;
+    const char *env = getenv("MINA_SIMD_SOCKET");
+    return (env && *env) ? env : SIMD_DEFAULT_SOCKET;
+}
+
+static bool sun_path(struct sockaddr_un *sa, const char *path) {
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa->sun_path)) return false;
+    strcpy(sa->sun_path, path);
+    return true;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static bool io_write(int fd, const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool io_read(int fd, void *buf, size_t len) {
+    uint8_t *p = (uint8_t *)buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool frame_send(int fd, uint8_t type, const void *buf, size_t len) {
+    uint8_t hdr[SIMD_HEADER_SIZE];
+    hdr[0] = type;
+    put_le32(hdr + 1, (uint32_t)len);
+    return io_write(fd, hdr, sizeof(hdr)) && io_write(fd, buf, len);
+}
+
+// Reads one frame; the payload is malloc'd (NUL-terminated for paths and
+// messages) and owned by the caller.
+static bool frame_recv(int fd, uint8_t *type, uint8_t **buf, uint32_t *len) {
+    uint8_t hdr[SIMD_HEADER_SIZE];
+    if (!io_read(fd, hdr, sizeof(hdr))) return false;
+    uint32_t n = get_le32(hdr + 1);
+    if (n > SIMD_FRAME_MAX) return false;
+    uint8_t *p = (uint8_t *)malloc((size_t)n + 1);
+    if (!p) return false;
+    if (!io_read(fd, p, n)) {
+        free(p);
+        return false;
+    }
+    p[n] = 0;
+    *type = hdr[0];
+    *buf = p;
+    *len = n;
+    return true;
+}
+
+// ---------------------------------------------------------------- server
+
+typedef struct {
+    int fd;
+    uint8_t *image;
+    size_t image_len;
+    uint8_t *in;
+    size_t in_len;
+    size_t in_pos;
+    uint64_t max_steps;
+    unsigned stats;
+    bool lost; // client gone: stop at the end of the slice
+    uint8_t out[2][SIMD_OUT_BUF];
+    size_t out_len[2];
+} Job;
+
+// One pooled instance and the image it holds. A slot whose `image` matches
+// a job's (hash, then bytes) only needs mina_sim_reset.
+typedef struct {
+    MinaSim *sim;
+    uint64_t hash;
+    uint8_t *image;
+    size_t image_len;
+    bool busy;
+    uint64_t used;
+} Slot;
+
+static struct {
+    Slot *slots;
+    unsigned count;
+    uint64_t tick;
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+} pool = { .lock = PTHREAD_MUTEX_INITIALIZER, .idle = PTHREAD_COND_INITIALIZER };
+
+static volatile sig_atomic_t stopping;
+
+static void on_stop(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+// FNV-1a over the image bytes.
+static uint64_t image_hash(const uint8_t *p, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// An idle slot already holding the image, else the least recently used
+// idle slot; waits while every instance is busy.
+static Slot *pool_acquire(uint64_t hash, const uint8_t *image, size_t len, bool *cached) {
+    pthread_mutex_lock(&pool.lock);
+    Slot *pick = NULL;
+    for (;;) {
+        Slot *lru = NULL;
+        for (unsigned i = 0; i < pool.count; i++) {
+            Slot *s = &pool.slots[i];
+            if (s->busy) continue;
+            if (s->image && s->hash == hash && s->image_len == len && memcmp(s->image, image, len) == 0) {
+                pick = s;
+                break;
+            }
+            if (!lru || s->used < lru->used) lru = s;
+        }
+        *cached = pick != NULL;
+        if (!pick) pick = lru;
+        if (pick) break;
+        pthread_cond_wait(&pool.idle, &pool.lock);
+    }
+    pick->busy = true;
+    pthread_mutex_unlock(&pool.lock);
+    return pick;
+}
+
+static void pool_release(Slot *s) {
+    pthread_mutex_lock(&pool.lock);
+    s->busy = false;
+    s->used = ++pool.tick;
+    pthread_cond_signal(&pool.idle);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static void job_flush(Job *j, int which) {
+    if (j->out_len[which] == 0) return;
+    if (!j->lost && !frame_send(j->fd, which ? SIMD_STDERR : SIMD_STDOUT, j->out[which], j->out_len[which])) {
+        j->lost = true;
+    }
+    j->out_len[which] = 0;
+}
+
+static void job_write(void *user, int fd, const uint8_t *buf, size_t len) {
+    Job *j = (Job *)user;
+    int which = (fd == 2) ? 1 : 0;
+    if (j->out_len[which] + len > SIMD_OUT_BUF) job_flush(j, which);
+    if (len > SIMD_OUT_BUF) {
+        if (!j->lost && !frame_send(j->fd, which ? SIMD_STDERR : SIMD_STDOUT, buf, len)) j->lost = true;
+        return;
+    }
+    memcpy(j->out[which] + j->out_len[which], buf, len);
+    j->out_len[which] += len;
+}
+
+// The whole of stdin arrived with the job, so "nothing now" is EOF.
+static size_t job_read(void *user, uint8_t *buf, size_t len) {
+    Job *j = (Job *)user;
+    size_t n = j->in_len - j->in_pos;
+    if (n > len) n = len;
+    if (n) memcpy(buf, j->in + j->in_pos, n);
+    j->in_pos += n;
+    return n;
+}
+
+static void job_fail(Job *j, const char *msg) {
+    frame_send(j->fd, SIMD_FAIL, msg, strlen(msg));
+}
+
+// Sends the --stats text (as stderr) or JSON captured from the instance.
+static void job_stats(Job *j, MinaSim *sim, bool json, double seconds) {
+    char *text = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&text, &len);
+    if (!f) return;
+    bool ok = mina_sim_write_stats(sim, f, json, seconds);
+    if (fclose(f) == 0 && ok && !j->lost) {
+        if (json) {
+            if (!frame_send(j->fd, SIMD_JSON, text, len)) j->lost = true;
+        } else {
+            job_write(j, 2, (const uint8_t *)text, len);
+            job_flush(j, 1);
+        }
+    }
+    free(text);
+}
+
+static bool is_elf(const uint8_t *p, size_t len) {
+    return len >= 4 && p[0] == 0x7F && p[1] == 'E' && p[2] == 'L' && p[3] == 'F';
+}
+
+static void job_run(Job *j) {
+    uint64_t hash = image_hash(j->image, j->image_len);
+    bool cached = false;
+    Slot *slot = pool_acquire(hash, j->image, j->image_len, &cached);
+    MinaSim *sim = slot->sim;
+    bool ready;
+    if (cached) {
+        ready = mina_sim_reset(sim);
+    } else {
+        ready = is_elf(j->image, j->image_len) ? mina_sim_load_elf(sim, j->image, j->image_len)
+                                               : mina_sim_load_raw(sim, j->image, j->image_len, 0);
+        free(slot->image);
+        slot->image = NULL;
+        if (ready) {
+            slot->image = j->image;
+            slot->image_len = j->image_len;
+            slot->hash = hash;
+            j->image = NULL;
+        }
+    }
+    if (!ready) {
+        pool_release(slot);
+        job_fail(j, "failed to load image");
+        return;
+    }
+
+    mina_sim_set_console(sim, job_write, job_read, j);
+    mina_sim_set_stats(sim, j->stats != 0);
+    double run_start = stats_now();
+    uint64_t left = j->max_steps;
+    MinaSimStatus st = MINA_SIM_BUDGET;
+    while (left > 0 && !j->lost) {
+        // A BUDGET result used the whole slice (trapping instructions
+        // count against it without retiring, as in mina-sim).
+        uint64_t slice = left < SIMD_SLICE ? left : SIMD_SLICE;
+        st = mina_sim_run(sim, slice);
+        left -= slice;
+        job_flush(j, 0);
+        job_flush(j, 1);
+        if (st != MINA_SIM_BUDGET) break;
+    }
+    double run_time = stats_now() - run_start;
+    if (j->stats & SIMD_STATS_TEXT) job_stats(j, sim, false, run_time);
+    if (j->stats & SIMD_STATS_JSON) job_stats(j, sim, true, run_time);
+
+    uint8_t done[SIMD_DONE_SIZE];
+    put_le32(done + 0, (uint32_t)st);
+    put_le32(done + 4, (uint32_t)mina_sim_trap(sim));
+    put_le64(done + 8, mina_sim_steps(sim));
+    put_le64(done + 16, mina_sim_get_pc(sim));
+    put_le32(done + 24, cached ? 1 : 0);
+    mina_sim_set_console(sim, NULL, NULL, NULL);
+    pool_release(slot);
+    if (!j->lost) frame_send(j->fd, SIMD_DONE, done, sizeof(done));
+}
+
+// Collects one job's frames up to RUN; false (after a FAIL) on a bad job.
+static bool job_read_request(Job *j) {
+    for (;;) {
+        uint8_t type;
+        uint8_t *buf;
+        uint32_t len;
+        if (!frame_recv(j->fd, &type, &buf, &len)) return false;
+        switch (type) {
+            case SIMD_IMAGE:
+                free(j->image);
+                j->image = buf;
+                j->image_len = len;
+                continue;
+            case SIMD_PATH:
+                free(j->image);
+                j->image = load_file((const char *)buf, &j->image_len);
+                free(buf);
+                if (!j->image) {
+                    job_fail(j, "cannot read image path");
+                    return false;
+                }
+                continue;
+            case SIMD_STDIN: {
+                uint8_t *in = NULL;
+                if (j->in_len + len <= SIMD_FRAME_MAX) in = (uint8_t *)realloc(j->in, j->in_len + len + 1);
+                if (!in) {
+                    free(buf);
+                    job_fail(j, "stdin too large");
+                    return false;
+                }
+                memcpy(in + j->in_len, buf, len);
+                j->in = in;
+                j->in_len += len;
+                free(buf);
+                continue;
+            }
+            case SIMD_LIMIT:
+                if (len == 8) j->max_steps = get_le64(buf);
+                free(buf);
+                continue;
+            case SIMD_STATS:
+                if (len == 1) j->stats = buf[0] & (SIMD_STATS_TEXT | SIMD_STATS_JSON);
+                free(buf);
+                continue;
+            case SIMD_RUN:
+                free(buf);
+                if (!j->image) {
+                    job_fail(j, "no image");
+                    return false;
+                }
+                return true;
+            default:
+                free(buf);
+                job_fail(j, "unknown request");
+                return false;
+        }
+    }
+}
+
+static void *serve(void *arg) {
+    Job *j = (Job *)arg;
+    if (job_read_request(j)) job_run(j);
+    close(j->fd);
+    free(j->image);
+    free(j->in);
+    free(j);
+    return NULL;
+}
+
+static int server_main(int argc, char **argv) {
+    const char *path = NULL;
+    unsigned count = SIMD_DEFAULT_POOL;
+    size_t mem_size = 64ull * 1024 * 1024;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            count = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            mem_size = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    path = socket_path(path);
+    if (count == 0) count = 1;
+
+    struct sockaddr_un sa;
+    if (!sun_path(&sa, path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return 1;
+    }
+    pool.slots = (Slot *)calloc(count, sizeof(Slot));
+    if (!pool.slots) return 1;
+    for (unsigned i = 0; i < count; i++) {
+        pool.slots[i].sim = mina_sim_create(mem_size);
+        if (!pool.slots[i].sim) {
+            fprintf(stderr, "failed to create simulator instance %u\n", i);
+            return 1;
+        }
+        pool.count++;
+    }
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(lfd, 64) != 0) {
+        fprintf(stderr, "cannot listen on %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // No SA_RESTART: accept() returns EINTR and the loop sees `stopping`.
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = on_stop;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    // Job threads inherit a mask without the stop signals, so they always
+    // land on the accepting thread.
+    sigset_t stop_set, old_set;
+    sigemptyset(&stop_set);
+    sigaddset(&stop_set, SIGINT);
+    sigaddset(&stop_set, SIGTERM);
+
+    fprintf(stderr, "mina-simd: listening on %s (%u instances)\n", path, count);
+    while (!stopping) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "accept: %s\n", strerror(errno));
+            break;
+        }
+        Job *j = (Job *)calloc(1, sizeof(*j));
+        if (!j) {
+            close(fd);
+            continue;
+        }
+        j->fd = fd;
+        j->max_steps = SIMD_DEFAULT_STEPS;
+        pthread_t t;
+        pthread_sigmask(SIG_BLOCK, &stop_set, &old_set);
+        int rc = pthread_create(&t, NULL, serve, j);
+        pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+        if (rc != 0) {
+            close(fd);
+            free(j);
+            continue;
+        }
+        pthread_detach(t);
+    }
+    close(lfd);
+    unlink(path);
+    return 0;
+}
+
+// ---------------------------------------------------------------- client
+
+static bool send_stdin(int fd) {
+    uint8_t buf[65536];
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) return true;
+        if (!frame_send(fd, SIMD_STDIN, buf, (size_t)n)) return false;
+    }
+}
+
+static int client_main(int argc, char **argv) {
+    const char *path = NULL;
+    uint64_t max_steps = SIMD_DEFAULT_STEPS;
+    bool no_stdin = false;
+    bool verbose = false;
+    bool by_path = false;
+    uint8_t stats = 0;
+    const char *stats_json = NULL;
+    int i = 2;
+    while (i < argc && argv[i][0] == '-') {
+        if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            max_steps = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            no_stdin = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--path") == 0) {
+            by_path = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats |= SIMD_STATS_TEXT;
+        } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+            stats |= SIMD_STATS_JSON;
+            stats_json = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (i + 1 != argc) { usage(argv[0]); return 1; }
+    const char *bin_path = argv[i];
+    path = socket_path(path);
+
+    struct sockaddr_un sa;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !sun_path(&sa, path) || connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        fprintf(stderr, "cannot connect to mina-simd at %s\n", path);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    bool ok;
+    if (by_path) {
+        char real[PATH_MAX];
+        ok = realpath(bin_path, real) && frame_send(fd, SIMD_PATH, real, strlen(real));
+    } else {
+        size_t len = 0;
+        uint8_t *image = load_file(bin_path, &len);
+        if (!image) {
+            fprintf(stderr, "failed to load binary: %s\n", bin_path);
+            close(fd);
+            return 1;
+        }
+        ok = frame_send(fd, SIMD_IMAGE, image, len);
+        free(image);
+    }
+    uint8_t limit[8];
+    put_le64(limit, max_steps);
+    ok = ok && frame_send(fd, SIMD_LIMIT, limit, sizeof(limit)) && frame_send(fd, SIMD_STATS, &stats, 1);
+    if (ok && !no_stdin && !isatty(STDIN_FILENO)) ok = send_stdin(fd);
+    ok = ok && frame_send(fd, SIMD_RUN, NULL, 0);
+    if (!ok) {
+        fprintf(stderr, "failed to send job to mina-simd\n");
+        close(fd);
+        return 1;
+    }
+
+    double start = stats_now();
+    for (;;) {
+        uint8_t type;
+        uint8_t *buf;
+        uint32_t len;
+        if (!frame_recv(fd, &type, &buf, &len)) {
+            fprintf(stderr, "mina-simd closed the connection\n");
+            close(fd);
+            return 1;
+        }
+        if (type == SIMD_STDOUT || type == SIMD_STDERR) {
+            FILE *f = (type == SIMD_STDOUT) ? stdout : stderr;
+            fwrite(buf, 1, len, f);
+            fflush(f);
+        } else if (type == SIMD_JSON) {
+            FILE *f = fopen(stats_json, "w");
+            if (!f || fwrite(buf, 1, len, f) != len || fclose(f) != 0) {
+                fprintf(stderr, "failed to write stats: %s\n", stats_json);
+            }
+        } else if (type == SIMD_FAIL) {
+            fprintf(stderr, "mina-simd: %s\n", (const char *)buf);
+            free(buf);
+            close(fd);
+            return 1;
+        } else if (type == SIMD_DONE && len == SIMD_DONE_SIZE) {
+            MinaSimStatus st = (MinaSimStatus)get_le32(buf);
+            int trap = (int)get_le32(buf + 4);
+            unsigned long long steps = (unsigned long long)get_le64(buf + 8);
+            unsigned long long pc = (unsigned long long)get_le64(buf + 16);
+            bool cached = get_le32(buf + 24) != 0;
+            free(buf);
+            close(fd);
+            if (verbose) {
+                fprintf(stderr, "mina-simd: image %s, %.3f ms\n", cached ? "cached" : "loaded",
+                        (stats_now() - start) * 1e3);
+            }
+            if (st == MINA_SIM_HALTED) {
+                fprintf(stderr, "halted on ebreak after %llu steps at pc=0x%llx\n", steps, pc);
+                return 0;
+            }
+            if (st == MINA_SIM_TRAP) {
+                fprintf(stderr, "trap after %llu steps at pc=0x%llx: %d\n", steps, pc, trap);
+                return 2;
+            }
+            fprintf(stderr, "halted after reaching step limit (%llu)\n", (unsigned long long)max_steps);
+            return 0;
+        }
+        free(buf);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "run") == 0) return client_main(argc, argv);
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        usage(argv[0]);
+        return 0;
+    }
+    return server_main(argc, argv);
+}
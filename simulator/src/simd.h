@@ -0,0 +1,49 @@
+#ifndef MINA_SIMD_H
+#define MINA_SIMD_H
+
+// mina-simd: a resident simulator serving jobs over a Unix stream socket.
+// It keeps a pool of booted libminasim instances. Each remembers the
+// image it last loaded (by content hash), so a job for the same ELF only
+// resets the pages the previous run dirtied instead of allocating RAM,
+// parsing and loading again.
+//
+// The protocol is a sequence of frames in both directions:
+//   uint8 type; uint32 len; uint8 payload[len];     (little-endian)
+// A client sends one job and reads frames until DONE or FAIL:
+//   IMAGE  ELF (or raw binary) bytes       -- or --
+//   PATH   path of the image on the server's filesystem
+//   STDIN  console input, any number of frames, concatenated
+//   LIMIT  uint64 max steps (default SIMD_DEFAULT_STEPS)
+//   STATS  uint8 SIMD_STATS_* flags
+//   RUN    (empty) start the job
+// The server answers with
+//   STDOUT / STDERR  console output as the guest produces it
+//   JSON   --stats-json counters, when requested
+//   DONE   uint32 status (MinaSimStatus), int32 trap, uint64 steps,
+//          uint64 pc, uint32 cached (1 when no load was needed)
+//   FAIL   error message
+// Text statistics arrive on STDERR ahead of DONE. A connection carries
+// one job; the server closes it after DONE or FAIL.
+
+#define SIMD_IMAGE  'E'
+#define SIMD_PATH   'P'
+#define SIMD_STDIN  'I'
+#define SIMD_LIMIT  'L'
+#define SIMD_STATS  'Q'
+#define SIMD_RUN    'G'
+#define SIMD_STDOUT 'O'
+#define SIMD_STDERR 'R'
+#define SIMD_JSON   'J'
+#define SIMD_DONE   'D'
+#define SIMD_FAIL   'F'
+
+#define SIMD_STATS_TEXT 0x1u
+#define SIMD_STATS_JSON 0x2u
+
+#define SIMD_HEADER_SIZE 5u
+#define SIMD_DONE_SIZE 28u
+#define SIMD_FRAME_MAX (64u << 20)
+#define SIMD_DEFAULT_STEPS 1000000ull
+#define SIMD_DEFAULT_SOCKET "/tmp/mina-simd.sock"
+
+#endif
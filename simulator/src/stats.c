@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+#include "stats.h"
+#include "isa.h"
+#include <time.h>
+
+typedef struct {
+    uint32_t opcode;
+    const char *name;
+} OpGroup;
+
+static const OpGroup groups[] = {
+    { OP_OP, "OP" },
+    { OP_OPIMM, "OP-IMM" },
+    { OP_LOAD, "LOAD" },
+    { OP_STORE, "STORE" },
+    { OP_BRANCH, "BRANCH" },
+    { OP_JAL, "JAL" },
+    { OP_JALR, "JALR" },
+    { OP_MOVHI, "MOVHI" },
+    { OP_MOVPC, "MOVPC" },
+    { OP_SYSTEM, "SYSTEM" },
+    { OP_FENCE, "FENCE" },
+    { OP_AMO, "AMO" },
+    { OP_CAP, "CAP" },
+    { OP_TENSOR, "TENSOR" },
+};
+
+#define NGROUPS (sizeof(groups) / sizeof(groups[0]))
+
+static const char *fuse_names[FUSE_KINDS] = {"li", "cmp_branch", "ld_addi", "prologue"};
+
+static const char *memcall_names[MEMCALL_KINDS] = {"memcpy", "memset", "memcmp", "strlen"};
+
+static const char *tensor_names[8] = {
+    "tadd/tld", "tmma/tst", "tact", "tcvt", "tzero", "tred", "tscale", "tsave/trestore",
+};
+
+static const char *cause_names[STATS_CAUSES] = {
+    "fetch misaligned", "fetch fault", "illegal instruction", "breakpoint",
+    "load misaligned", "load fault", "store misaligned", "store fault",
+    "ecall U", "ecall S", "ecall M", "capability fault",
+    "fetch page fault", "load page fault", "cause 14", "store page fault",
+};
+
+static const char *irq_names[STATS_CAUSES] = {
+    "irq 0", "SSIP", "irq 2", "MSIP", "irq 4", "STIP", "irq 6", "MTIP",
+    "irq 8", "SEIP", "irq 10", "MEIP", "irq 12", "irq 13", "irq 14", "irq 15",
+};
+
+double stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Dispatches whose opcode is not a known group.
+static uint64_t other_ops(const CpuStats *s) {
+    uint64_t n = 0;
+    for (unsigned op = 0; op < 128; op++) n += s->ops[op];
+    for (size_t g = 0; g < NGROUPS; g++) n -= s->ops[groups[g].opcode];
+    return n;
+}
+
+static double mips(uint64_t steps, double seconds) {
+    return seconds > 0 ? (double)steps / seconds / 1e6 : 0.0;
+}
+
+void stats_print(FILE *f, const CpuStats *s, uint64_t steps, double seconds) {
+    fprintf(f, "stats: %llu instructions in %.3f s (%.1f MIPS)\n",
+            (unsigned long long)steps, seconds, mips(steps, seconds));
+    for (size_t g = 0; g < NGROUPS; g++) {
+        uint64_t n = s->ops[groups[g].opcode];
+        if (!n) continue;
+        fprintf(f, "  %-8s %12llu", groups[g].name, (unsigned long long)n);
+        if (groups[g].opcode == OP_BRANCH) {
+            fprintf(f, "  (taken %llu, not taken %llu)",
+                    (unsigned long long)s->branch_taken[1], (unsigned long long)s->branch_taken[0]);
+        }
+        fputc('\n', f);
+        if (groups[g].opcode == OP_TENSOR) {
+            for (unsigned k = 0; k < 8; k++) {
+                if (s->tensor[k]) fprintf(f, "    %-14s %6llu\n", tensor_names[k], (unsigned long long)s->tensor[k]);
+            }
+        }
+    }
+    uint64_t other = other_ops(s);
+    if (other) fprintf(f, "  %-8s %12llu\n", "other", (unsigned long long)other);
+    for (unsigned k = 0; k < FUSE_KINDS; k++) {
+        if (s->fused[k]) fprintf(f, "  fused %-14s %llu\n", fuse_names[k], (unsigned long long)s->fused[k]);
+    }
+    for (unsigned k = 0; k < MEMCALL_KINDS; k++) {
+        if (s->memcalls[k]) {
+            fprintf(f, "  host %-15s %llu calls, %llu bytes\n", memcall_names[k],
+                    (unsigned long long)s->memcalls[k], (unsigned long long)s->memcall_bytes[k]);
+        }
+    }
+    for (unsigned k = 0; k < STATS_CAUSES; k++) {
+        if (s->exceptions[k]) fprintf(f, "  trap %-2u %-20s %llu\n", k, cause_names[k], (unsigned long long)s->exceptions[k]);
+    }
+    for (unsigned k = 0; k < STATS_CAUSES; k++) {
+        if (s->interrupts[k]) fprintf(f, "  irq  %-2u %-20s %llu\n", k, irq_names[k], (unsigned long long)s->interrupts[k]);
+    }
+}
+
+static void json_causes(FILE *f, const uint64_t *v) {
+    bool first = true;
+    fputc('{', f);
+    for (unsigned k = 0; k < STATS_CAUSES; k++) {
+        if (!v[k]) continue;
+        fprintf(f, "%s\"%u\": %llu", first ? "" : ", ", k, (unsigned long long)v[k]);
+        first = false;
+    }
+    fputc('}', f);
+}
+
+bool stats_json(FILE *f, const CpuStats *s, uint64_t steps, double seconds) {
+    fprintf(f, "{\n  \"instructions\": %llu,\n  \"seconds\": %.6f,\n  \"mips\": %.3f,\n  \"ops\": {",
+            (unsigned long long)steps, seconds, mips(steps, seconds));
+    for (size_t g = 0; g < NGROUPS; g++) {
+        fprintf(f, "%s\"%s\": %llu", g ? ", " : "", groups[g].name, (unsigned long long)s->ops[groups[g].opcode]);
+    }
+    fprintf(f, ", \"other\": %llu},\n", (unsigned long long)other_ops(s));
+    fprintf(f, "  \"branch\": {\"taken\": %llu, \"not_taken\": %llu},\n",
+            (unsigned long long)s->branch_taken[1], (unsigned long long)s->branch_taken[0]);
+    fprintf(f, "  \"tensor_funct3\": [");
+    for (unsigned k = 0; k < 8; k++) fprintf(f, "%s%llu", k ? ", " : "", (unsigned long long)s->tensor[k]);
+    fprintf(f, "],\n  \"fused\": {");
+    for (unsigned k = 0; k < FUSE_KINDS; k++) {
+        fprintf(f, "%s\"%s\": %llu", k ? ", " : "", fuse_names[k], (unsigned long long)s->fused[k]);
+    }
+    fprintf(f, "},\n  \"memcalls\": {");
+    for (unsigned k = 0; k < MEMCALL_KINDS; k++) {
+        fprintf(f, "%s\"%s\": {\"calls\": %llu, \"bytes\": %llu}", k ? ", " : "", memcall_names[k],
+                (unsigned long long)s->memcalls[k], (unsigned long long)s->memcall_bytes[k]);
+    }
+    fprintf(f, "},\n  \"exceptions\": ");
+    json_causes(f, s->exceptions);
+    fprintf(f, ",\n  \"interrupts\": ");
+    json_causes(f, s->interrupts);
+    fprintf(f, "\n}\n");
+    return !ferror(f);
+}
+
+bool stats_write_json(const char *path, const CpuStats *s, uint64_t steps, double seconds) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    bool ok = stats_json(f, s, steps, seconds);
+    return (fclose(f) == 0) && ok;
+}
@@ -0,0 +1,54 @@
+#ifndef MINA_STATS_H
+#define MINA_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Execution statistics for --stats. cpu_step bumps one array slot per
+// dispatched instruction (indexed by the 7-bit opcode) plus a slot for
+// branch direction or TENSOR funct3, and trap_entry one per trap by
+// cause. Instructions that trap during execution are still counted under
+// their opcode. A fused pair counts both instructions under their
+// opcodes and once more in `fused`. A memory syscall counts as its ecall
+// and once in `memcalls`, with the bytes it touched.
+
+#define STATS_CAUSES 16
+
+// Instruction pairs cpu_run executes as one superinstruction.
+enum {
+    FUSE_LI,         // movhi rd + addi rd, rd, lo
+    FUSE_CMP_BRANCH, // slt/sltu rd + beq/bne on rd
+    FUSE_LD_ADDI,    // ld + addi (pointer bump in a loop body)
+    FUSE_PROLOGUE,   // addi sp, sp, -N + st ra, off(sp)
+    FUSE_KINDS
+};
+
+// Memory syscalls run on the host (SYS_memcpy + kind).
+enum {
+    MEMCALL_MEMCPY,
+    MEMCALL_MEMSET,
+    MEMCALL_MEMCMP,
+    MEMCALL_STRLEN,
+    MEMCALL_KINDS
+};
+
+typedef struct CpuStats {
+    uint64_t ops[128];
+    uint64_t branch_taken[2]; // [0] not taken, [1] taken
+    uint64_t tensor[8];       // by funct3
+    uint64_t exceptions[STATS_CAUSES];
+    uint64_t interrupts[STATS_CAUSES];
+    uint64_t fused[FUSE_KINDS];
+    uint64_t memcalls[MEMCALL_KINDS];
+    uint64_t memcall_bytes[MEMCALL_KINDS];
+} CpuStats;
+
+// Monotonic host time in seconds, for the MIPS figure.
+double stats_now(void);
+
+void stats_print(FILE *f, const CpuStats *s, uint64_t steps, double seconds);
+bool stats_json(FILE *f, const CpuStats *s, uint64_t steps, double seconds);
+bool stats_write_json(const char *path, const CpuStats *s, uint64_t steps, double seconds);
+
+#endif
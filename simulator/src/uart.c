@@ -0,0 +1,321 @@
+#include "uart.h"
+#include "replay.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+// stdin is a process-wide resource, so there is one RX ring per process.
+// head is written only by the reader thread, tail only by the hart. The
+// hart never reads head/eof directly: rx_observe samples them into
+// seen/seen_eof at well-defined queries, which is what --record logs and
+// --replay reproduces.
+static struct {
+    uint8_t buf[UART_RX_SIZE];
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_bool eof;
+    atomic_bool producer_waiting;
+    uint32_t seen;
+    bool seen_eof;
+    bool started;
+    bool threaded;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} rx = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+void uart_tx(Cpu *c, uint64_t val, size_t size) {
+    if (c->host.console_write) {
+        uint8_t buf[8];
+        for (size_t i = 0; i < size; i++) buf[i] = (uint8_t)(val >> (8 * i));
+        c->host.console_write(c->host.ctx, 1, buf, size);
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        uint8_t ch = (uint8_t)((val >> (8 * i)) & 0xFF);
+        fputc((int)ch, stdout);
+    }
+    fflush(stdout);
+}
+
+// Bytes the guest has been shown but not consumed.
+static inline uint32_t rx_count(void) {
+    return rx.seen - atomic_load_explicit(&rx.tail, memory_order_relaxed);
+}
+
+// Bytes the host has delivered, seen or not.
+static inline uint32_t rx_host_count(void) {
+    return atomic_load_explicit(&rx.head, memory_order_acquire) -
+           atomic_load_explicit(&rx.tail, memory_order_relaxed);
+}
+
+static inline bool rx_replaying(const Cpu *c) {
+    return c->replay && c->replay->mode == REPLAY_PLAY;
+}
+
+static void *rx_thread(void *arg) {
+    (void)arg;
+    for (;;) {
+        uint32_t head = atomic_load_explicit(&rx.head, memory_order_relaxed);
+        uint32_t space = UART_RX_SIZE - (head - atomic_load(&rx.tail));
+        if (space == 0) {
+            pthread_mutex_lock(&rx.lock);
+            atomic_store(&rx.producer_waiting, true);
+            while (head - atomic_load(&rx.tail) == UART_RX_SIZE) pthread_cond_wait(&rx.cond, &rx.lock);
+            atomic_store(&rx.producer_waiting, false);
+            pthread_mutex_unlock(&rx.lock);
+            continue;
+        }
+        uint32_t idx = head % UART_RX_SIZE;
+        uint32_t chunk = UART_RX_SIZE - idx;
+        if (chunk > space) chunk = space;
+        ssize_t n = read(STDIN_FILENO, &rx.buf[idx], chunk);
+        if (n < 0 && errno == EINTR) continue;
+        pthread_mutex_lock(&rx.lock);
+        if (n > 0) atomic_store_explicit(&rx.head, head + (uint32_t)n, memory_order_release);
+        else atomic_store(&rx.eof, true);
+        pthread_cond_broadcast(&rx.cond);
+        pthread_mutex_unlock(&rx.lock);
+        if (n <= 0) return NULL;
+    }
+}
+
+static void rx_start(void) {
+    rx.started = true;
+    rx.threaded = pthread_create(&rx.thread, NULL, rx_thread, NULL) == 0;
+    if (rx.threaded) pthread_detach(rx.thread);
+}
+
+// Fallback when no reader thread is available: non-blocking poll.
+static void rx_fill_sync(bool block) {
+    uint32_t head = atomic_load(&rx.head);
+    uint32_t space = UART_RX_SIZE - (head - atomic_load(&rx.tail));
+    if (space == 0 || atomic_load(&rx.eof)) return;
+    if (!block) {
+        fd_set rfds;
+        struct timeval tv;
+        FD_ZERO(&rfds);
+        FD_SET(STDIN_FILENO, &rfds);
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        int r = select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv);
+        if (r <= 0 || !FD_ISSET(STDIN_FILENO, &rfds)) return;
+    }
+    uint32_t idx = head % UART_RX_SIZE;
+    uint32_t chunk = UART_RX_SIZE - idx;
+    if (chunk > space) chunk = space;
+    ssize_t n = read(STDIN_FILENO, &rx.buf[idx], chunk);
+    if (n > 0) atomic_store(&rx.head, head + (uint32_t)n);
+    else if (n == 0 || errno != EINTR) atomic_store(&rx.eof, true);
+}
+
+bool uart_rx_started(void) {
+    return rx.started;
+}
+
+// Replay: the ring is filled from the log only, at the query the bytes
+// were first seen at while recording.
+static void rx_inject(Cpu *c) {
+    uint32_t q = replay_query(c->replay, c->steps);
+    const uint8_t *data;
+    size_t len;
+    bool eof;
+    if (!replay_take(c->replay, c->steps, q, &data, &len, &eof)) return;
+    uint32_t head = atomic_load(&rx.head);
+    if (len > UART_RX_SIZE - (head - atomic_load(&rx.tail))) {
+        replay_diverged(c->replay, c->steps);
+        len = 0;
+        eof = true;
+    }
+    for (size_t i = 0; i < len; i++) rx.buf[(head + (uint32_t)i) % UART_RX_SIZE] = data[i];
+    atomic_store(&rx.head, head + (uint32_t)len);
+    rx.seen = head + (uint32_t)len;
+    if (eof) {
+        atomic_store(&rx.eof, true);
+        rx.seen_eof = true;
+    }
+}
+
+// One guest query of the RX state. eof is read before head: the reader
+// thread stores its last head before it sets eof.
+static void rx_observe(Cpu *c) {
+    if (rx_replaying(c)) {
+        rx_inject(c);
+        return;
+    }
+    bool eof = atomic_load(&rx.eof);
+    uint32_t head = atomic_load_explicit(&rx.head, memory_order_acquire);
+    if (c->replay) {
+        uint32_t q = replay_query(c->replay, c->steps);
+        if (head != rx.seen || eof != rx.seen_eof) {
+            uint8_t data[UART_RX_SIZE];
+            uint32_t len = head - rx.seen;
+            for (uint32_t i = 0; i < len; i++) data[i] = rx.buf[(rx.seen + i) % UART_RX_SIZE];
+            replay_write(c->replay, c->steps, q, data, len, eof);
+        }
+    }
+    rx.seen = head;
+    rx.seen_eof = eof;
+}
+
+// Host console input (CpuHost.console_read) never blocks; one byte of
+// lookahead lets STATUS report "ready" without consuming input.
+static bool host_rx_ready(Cpu *c) {
+    if (c->rx_peek < 0) {
+        uint8_t b;
+        if (c->host.console_read(c->host.ctx, &b, 1) == 1) c->rx_peek = b;
+    }
+    return c->rx_peek >= 0;
+}
+
+bool uart_rx_ready(Cpu *c) {
+    if (c->host.console_read) return host_rx_ready(c);
+    if (!rx_replaying(c)) {
+        if (!rx.started) rx_start();
+        if (!rx.threaded && rx_host_count() == 0) rx_fill_sync(false);
+    }
+    rx_observe(c);
+    return rx_count() > 0;
+}
+
+// Block until input is available or stdin reaches EOF. Exactly one query
+// precedes and one follows the host wait, however often it wakes up.
+static bool rx_wait(Cpu *c) {
+    bool replaying = rx_replaying(c);
+    if (!replaying && !rx.started) rx_start();
+    rx_observe(c);
+    if (rx_count() > 0 || rx.seen_eof) return rx_count() > 0;
+    if (replaying) {
+        // Nothing to wait for: the recording has the input right here.
+    } else if (!rx.threaded) {
+        while (rx_host_count() == 0 && !atomic_load(&rx.eof)) rx_fill_sync(true);
+    } else {
+        pthread_mutex_lock(&rx.lock);
+        while (rx_host_count() == 0 && !atomic_load(&rx.eof)) pthread_cond_wait(&rx.cond, &rx.lock);
+        pthread_mutex_unlock(&rx.lock);
+    }
+    rx_observe(c);
+    if (replaying && rx_count() == 0 && !rx.seen_eof) {
+        replay_diverged(c->replay, c->steps);
+        rx.seen_eof = true;
+    }
+    return rx_count() > 0;
+}
+
+static void rx_consumed(uint32_t n) {
+    atomic_fetch_add(&rx.tail, n);
+    if (atomic_load(&rx.producer_waiting)) {
+        pthread_mutex_lock(&rx.lock);
+        pthread_cond_broadcast(&rx.cond);
+        pthread_mutex_unlock(&rx.lock);
+    }
+}
+
+bool uart_rx_pop(Cpu *c, uint8_t *out) {
+    if (!uart_rx_ready(c)) return false;
+    if (c->host.console_read) {
+        *out = (uint8_t)c->rx_peek;
+        c->rx_peek = -1;
+        return true;
+    }
+    *out = rx.buf[atomic_load_explicit(&rx.tail, memory_order_relaxed) % UART_RX_SIZE];
+    rx_consumed(1);
+    return true;
+}
+
+size_t uart_rx_read(Cpu *c, uint8_t *dst, size_t len) {
+    if (len == 0) return 0;
+    if (c->host.console_read) {
+        size_t n = 0;
+        if (c->rx_peek >= 0) {
+            dst[n++] = (uint8_t)c->rx_peek;
+            c->rx_peek = -1;
+        }
+        if (n < len) n += c->host.console_read(c->host.ctx, dst + n, len - n);
+        return n;
+    }
+    if (!rx_wait(c)) return 0;
+    uint32_t avail = rx_count();
+    size_t n = (len < avail) ? len : avail;
+    uint32_t tail = atomic_load_explicit(&rx.tail, memory_order_relaxed);
+    for (size_t i = 0; i < n; i++) dst[i] = rx.buf[(tail + (uint32_t)i) % UART_RX_SIZE];
+    rx_consumed((uint32_t)n);
+    return n;
+}
+
+// RX interrupt: mip.MEIP follows "RX data available" while CTRL.RXIE is
+// set. The reader thread never touches hart state; instead an event
+// samples the ring every UART_POLL_CYCLES cycles while RX is empty. Inside
+// wfi with nothing else scheduled, the event blocks on host input.
+static void uart_poll(void *ctx, uint64_t now);
+
+static void uart_irq_update(Cpu *c) {
+    event_cancel(&c->events, uart_poll, c);
+    if (!(c->uart_ctrl & UART_CTRL_RXIE)) {
+        cpu_clear_mip(c, MIP_MEIP);
+        return;
+    }
+    if (uart_rx_ready(c)) {
+        cpu_set_mip(c, MIP_MEIP);
+        return;
+    }
+    cpu_clear_mip(c, MIP_MEIP);
+    if (c->host.console_read || !rx.seen_eof) event_schedule(&c->events, c->cycle + UART_POLL_CYCLES, uart_poll, c);
+}
+
+static void uart_poll(void *ctx, uint64_t now) {
+    Cpu *c = (Cpu *)ctx;
+    if (c->in_wfi && !uart_rx_ready(c)) {
+        if (c->events.count > 0) {
+            // Input cannot arrive in zero host time; skip to the next event.
+            event_schedule(&c->events, c->events.next, uart_poll, c);
+            return;
+        }
+        // A host callback cannot be waited on: let wfi return instead of
+        // spinning on the poll event.
+        if (c->host.console_read) return;
+        rx_wait(c);
+    }
+    (void)now;
+    uart_irq_update(c);
+}
+
+bool uart_load(void *ctx, uint64_t addr, size_t size, uint64_t *out) {
+    Cpu *c = (Cpu *)ctx;
+    uint8_t b = 0;
+    (void)size;
+    switch (addr) {
+        case UART_RX_ADDR:
+            if (!uart_rx_pop(c, &b)) b = 0;
+            if (c->uart_ctrl & UART_CTRL_RXIE) uart_irq_update(c);
+            break;
+        case UART_STATUS_ADDR:
+            b = uart_rx_ready(c) ? 1 : 0;
+            break;
+        case UART_CTRL_ADDR:
+            b = (uint8_t)c->uart_ctrl;
+            break;
+        default:
+            return false;
+    }
+    *out = b;
+    return true;
+}
+
+bool uart_store(void *ctx, uint64_t addr, size_t size, uint64_t val) {
+    Cpu *c = (Cpu *)ctx;
+    switch (addr) {
+        case UART_TX_ADDR:
+            uart_tx(c, val, size);
+            return true;
+        case UART_CTRL_ADDR:
+            c->uart_ctrl = (uint32_t)val & UART_CTRL_RXIE;
+            uart_irq_update(c);
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef MINA_UART_H
+#define MINA_UART_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+
+// UART MMIO. RX is fed by a background thread that blocks in read() on
+// stdin and pushes into a single-producer/single-consumer ring, so STATUS
+// polls and RX loads are plain memory reads. When the thread cannot be
+// started (e.g. no pthreads) RX falls back to non-blocking select() polls.
+// Under --replay no stdin is read; the ring is filled from the log
+// (replay.h).
+
+#define UART_BASE        0x10000000ull
+#define UART_SIZE        0x10ull
+#define UART_TX_ADDR     0x10000000ull
+#define UART_RX_ADDR     0x10000004ull
+#define UART_STATUS_ADDR 0x10000008ull
+#define UART_CTRL_ADDR   0x1000000Cull
+
+#define UART_CTRL_RXIE   0x1u
+#define UART_RX_SIZE     4096u
+#define UART_POLL_CYCLES 4096u
+
+#define MIP_MEIP (1ull << 11)
+
+// Console I/O for the hart: the CpuHost callbacks when set, otherwise
+// stdout and the stdin ring.
+void uart_tx(Cpu *c, uint64_t val, size_t size);
+
+bool uart_rx_ready(Cpu *c);
+bool uart_rx_pop(Cpu *c, uint8_t *out);
+size_t uart_rx_read(Cpu *c, uint8_t *dst, size_t len);
+// True once anything has read stdin (the reader thread may be running).
+bool uart_rx_started(void);
+
+// MMIO callbacks (ctx is the Cpu). Loads return one byte; stores to TX
+// emit `size` bytes.
+bool uart_load(void *ctx, uint64_t addr, size_t size, uint64_t *out);
+bool uart_store(void *ctx, uint64_t addr, size_t size, uint64_t val);
+
+#endif
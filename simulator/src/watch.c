@@ -0,0 +1,101 @@
+#include "watch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool watch_add(Watch *w, const char *spec) {
+    if (w->count >= WATCH_MAX) return false;
+    Watchpoint p = { .len = 8, .access = MMU_W };
+    char *end;
+    p.addr = strtoull(spec, &end, 16);
+    if (end == spec) return false;
+    bool have_len = false, have_access = false;
+    while (*end == ':') {
+        const char *f = end + 1;
+        size_t n = strcspn(f, ":");
+        if (n == 3 && strncmp(f, "log", 3) == 0) {
+            p.log = true;
+        } else if (!have_access && n > 0 && strspn(f, "rw") == n) {
+            p.access = 0;
+            for (size_t i = 0; i < n; i++) p.access |= (f[i] == 'r') ? MMU_R : MMU_W;
+            have_access = true;
+        } else if (!have_len && !have_access) {
+            char *e;
+            p.len = strtoull(f, &e, 0);
+            if (e != f + n || p.len == 0) return false;
+            have_len = true;
+        } else {
+            return false;
+        }
+        end = (char *)f + n;
+    }
+    if (*end != '\0' || p.addr + p.len < p.addr) return false;
+    w->points[w->count++] = p;
+    return true;
+}
+
+bool watch_add_break(Watch *w, const char *spec) {
+    if (w->break_count >= WATCH_MAX) return false;
+    Breakpoint b = {0};
+    char *end;
+    b.pc = strtoull(spec, &end, 16);
+    if (end == spec) return false;
+    if (strcmp(end, ":log") == 0) b.log = true;
+    else if (*end != '\0') return false;
+    w->breaks[w->break_count++] = b;
+    return true;
+}
+
+bool watch_arm(const Watch *w, Mem *m) {
+    for (size_t i = 0; i < w->count; i++) {
+        const Watchpoint *p = &w->points[i];
+        if (p->addr + p->len > m->size) return false;
+        uint64_t last = (p->addr + p->len - 1) >> MEM_PAGE_SHIFT;
+        for (uint64_t pg = p->addr >> MEM_PAGE_SHIFT; pg <= last; pg++) {
+            if (m->page_map[pg] == MEM_REGION_RAM) m->page_map[pg] = MEM_REGION_WATCHED;
+        }
+    }
+    return true;
+}
+
+static uint64_t ram_value(const Mem *m, uint64_t pa, size_t size) {
+    uint64_t v = 0;
+    if (pa + size <= m->size) memcpy(&v, &m->data[pa], size);
+    return v;
+}
+
+bool watch_access(Cpu *c, Mem *m, uint64_t pa, size_t size, uint32_t access, uint64_t val) {
+    Watch *w = c->watch;
+    bool stop = false;
+    for (size_t i = 0; i < w->count; i++) {
+        const Watchpoint *p = &w->points[i];
+        if (!(p->access & access) || pa >= p->addr + p->len || pa + size <= p->addr) continue;
+        uint64_t old = ram_value(m, pa, size);
+        if (access == (MMU_R | MMU_W)) {
+            fprintf(stderr, "watch: pc=0x%llx step %llu amo %zu bytes at 0x%llx: 0x%llx, operand 0x%llx\n",
+                    (unsigned long long)c->pc, (unsigned long long)c->steps, size,
+                    (unsigned long long)pa, (unsigned long long)old, (unsigned long long)val);
+        } else if (access & MMU_W) {
+            fprintf(stderr, "watch: pc=0x%llx step %llu store %zu bytes at 0x%llx: 0x%llx -> 0x%llx\n",
+                    (unsigned long long)c->pc, (unsigned long long)c->steps, size,
+                    (unsigned long long)pa, (unsigned long long)old, (unsigned long long)val);
+        } else {
+            fprintf(stderr, "watch: pc=0x%llx step %llu load %zu bytes at 0x%llx: 0x%llx\n",
+                    (unsigned long long)c->pc, (unsigned long long)c->steps, size,
+                    (unsigned long long)pa, (unsigned long long)old);
+        }
+        if (!p->log) stop = true;
+        break;
+    }
+    return stop;
+}
+
+bool watch_break(Cpu *c) {
+    Watch *w = c->watch;
+    for (size_t i = 0; i < w->break_count; i++) {
+        if (w->breaks[i].pc != c->pc) continue;
+        fprintf(stderr, "break: pc=0x%llx step %llu\n", (unsigned long long)c->pc, (unsigned long long)c->steps);
+        return !w->breaks[i].log;
+    }
+    return false;
+}
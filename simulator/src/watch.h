@@ -0,0 +1,57 @@
+#ifndef MINA_WATCH_H
+#define MINA_WATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+
+// Memory watchpoints and PC breakpoints for --watch / --break.
+//
+// A watchpoint covers a physical address range. Arming it retags the RAM
+// pages it touches as MEM_REGION_WATCHED in the page map, so ordinary
+// loads and stores keep their single-compare RAM fast path and only
+// accesses to a watched page fall into the slow path that checks the
+// ranges here. Breakpoints are checked before each fetch, behind one
+// pointer test that is false when none are set.
+//
+// A hit is reported on stderr before the access or instruction executes.
+// Stop points make cpu_step return TRAP_WATCH with the PC still at the
+// instruction; log points let it run on. Scalar loads/stores and AMOs are
+// watched; device, DMA, tensor and syscall accesses are not.
+
+#define WATCH_MAX 16
+
+typedef struct {
+    uint64_t addr;
+    uint64_t len;
+    uint32_t access; // MMU_R and/or MMU_W
+    bool log;
+} Watchpoint;
+
+typedef struct {
+    uint64_t pc;
+    bool log;
+} Breakpoint;
+
+typedef struct Watch {
+    Watchpoint points[WATCH_MAX];
+    size_t count;
+    Breakpoint breaks[WATCH_MAX];
+    size_t break_count;
+} Watch;
+
+// ADDR[:LEN][:r|w|rw][:log], ADDR in hex, LEN 8 and access w by default.
+bool watch_add(Watch *w, const char *spec);
+// PC[:log], PC in hex.
+bool watch_add_break(Watch *w, const char *spec);
+// Retag the pages of every watchpoint; false if one lies outside RAM.
+bool watch_arm(const Watch *w, Mem *m);
+
+// An access of `size` bytes at pa (a watched page). True to stop.
+bool watch_access(Cpu *c, Mem *m, uint64_t pa, size_t size, uint32_t access, uint64_t val);
+// True to stop before executing the instruction at c->pc.
+bool watch_break(Cpu *c);
+
+#endif
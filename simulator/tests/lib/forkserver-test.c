@@ -0,0 +1,123 @@
+// Plays the fuzzer side of `mina-sim --forkserver` (AFL protocol on fds
+// 198/199, coverage in a SysV shared memory map) against
+// forkserver-test.s. Usage: forkserver-test mina-sim forkserver-test.elf
+
+#define _XOPEN_SOURCE 700
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/shm.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MAP_SIZE 65536
+#define FORKSRV_FD 198
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                   \
+        }                                                              \
+    } while (0)
+
+static int ctl_fd, st_fd, input_fd;
+static uint8_t *map;
+
+static int run_one(const char *input) {
+    size_t len = strlen(input);
+    CHECK(ftruncate(input_fd, 0) == 0);
+    CHECK(pwrite(input_fd, input, len, 0) == (ssize_t)len);
+    CHECK(lseek(input_fd, 0, SEEK_SET) == 0);
+    memset(map, 0, MAP_SIZE);
+    uint32_t v = 0;
+    CHECK(write(ctl_fd, &v, 4) == 4);
+    uint32_t pid, status;
+    CHECK(read(st_fd, &pid, 4) == 4 && pid > 0);
+    CHECK(read(st_fd, &status, 4) == 4);
+    return (int)status;
+}
+
+static size_t map_edges(void) {
+    size_t n = 0;
+    for (size_t i = 0; i < MAP_SIZE; i++) n += map[i] != 0;
+    return n;
+}
+
+int main(int argc, char **argv) {
+    CHECK(argc == 3);
+    int shm_id = shmget(IPC_PRIVATE, MAP_SIZE, IPC_CREAT | IPC_EXCL | 0600);
+    CHECK(shm_id >= 0);
+    map = (uint8_t *)shmat(shm_id, NULL, 0);
+    CHECK(map != (void *)-1);
+    char id[32];
+    snprintf(id, sizeof(id), "%d", shm_id);
+    setenv("__AFL_SHM_ID", id, 1);
+
+    char path[] = "/tmp/mina-fsrv-XXXXXX";
+    input_fd = mkstemp(path);
+    CHECK(input_fd >= 0);
+    unlink(path);
+
+    int ctl[2], st[2];
+    CHECK(pipe(ctl) == 0 && pipe(st) == 0);
+    pid_t server = fork();
+    CHECK(server >= 0);
+    if (server == 0) {
+        dup2(ctl[0], FORKSRV_FD);
+        dup2(st[1], FORKSRV_FD + 1);
+        dup2(input_fd, 0);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        close(ctl[0]); close(ctl[1]); close(st[0]); close(st[1]);
+        execl(argv[1], argv[1], "--forkserver", "--fork-pc", "40", argv[2], (char *)NULL);
+        _exit(127);
+    }
+    close(ctl[0]);
+    close(st[1]);
+    ctl_fd = ctl[1];
+    st_fd = st[0];
+
+    uint32_t hello;
+    CHECK(read(st_fd, &hello, 4) == 4);
+
+    int s = run_one("A");
+    CHECK(WIFEXITED(s) && WEXITSTATUS(s) == 7);
+    uint8_t *cov_a = (uint8_t *)malloc(MAP_SIZE);
+    memcpy(cov_a, map, MAP_SIZE);
+    CHECK(map_edges() > 0);
+
+    s = run_one("B");
+    CHECK(WIFEXITED(s) && WEXITSTATUS(s) == 0);
+    CHECK(memcmp(cov_a, map, MAP_SIZE) != 0);
+
+    s = run_one("C");
+    CHECK(WIFSIGNALED(s) && WTERMSIG(s) == SIGABRT);
+
+    // Deterministic: the same input reproduces the same map.
+    s = run_one("A");
+    CHECK(WIFEXITED(s) && WEXITSTATUS(s) == 7);
+    CHECK(memcmp(cov_a, map, MAP_SIZE) == 0);
+
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    const int runs = 500;
+    for (int i = 0; i < runs; i++) {
+        s = run_one("B");
+        CHECK(WIFEXITED(s) && WEXITSTATUS(s) == 0);
+    }
+    gettimeofday(&t1, NULL);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_usec - t0.tv_usec) / 1e6;
+
+    close(ctl_fd);
+    CHECK(waitpid(server, &s, 0) == server && WIFEXITED(s) && WEXITSTATUS(s) == 0);
+    shmdt(map);
+    shmctl(shm_id, IPC_RMID, NULL);
+    free(cov_a);
+    printf("forkserver-test: OK (%.0f execs/s)\n", secs > 0 ? runs / secs : 0.0);
+    return 0;
+}
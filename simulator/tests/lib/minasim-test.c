@@ -0,0 +1,152 @@
+// libminasim instance API: console/syscall callbacks, budgets, reset,
+// register/memory access, statistics and many instances in one process.
+// Usage: minasim-test hello.elf uart-echo.elf
+
+#include "minasim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                   \
+        }                                                              \
+    } while (0)
+
+typedef struct {
+    char out[256];
+    size_t out_len;
+    const char *in;
+} Console;
+
+static void console_write(void *user, int fd, const uint8_t *buf, size_t len) {
+    Console *con = (Console *)user;
+    (void)fd;
+    for (size_t i = 0; i < len && con->out_len + 1 < sizeof(con->out); i++) con->out[con->out_len++] = (char)buf[i];
+    con->out[con->out_len] = 0;
+}
+
+static size_t console_read(void *user, uint8_t *buf, size_t len) {
+    Console *con = (Console *)user;
+    size_t n = 0;
+    while (n < len && con->in && *con->in) buf[n++] = (uint8_t)*con->in++;
+    return n;
+}
+
+// Intercepts SYS_write: copies the guest buffer and reports its length.
+static MinaSyscallResult capture_write(void *user, MinaSim *sim, uint64_t nr) {
+    Console *con = (Console *)user;
+    if (nr != 1) return MINA_SYSCALL_DEFAULT;
+    uint64_t len = mina_sim_get_reg(sim, 12);
+    uint8_t buf[64];
+    if (len > sizeof(buf) || !mina_sim_read_mem(sim, mina_sim_get_reg(sim, 11), buf, (size_t)len)) return MINA_SYSCALL_HALT;
+    console_write(con, 1, buf, (size_t)len);
+    mina_sim_set_reg(sim, 10, len);
+    return MINA_SYSCALL_DONE;
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    CHECK(f);
+    CHECK(fseek(f, 0, SEEK_END) == 0);
+    long n = ftell(f);
+    CHECK(n > 0);
+    rewind(f);
+    uint8_t *buf = (uint8_t *)malloc((size_t)n);
+    CHECK(buf && fread(buf, 1, (size_t)n, f) == (size_t)n);
+    fclose(f);
+    *len = (size_t)n;
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    CHECK(argc == 3);
+    size_t hello_len, echo_len;
+    uint8_t *hello = read_file(argv[1], &hello_len);
+    uint8_t *echo = read_file(argv[2], &echo_len);
+
+    // Two independent instances with their own console.
+    Console a = {0}, b = {0};
+    MinaSim *sa = mina_sim_create(1 << 20);
+    MinaSim *sb = mina_sim_create(1 << 20);
+    CHECK(sa && sb);
+    CHECK(mina_sim_run(sa, 10) == MINA_SIM_ERROR);
+    CHECK(mina_sim_load_elf(sa, hello, hello_len));
+    CHECK(mina_sim_load_elf(sb, hello, hello_len));
+    mina_sim_set_console(sa, console_write, console_read, &a);
+    mina_sim_set_console(sb, console_write, console_read, &b);
+    CHECK(mina_sim_run(sa, 1000) == MINA_SIM_HALTED);
+    CHECK(strcmp(a.out, "Hello, world!\n") == 0);
+    CHECK(b.out_len == 0);
+
+    // Budget stops mid-program; the run resumes where it stopped.
+    CHECK(mina_sim_run(sb, 2) == MINA_SIM_BUDGET);
+    CHECK(mina_sim_steps(sb) == 2);
+    CHECK(mina_sim_run(sb, 1000) == MINA_SIM_HALTED);
+    CHECK(strcmp(b.out, "Hello, world!\n") == 0);
+
+    // Reset replays the image and keeps the callbacks.
+    uint32_t junk = 0xDEADBEEF;
+    CHECK(mina_sim_write_mem(sa, 0, &junk, sizeof(junk)));
+    CHECK(mina_sim_write_mem(sa, (1 << 20) - 4, &junk, sizeof(junk)));
+    CHECK(mina_sim_reset(sa));
+    CHECK(mina_sim_steps(sa) == 0 && mina_sim_get_pc(sa) == 0);
+    uint32_t word = 0;
+    CHECK(mina_sim_read_mem(sa, 0, &word, sizeof(word)) && word != junk);
+    CHECK(mina_sim_read_mem(sa, (1 << 20) - 4, &word, sizeof(word)) && word == 0);
+    a.out_len = 0;
+    CHECK(mina_sim_run(sa, 1000) == MINA_SIM_HALTED);
+    CHECK(strcmp(a.out, "Hello, world!\n") == 0);
+    CHECK(mina_sim_get_reg(sa, 10) == 14);
+    CHECK(!mina_sim_read_mem(sa, (1 << 20) - 2, &word, sizeof(word)));
+
+    // Syscall callback replaces the built-in write.
+    Console sys = {0};
+    a.out_len = 0;
+    a.out[0] = 0;
+    mina_sim_set_syscall(sa, capture_write, &sys);
+    CHECK(mina_sim_reset(sa));
+    CHECK(mina_sim_run(sa, 1000) == MINA_SIM_HALTED);
+    CHECK(strcmp(sys.out, "Hello, world!\n") == 0);
+    CHECK(a.out_len == 0);
+
+    // UART RX/TX through the console callbacks.
+    Console e = { .in = "Z" };
+    MinaSim *se = mina_sim_create(1 << 20);
+    CHECK(se && mina_sim_load_elf(se, echo, echo_len));
+    mina_sim_set_console(se, console_write, console_read, &e);
+    CHECK(mina_sim_run(se, 1000) == MINA_SIM_HALTED);
+    CHECK(strcmp(e.out, "Z") == 0);
+
+    // Statistics count from the reset and print as --stats-json would.
+    mina_sim_set_stats(se, true);
+    CHECK(mina_sim_reset(se));
+    e.in = "Z";
+    CHECK(mina_sim_run(se, 1000) == MINA_SIM_HALTED);
+    FILE *f = tmpfile();
+    CHECK(f && mina_sim_write_stats(se, f, true, 0.0));
+    char json[2048] = {0};
+    rewind(f);
+    CHECK(fread(json, 1, sizeof(json) - 1, f) > 0);
+    fclose(f);
+    CHECK(strstr(json, "\"instructions\": 7,") != NULL);
+
+    // Many short runs in one process.
+    mina_sim_set_syscall(sa, NULL, NULL);
+    for (int i = 0; i < 2000; i++) {
+        a.out_len = 0;
+        CHECK(mina_sim_reset(sa));
+        CHECK(mina_sim_run(sa, 1000) == MINA_SIM_HALTED);
+        CHECK(a.out_len == 14);
+    }
+
+    mina_sim_destroy(sa);
+    mina_sim_destroy(sb);
+    mina_sim_destroy(se);
+    free(hello);
+    free(echo);
+    printf("minasim-test: OK\n");
+    return 0;
+}
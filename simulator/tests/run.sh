@@ -6,8 +6,11 @@ AS="$ROOT/../mina-as/mina-as"
 SIM="$ROOT/mina-sim"
 OUT_ELF="$ROOT/../out/elf"
 OUT_TMP="$ROOT/../out/tmp"
+SIM_ARGS=""
 
 mkdir -p "$OUT_ELF" "$OUT_TMP"
+# COVERAGE_DIR=dir: also write --coverage data for every test into dir.
+if [ -n "$COVERAGE_DIR" ]; then mkdir -p "$COVERAGE_DIR"; fi
 
 if [ ! -x "$SIM" ]; then
   make -s -C "$ROOT"
@@ -30,12 +33,14 @@ run_test() {
     if [ -n "$opt" ]; then suffix="-opt"; fi
     elf="$OUT_ELF/${name}${suffix}.elf"
     out="$OUT_TMP/${name}${suffix}.out"
+    cov_args=""
+    if [ -n "$COVERAGE_DIR" ]; then cov_args="--coverage $COVERAGE_DIR/${name}${suffix}.cov"; fi
 
     $AS $opt $extra_args "$src" -o "$elf"
     if [ -n "$input" ]; then
-      printf "%s" "$input" | $SIM "$elf" > "$out" 2>/dev/null
+      printf "%s" "$input" | $SIM $SIM_ARGS $cov_args "$elf" > "$out" 2>/dev/null
     else
-      $SIM "$elf" > "$out" 2>/dev/null
+      $SIM $SIM_ARGS $cov_args "$elf" > "$out" 2>/dev/null
     fi
     cmp -s "$out" "$expected"
     rm -f "$out"
@@ -48,6 +53,8 @@ run_test "hello" "$ROOT/../mina-as/tests/src/hello.s" "$ROOT/tests/expected/hell
 
 run_test "uart-echo" "$ROOT/../mina-as/tests/src/uart-echo.s" "$ROOT/tests/expected/uart-echo.txt" "X"
 
+run_test "uart-irq-test" "$ROOT/../mina-as/tests/src/uart-irq-test.s" "$ROOT/tests/expected/uart-irq-test.txt" "Y"
+
 run_test "csr-test" "$ROOT/../mina-as/tests/src/csr-test.s" "$ROOT/tests/expected/csr-test.txt" ""
 
 run_test "csr-counter-test" "$ROOT/../mina-as/tests/src/csr-counter-test.s" "$ROOT/tests/expected/csr-counter-test.txt" ""
@@ -62,6 +69,8 @@ run_test "system-ret-bits-test" "$ROOT/../mina-as/tests/src/system-ret-bits-test
 
 run_test "interrupt-basic-test" "$ROOT/../mina-as/tests/src/interrupt-basic-test.s" "$ROOT/tests/expected/interrupt-basic-test.txt" ""
 
+run_test "timer-test" "$ROOT/../mina-as/tests/src/timer-test.s" "$ROOT/tests/expected/timer-test.txt" ""
+
 run_test "cap-test" "$ROOT/../mina-as/tests/src/cap-test.s" "$ROOT/tests/expected/cap-test.txt" ""
 
 run_test "cap-ops-test" "$ROOT/../mina-as/tests/src/cap-ops-test.s" "$ROOT/tests/expected/cap-ops-test.txt" ""
@@ -76,6 +85,28 @@ run_test "cap-fault-sealed-test" "$ROOT/../mina-as/tests/src/cap-fault-sealed-te
 
 run_test "syscall-io" "$ROOT/../mina-as/tests/src/syscall-io.s" "$ROOT/tests/expected/syscall-io.txt" ""
 
+run_test "syscall-iov-test" "$ROOT/../mina-as/tests/src/syscall-iov-test.s" "$ROOT/tests/expected/syscall-iov-test.txt" ""
+
+run_test "memcall-test" "$ROOT/../mina-as/tests/src/memcall-test.s" "$ROOT/tests/expected/memcall-test.txt" ""
+
+head -c 4096 /dev/zero > "$OUT_TMP/blk.img"
+SIM_ARGS="--blk $OUT_TMP/blk.img"
+run_test "blk-test" "$ROOT/../mina-as/tests/src/blk-test.s" "$ROOT/tests/expected/blk-test.txt" ""
+SIM_ARGS=""
+
+mkdir -p "$OUT_TMP/fsroot"
+SIM_ARGS="--fs-root $OUT_TMP/fsroot"
+run_test "hostfs-test" "$ROOT/../mina-as/tests/src/hostfs-test.s" "$ROOT/tests/expected/hostfs-test.txt" ""
+SIM_ARGS=""
+
+run_test "dma-test" "$ROOT/../mina-as/tests/src/dma-test.s" "$ROOT/tests/expected/dma-test.txt" ""
+
+SIM_ARGS="--rom 1000:1000"
+run_test "rom-test" "$ROOT/../mina-as/tests/src/rom-test.s" "$ROOT/tests/expected/rom-test.txt" ""
+SIM_ARGS=""
+
+run_test "mmu-test" "$ROOT/../mina-as/tests/src/mmu-test.s" "$ROOT/tests/expected/mmu-test.txt" ""
+
 run_test "fence-test" "$ROOT/../mina-as/tests/src/fence-test.s" "$ROOT/tests/expected/fence-test.txt" ""
 
 run_test "factorial-test" "$ROOT/../mina-as/tests/src/factorial-test.s" "$ROOT/tests/expected/factorial-test.txt" ""
@@ -112,12 +143,17 @@ run_test "tensor-sat-test" "$ROOT/../mina-as/tests/src/tensor-sat-test.s" "$ROOT
 
 run_test "tensor-illegal-fmt-test" "$ROOT/../mina-as/tests/src/tensor-illegal-fmt-test.s" "$ROOT/tests/expected/tensor-illegal-fmt-test.txt" ""
 
+run_test "tensor-ts-test" "$ROOT/../mina-as/tests/src/tensor-ts-test.s" "$ROOT/tests/expected/tensor-ts-test.txt" ""
+
 run_test "amo-test" "$ROOT/../mina-as/tests/src/amo-test.s" "$ROOT/tests/expected/amo-test.txt" ""
+run_test "amo-ops-test" "$ROOT/../mina-as/tests/src/amo-ops-test.s" "$ROOT/tests/expected/amo-ops-test.txt" ""
 
 run_test "abi-test" "$ROOT/../mina-as/tests/src/abi-test.s" "$ROOT/tests/expected/abi-test.txt" ""
 
 run_test "abi-stack-test" "$ROOT/../mina-as/tests/src/abi-stack-test.s" "$ROOT/tests/expected/abi-stack-test.txt" ""
 
+run_test "fuse-test" "$ROOT/../mina-as/tests/src/fuse-test.s" "$ROOT/tests/expected/fuse-test.txt" ""
+
 run_test "directives-test" "$ROOT/../mina-as/tests/src/directives-test.s" "$ROOT/tests/expected/directives-test.txt" ""
 
 run_test "bss-zero-test" "$ROOT/../mina-as/tests/src/bss-zero-test.s" "$ROOT/tests/expected/bss-zero-test.txt" ""
@@ -127,4 +163,126 @@ run_test "include-macro-test" "$ROOT/../mina-as/tests/src/include-macro-test.s"
 run_test "elf-layout-test" "$ROOT/../mina-as/tests/src/elf-layout-test.s" "$ROOT/tests/expected/elf-layout-test.txt" "" \
   --text-base 0x1000 --data-base 0x3000 --bss-base 0x4000 --segment-align 0x1000
 
+# --coverage: function, branch and instruction totals of the lcov report.
+$AS "$ROOT/../mina-as/tests/src/mmu-test.s" -o "$OUT_ELF/coverage-mmu.elf"
+$SIM --coverage "$OUT_TMP/coverage-mmu.cov" "$OUT_ELF/coverage-mmu.elf" > /dev/null 2>&1
+grep -E '^(FN|FNDA|FNF|FNH|BRF|BRH|LF|LH):' "$OUT_TMP/coverage-mmu.cov.info" > "$OUT_TMP/coverage-mmu.out"
+cmp -s "$OUT_TMP/coverage-mmu.out" "$ROOT/tests/expected/coverage-mmu.txt"
+rm -f "$OUT_TMP/coverage-mmu.cov" "$OUT_TMP/coverage-mmu.cov.info" "$OUT_TMP/coverage-mmu.out"
+echo "PASS coverage-mmu"
+
+# --watch/--break: logged accesses and breakpoint, then a watched store and
+# a breakpoint that stop the run before the instruction.
+for opt in "" "-O"; do
+  $AS $opt "$ROOT/../mina-as/tests/src/watch-test.s" -o "$OUT_ELF/watch-test.elf"
+  {
+    $SIM --watch 2000:16:rw:log --break 100:log "$OUT_ELF/watch-test.elf"
+    $SIM --watch 2008 "$OUT_ELF/watch-test.elf"
+    $SIM --break 100 "$OUT_ELF/watch-test.elf"
+  } > "$OUT_TMP/watch-test.out" 2>&1
+  cmp -s "$OUT_TMP/watch-test.out" "$ROOT/tests/expected/watch-test.txt"
+  rm -f "$OUT_TMP/watch-test.out"
+done
+echo "PASS watch-test"
+
+# --sample/--bbv/--simpoints: window estimates, BBVs and picked intervals
+# for a two-phase program.
+for opt in "" "-O"; do
+  $AS $opt "$ROOT/../mina-as/tests/src/sample-test.s" -o "$OUT_ELF/sample-test.elf"
+  (
+    cd "$OUT_TMP"
+    $SIM --sample 10000:1000:500 --bbv sample-test.bbv --simpoints 3 "$OUT_ELF/sample-test.elf"
+    cat sample-test.bbv sample-test.bbv.simpoints sample-test.bbv.weights
+  ) > "$OUT_TMP/sample-test.out" 2>&1
+  cmp -s "$OUT_TMP/sample-test.out" "$ROOT/tests/expected/sample-test.txt"
+  rm -f "$OUT_TMP/sample-test.out" "$OUT_TMP"/sample-test.bbv*
+done
+echo "PASS sample-test"
+
+# --stats-json: instruction mix, branch directions, TENSOR funct3, fused
+# pairs, memory syscalls, traps and interrupts (host timing fields dropped).
+: > "$OUT_TMP/stats-test.out"
+for t in trap-test tensor-basic-test interrupt-basic-test fuse-test memcall-test; do
+  $SIM --stats-json "$OUT_TMP/stats-test.json" "$OUT_ELF/$t.elf" > /dev/null 2>&1
+  grep -v '"seconds"\|"mips"' "$OUT_TMP/stats-test.json" >> "$OUT_TMP/stats-test.out"
+done
+cmp -s "$OUT_TMP/stats-test.out" "$ROOT/tests/expected/stats-test.txt"
+rm -f "$OUT_TMP/stats-test.out" "$OUT_TMP/stats-test.json"
+echo "PASS stats-test"
+
+# --heartbeat: an endless loop stopped by -s reports progress on stderr.
+$AS "$ROOT/../mina-as/tests/src/spin.s" -o "$OUT_ELF/spin.elf"
+$SIM --heartbeat 0.02 -s 20000000 "$OUT_ELF/spin.elf" 2> "$OUT_TMP/heartbeat.err"
+grep -q '^progress: pc=0x[48] steps=[0-9]* ' "$OUT_TMP/heartbeat.err"
+rm -f "$OUT_TMP/heartbeat.err"
+echo "PASS heartbeat"
+
+# --hugepages: RAM mapped for 2 MiB pages runs the same; the exit report
+# names the backing actually obtained (host dependent).
+$SIM --hugepages thp -m 8388608 "$OUT_ELF/mmu-test.elf" > "$OUT_TMP/hugepages.out" 2> "$OUT_TMP/hugepages.err"
+cmp -s "$OUT_TMP/hugepages.out" "$ROOT/tests/expected/mmu-test.txt"
+grep -q '^ram: 8 MiB [a-z0-9]*, [0-9]* MiB in huge pages' "$OUT_TMP/hugepages.err"
+rm -f "$OUT_TMP/hugepages.out" "$OUT_TMP/hugepages.err"
+echo "PASS hugepages"
+
+# --record/--replay: input that arrives while the guest spins is logged
+# with the instruction count that saw it; replaying without stdin
+# reproduces the output and the exact step count.
+$AS "$ROOT/../mina-as/tests/src/replay-test.s" -o "$OUT_ELF/replay-test.elf"
+(sleep 0.1; printf ab; sleep 0.1; printf 'cd\n') |
+  $SIM -s 100000000 --record "$OUT_TMP/replay-test.log" "$OUT_ELF/replay-test.elf" \
+    > "$OUT_TMP/replay-test.out" 2> "$OUT_TMP/replay-test.rec"
+cmp -s "$OUT_TMP/replay-test.out" "$ROOT/tests/expected/replay-test.txt"
+$SIM -s 100000000 --replay "$OUT_TMP/replay-test.log" "$OUT_ELF/replay-test.elf" < /dev/null \
+  > "$OUT_TMP/replay-test.out" 2> "$OUT_TMP/replay-test.err"
+cmp -s "$OUT_TMP/replay-test.out" "$ROOT/tests/expected/replay-test.txt"
+cmp -s "$OUT_TMP/replay-test.rec" "$OUT_TMP/replay-test.err"
+rm -f "$OUT_TMP"/replay-test.*
+echo "PASS replay-test"
+
+# libminasim: drive the instance API in-process against assembled images.
+make -s -C "$ROOT" lib
+$AS "$ROOT/../mina-as/tests/src/hello.s" -o "$OUT_ELF/lib-hello.elf"
+$AS "$ROOT/../mina-as/tests/src/uart-echo.s" -o "$OUT_ELF/lib-uart-echo.elf"
+${CC:-cc} -std=c11 -Wall -Wextra -I"$ROOT/src" "$ROOT/tests/lib/minasim-test.c" "$ROOT/libminasim.a" \
+  -pthread -lm -o "$OUT_TMP/minasim-test"
+"$OUT_TMP/minasim-test" "$OUT_ELF/lib-hello.elf" "$OUT_ELF/lib-uart-echo.elf" > /dev/null
+rm -f "$OUT_TMP/minasim-test"
+echo "PASS minasim-test"
+
+# mina-simd: jobs over a Unix socket; the second run of an image is served
+# from the instance that already holds it.
+if [ ! -x "$ROOT/mina-simd" ]; then make -s -C "$ROOT" mina-simd; fi
+SOCK="$OUT_TMP/mina-simd.sock"
+"$ROOT/mina-simd" -S "$SOCK" -j 2 2> /dev/null &
+simd_pid=$!
+trap 'kill $simd_pid 2>/dev/null' EXIT
+n=0
+while [ ! -S "$SOCK" ] && [ "$n" -lt 100 ]; do sleep 0.05; n=$((n + 1)); done
+"$ROOT/mina-simd" run -S "$SOCK" -n "$OUT_ELF/hello.elf" > "$OUT_TMP/simd.out" 2> /dev/null
+cmp -s "$OUT_TMP/simd.out" "$ROOT/tests/expected/hello.txt"
+"$ROOT/mina-simd" run -S "$SOCK" -n -v "$OUT_ELF/hello.elf" 2>&1 > /dev/null | grep -q '^mina-simd: image cached'
+printf "X" | "$ROOT/mina-simd" run -S "$SOCK" "$OUT_ELF/uart-echo.elf" > "$OUT_TMP/simd.out" 2> /dev/null
+cmp -s "$OUT_TMP/simd.out" "$ROOT/tests/expected/uart-echo.txt"
+# Statistics of a guest that reads no input, so the instruction counts do
+# not depend on when stdin arrives.
+"$ROOT/mina-simd" run -S "$SOCK" -n --path --stats-json "$OUT_TMP/simd.json" "$OUT_ELF/hello.elf" > /dev/null 2>&1
+$SIM --stats-json "$OUT_TMP/simd-ref.json" "$OUT_ELF/hello.elf" > /dev/null 2>&1
+grep -v '"seconds"\|"mips"' "$OUT_TMP/simd.json" > "$OUT_TMP/simd.out"
+grep -v '"seconds"\|"mips"' "$OUT_TMP/simd-ref.json" | cmp -s - "$OUT_TMP/simd.out"
+kill $simd_pid
+wait $simd_pid || true
+trap - EXIT
+rm -f "$OUT_TMP"/simd.* "$OUT_TMP/simd-ref.json"
+echo "PASS mina-simd"
+
+# --forkserver: a host driver speaks the AFL protocol to mina-sim.
+${CC:-cc} -std=c11 -Wall -Wextra "$ROOT/tests/lib/forkserver-test.c" -o "$OUT_TMP/forkserver-test"
+for opt in "" "-O"; do
+  $AS $opt "$ROOT/../mina-as/tests/src/forkserver-test.s" -o "$OUT_ELF/forkserver-test.elf"
+  "$OUT_TMP/forkserver-test" "$SIM" "$OUT_ELF/forkserver-test.elf" > /dev/null
+done
+rm -f "$OUT_TMP/forkserver-test"
+echo "PASS forkserver-test"
+
 echo "ALL TESTS PASS"
\ No newline at end of file
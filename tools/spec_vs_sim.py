@@ -22,7 +22,7 @@ REPORT_TEMPLATE = """# Spec vs Simulator Audit
 - **M extension:** Implemented (`mul`, `mulh`, `mulhsu`, `mulhu`, `div`, `divu`, `rem`, `remu`).
 - **SYSTEM/CSR:** Implemented; delegation, mret/sret stacking, and basic interrupt injection tested.
 - **CSR counters:** `cycle`, `time`, `instret` implemented and tested.
-- **AMO:** Implemented **only** `amoswap.w`/`amoswap.d` (per v1 spec).
+- **AMO:** Implemented full set (`amoswap/add/xor/and/or/min/max/minu/maxu`, `lr`/`sc`) in `.w`/`.d` forms.
 - **CAP:** Base set implemented and covered by ops/fault tests.
 - **TENSOR:** Implemented all 9 instructions; coverage includes format edge cases and INT8 saturation.
 - **Test status:** {test_status}
@@ -41,7 +41,7 @@ REPORT_TEMPLATE = """# Spec vs Simulator Audit
 | Jumps | jal, jalr | ✅ Implemented | abi-test, abi-stack-test |
 | movhi/movpc | movhi, movpc | ✅ Implemented | trap-test (movhi), elf-layout-test |
 | fence | fence | ✅ Implemented (no timing model) | fence-test |
-| system | ecall, ebreak, mret, sret | ✅ Implemented | trap-test, system-ret-deleg-test, system-ret-bits-test, interrupt-basic-test |
+| system | ecall, ebreak, mret, sret, wfi, sfence.vma | ✅ Implemented | trap-test, system-ret-deleg-test, system-ret-bits-test, interrupt-basic-test, timer-test, mmu-test |
 
 ### M Extension
 
@@ -62,6 +62,9 @@ REPORT_TEMPLATE = """# Spec vs Simulator Audit
 |---|---|---|---|
 | amoswap.w | ✅ | ✅ | amo-test |
 | amoswap.d | ✅ | ✅ | amo-test |
+| amoadd/xor/and/or.w/d | ✅ | ✅ | amo-ops-test |
+| amomin/max/minu/maxu.w/d | ✅ | ✅ | amo-ops-test |
+| lr.w/d, sc.w/d | ✅ | ✅ | amo-ops-test |
 
 ### Capability Extension (CAP)
 
@@ -90,25 +93,28 @@ REPORT_TEMPLATE = """# Spec vs Simulator Audit
 | tzero | ✅ | ✅ | tensor-basic-test |
 | tred | ✅ | ✅ | tensor-basic-test |
 | tscale | ✅ | ✅ | tensor-basic-test |
+| tsave/trestore | ✅ | ✅ | tensor-ts-test |
 
 ## CSR Coverage (Spec vs Simulator)
 
 | CSR | Spec access | Simulator | Notes |
 |---|---|---|---|
-| mstatus | R/W | ✅ | subset mask for sstatus enforced |
+| mstatus | R/W | ✅ | subset mask for sstatus enforced; TS Off traps tensor ops, writes set Dirty |
 | mie/mip | R/W | ✅ | interrupts not fully modeled |
 | medeleg/mideleg | R/W | ✅ | delegation used in trap_entry |
 | mtvec/mepc/mcause/mtval | R/W | ✅ | trap handling implemented |
 | mscratch | R/W | ✅ | — |
 | sstatus/sie/sip/stvec/sepc/scause/stval/sscratch | R/W | ✅ | — |
 | cycle/time/instret | R | ✅ | csr-counter-test |
+| satp | R/W | ✅ | Sv39 walk + software TLB (mmu-test) |
+| tlbhit/tlbmiss | R | ✅ | mmu-test |
 
 ## Behavioral Constraints & Notes
 
 - **Shift immediates:** non-zero `imm[11:6]` trap (per ISA).
 - **Capability mode:** PCC (`c31`) enforced for instruction fetch; DDC (`c0`) enforced for data accesses.
 - **CSR writes:** illegal writes to read-only CSRs trap (tested via `csr-counter-test`).
-- **AMO:** only `amoswap.w/d` implemented, no LR/SC.
+- **AMO:** `sc` compares against the value `lr` read; the reservation is cleared by every `sc` and trap.
 - **Syscalls:** minimal `read/write/exit` only; M-mode syscalls bypass DDC checks for handler output.
 
 ## Test Coverage Map (High-Level)
@@ -116,13 +122,14 @@ REPORT_TEMPLATE = """# Spec vs Simulator Audit
 - **Core ISA:** hello, factorial-test, fib-test, reverse-test, palindrome-test, prime-test/prime-test2
 - **M extension:** mext-test
 - **Traps/illegal:** trap-test, illegal-shift-test, illegal-insn-test, misaligned-load-test, misaligned-store-test, system-ret-deleg-test, system-ret-bits-test, interrupt-basic-test
-- **AMO:** amo-test
+- **AMO:** amo-test, amo-ops-test
 - **ABI:** abi-test, abi-stack-test
 - **ELF layout:** elf-layout-test
 - **CAP:** cap-test, cap-ops-test, cap-fault-perm-test, cap-fault-bounds-test, cap-fault-tag-test, cap-fault-sealed-test
-- **Tensor:** tensor_test.bin, tensor-basic-test, tensor-fmt-test, tensor-stride0-test, tensor-naninf-test, tensor-sat-test, tensor-illegal-fmt-test
+- **Tensor:** tensor_test.bin, tensor-basic-test, tensor-fmt-test, tensor-stride0-test, tensor-naninf-test, tensor-sat-test, tensor-illegal-fmt-test, tensor-ts-test
 - **CSR counters:** csr-counter-test, csr-sstatus-mask-test
 - **Fence:** fence-test
+- **MMU:** mmu-test
 
 ## Remaining Gaps / Recommended Next Actions
 